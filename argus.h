@@ -23,6 +23,9 @@ extern struct chSet *chSetPtr;
 extern struct chRead *chReadPtr;
 // dcm2 defs
 extern float dcm2MBpar[];
+extern BYTE dcm2MBout;                  // DCM2 main board bus expander output register shadow
+extern unsigned char bexSpiBurst;       // bus expander SPI: several clock edges per I2C write when = 1
+extern unsigned char dcm2AttenBcast;    // broadcast DCM2 attenuator settings to all modules when = 1
 extern struct dcm2params dcm2Apar;
 extern struct dcm2params dcm2Bpar;
 // saddlebag defs
@@ -37,14 +40,22 @@ extern "C" {
 
 extern int lnaPwrState;  // LNA power supply state
 extern int sbAmpState;   // Saddlebag amplifiers power state
+extern int lnaSeqStep;   // LNA power sequence step in progress, 0 when idle
+extern short lnaSeqState; // LNA power state being sequenced to
+extern int lnaSeqRtn;    // return value of the latest LNA power sequence
+extern unsigned char lnaSeqEarly;       // end LNA power settling waits when rails are steady when = 1
 extern unsigned char lnaPSlimitsBypass; // bypass LNA power supply limits when = 1
 extern unsigned char cifPSlimitsBypass; // bypass cold IF power supply limits when = 1
 extern unsigned char lnaLimitsBypass;   // bypass soft limits on LNA bias when = 1
 extern unsigned char stopVaneOnStall;   // bypass timeout on vane stall = 0
+extern unsigned char vaneMoving;        // vane move in progress when = 1
 extern float gvdiv;                     // Gate voltage divider factor
 extern float vaneOffset;                // Vane offset voltage for angle calculation
 extern float vaneV2Deg;                 // Vane volts to degrees
-extern unsigned char i2cBusBusy;        // I2C bus is busy when = 1
+extern unsigned char i2cBusBusy;        // I2C bus is held when = 1 (read only; see argus_bus.cpp)
+extern unsigned int i2cBusWait;         // maximum wait for the I2C bus [ms]
+extern unsigned char i2cTraceOn;        // record I2C transactions when = 1
+extern unsigned long i2cXferCtr;        // I2C transactions since boot
 extern unsigned int busLockCtr;         // I2C successful bus lock request counter
 extern unsigned int busNoLockCtr;       // I2C unsuccessful bus lock request counter
 extern unsigned char freezeSys;         // freeze system state when = 1
@@ -54,12 +65,21 @@ extern unsigned int freezeErrCtr;       // freeze error counter (access request
 extern short unsigned int biasSatus[NRX]; // receiver status word, see argus_rxCheck(void)
 extern int i2cState[];                  // I2C bus SCL (0/1) and SDA (0/2) values
 extern int foundLNAbiasSys;                      // 0 when DCM2 board is detected
+extern unsigned int i2cSelSkipCtr;      // I2C switch select writes skipped by switch shadow
+extern unsigned int samplerPeriod;      // monitor sampler sweep period [ms], 0 when stopped
+extern unsigned long samplerSeq;        // monitor sampler latest published sweep number
+extern unsigned int samplerSweepMs;     // monitor sampler latest sweep duration [ms]
 
 extern void argus_init(const flash_t *flash);
 extern int  argus_test(int foo, float bar);
 extern int  argus_setLNAbias(char *term, int m, int n, float v, unsigned char busyOverride);
 extern int  argus_setAllBias(char *inp, float v, unsigned char busyOverride);
+extern int  argus_setBiasBatch(const struct biasBatch *b);
 extern int  argus_lnaPower(short state);
+extern int  argus_lnaPowerStart(short state);
+extern int  argus_lnaSeqBusy(void);
+extern int  argus_lnaSeqReport(char *str);
+extern void argus_startLnaSeq(void);
 extern int  argus_cifPower(short state);
 extern int  argus_readLNAbiasADCs(char *sw);
 extern int  argus_readPwrADCs(void);
@@ -69,6 +89,23 @@ extern int  argus_lnaPowerPIO(void);
 extern int  argus_openSubbusC(BYTE addr);
 extern int  argus_closeSubbusC(void);
 extern int  argus_clearBus(void);
+extern int  i2cSend1(void);
+extern void i2cSwitchInvalidate(void);
+extern void i2cBusInit(void);
+extern int  i2cBusLock(const char *who);
+extern void i2cBusUnlock(void);
+extern void i2cBusReset(void);
+extern int  i2cBusTestHold(int on);
+extern void i2cBusClearStats(void);
+extern int  i2cBusReport(char *str);
+extern const char *i2cBusOwner(void);
+extern int  i2cBusHeld(void);
+extern void i2cTraceInit(void);
+extern void i2cTraceStart(void);
+extern int  i2cTrace(int stat, int nbytes);
+extern void i2cTraceClear(void);
+extern int  i2cTraceReport(int fd, char *str, unsigned maxbytes);
+extern int  i2cTraceJSON(int fd, char *str, unsigned maxbytes, unsigned nrec);
 extern int  argus_readAllSystemADCs(void);
 extern int  argus_biasCheck(void);
 extern int  argus_powCheck(void);
@@ -76,8 +113,11 @@ extern int  argus_thermCheck(void);
 extern int  argus_ifCheck(void);
 extern int  argus_systemState(void);
 
+extern int  bexSpiXfer(const struct bexSpiPins *p, BYTE cs, int nlead, int nbits, int nwords,
+		const unsigned short *tx, unsigned short *rx, int endClkLow);
 extern int  dcm2_setAtten(int m, char *ab, char *iq, float atten);
 extern int  dcm2_setAllAttens(float atten);
+extern int  dcm2_setAttenBatch(const struct biasBatch *b);
 extern int  dcm2_ampPow(char *inp);
 extern int  dcm2_ledOnOff(char *inp);
 extern int  dcm2_readMBadc(void);
@@ -99,10 +139,34 @@ extern void init_saddlebags(void);
 
 extern int  vane_obscal(char *inp);
 extern int  vane_readADC(void);
+extern int  vane_relayCtrl(char *inp);
+extern int  vane_angle(void);
+extern int  vane_current(void);
+extern void vane_startTask(void);
+extern int  vane_trajJSON(int fd, char *str, unsigned maxbytes);
 extern void init_vane(void);
 
 extern int  comap_presets(const flash_t *flash);
 
+extern void argus_batchInit(void);
+extern int  argus_batchBegin(int client);
+extern int  argus_batchStage(int client, char term, int m, int n, float v);
+extern int  argus_batchCommit(int client, char *msg);
+extern int  argus_batchAbort(int client);
+extern void argus_batchRelease(int client);
+extern int  argus_batchReport(char *str);
+
+extern void argus_startSampler(void);
+extern int  argus_samplerReady(void);
+extern int  argus_sample(void);
+extern const struct argusSnapshot *argus_lockSnapshot(void);
+extern void argus_unlockSnapshot(void);
+
+extern void argus_telemInit(void);
+extern int  argus_telemFrame(BYTE *buf, unsigned maxbytes);
+extern int  argus_telemDelta(BYTE *buf, unsigned maxbytes, unsigned long since);
+extern unsigned short telemDeadband[];  // delta deadbands by telemetry field id [raw units]
+
 /**************************************************************************/
 
 
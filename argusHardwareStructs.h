@@ -17,29 +17,53 @@ AH 2014.07.01
 #define VER "boardTests_20250611_b"
 
 // Run with hardware or standalone by commenting/uncommenting #define SIMULATE
+// Standalone runs route all I2C traffic to the simulated bus in i2csim.c
 //#define SIMULATE
 #ifdef SIMULATE
-#define I2CSEND1 0
-#define I2CSEND2 0
-#define I2CSEND3 0
-#define I2CREAD1 0
-#define I2CREAD2 0
+#define I2CSEND1_BUS i2csim_send(address, buffer, 1)
+#define I2CSEND2_BUS i2csim_send(address, buffer, 2)
+#define I2CSEND3_BUS i2csim_send(address, buffer, 3)
+#define I2CREAD1_BUS i2csim_read(address, buffer, 1)
+#define I2CREAD2_BUS i2csim_read(address, buffer, 2)
+#define I2CSENDN_BUS(n) i2csim_send(address, buffer, (n))
 #define BYPASS 1
 #else
-#define I2CSEND1 (int)I2CSendBuf(address, buffer, 1)
-#define I2CSEND2 (int)I2CSendBuf(address, buffer, 2)
-#define I2CSEND3 (int)I2CSendBuf(address, buffer, 3)
-#define I2CREAD1 (int)I2CReadBuf(address, buffer, 1)
-#define I2CREAD2 (int)I2CReadBuf(address, buffer, 2)
+#define I2CSEND1_BUS (int)I2CSendBuf(address, buffer, 1)
+#define I2CSEND2_BUS (int)I2CSendBuf(address, buffer, 2)
+#define I2CSEND3_BUS (int)I2CSendBuf(address, buffer, 3)
+#define I2CREAD1_BUS (int)I2CReadBuf(address, buffer, 1)
+#define I2CREAD2_BUS (int)I2CReadBuf(address, buffer, 2)
+#define I2CSENDN_BUS(n) (int)I2CSendBuf(address, buffer, (n))
 #define BYPASS 0
 #endif
+// Bus transactions are recorded by the I2C tracer; see argus_trace.cpp
+#define I2CTRACED(xfer, nbytes) (i2cTraceStart(), i2cTrace((xfer), (nbytes)))
+#define I2CSEND2 I2CTRACED(I2CSEND2_BUS, 2)
+#define I2CSEND3 I2CTRACED(I2CSEND3_BUS, 3)
+#define I2CSENDN(n) I2CTRACED(I2CSENDN_BUS(n), (n))
+#define I2CREAD1 I2CTRACED(I2CREAD1_BUS, -1)
+#define I2CREAD2 I2CTRACED(I2CREAD2_BUS, -2)
+// Single-byte writes check the I2C switch shadow first; see i2cSend1() in argus_io.cpp
+#define I2CSEND1 i2cSend1()
 
 // Misc parameters
 #define CMDDELAY 1        // pause before executing command, in units of 50 ms
+#define LNAPWROFFVAL -10  // value to return when the LNA bias cards are not powered
 #define I2CBUSERRVAL -100 // value to return for I2C bus lock error
 #define FREEZEERRVAL -200 // value to return for system freeze violation error
+#define LNASEQBUSYVAL -300 // value to return while LNA power is being sequenced
+#define BATCHERRVAL -400  // value to return for a set point batch out of order or out of limits
 #define WRONGBOX -1000    // value to return if wrong box (bias/dcm2) is addressed
 
+// I2C bus arbiter, see argus_bus.cpp
+#define I2CBUSWAIT 2000   // default maximum wait for the I2C bus [ms]
+#define I2CBUSNCALLERS 20 // number of callers tracked for hold time statistics
+#define I2CBUSNHIST 8     // wait time histogram bins: 0, 1, 2-3, ... >= 64 ticks
+
+// I2C transaction tracer, see argus_trace.cpp
+#define I2CTRACEN 1024    // trace ring length [transactions], power of 2
+#define I2CTRACENSUM 16   // callers and devices listed in trace summaries
+
 // Hardware parameters -- must match structure definitions in argusHardwareStructs.h!
 #define NUM_ELEM(x) (sizeof(x) / sizeof(*(x)))
 #define NRX 20      // number of receivers
@@ -77,6 +101,13 @@ AH 2014.07.01
 #define MINAMPV 10.0       // Min amplifier supply voltage (absolute)
 #define MAXAMPV 15.5       // Max amplifier supply voltage (absolute)
 
+// LNA power sequencer
+#define LNASEQVCCMS 1000   // VCC settling time before gate supplies [ms]
+#define LNASEQAMPMS 1000   // gate supply settling time before VDS [ms]
+#define LNASEQOFFMS 500    // settling time after each supply is turned off [ms]
+#define LNASEQMINMS 200    // minimum settling time when advancing early [ms]
+#define LNASEQTOL 0.05     // rails are steady when successive readings agree within this [V]
+
 // Over-temperature limits
 #define MAXCOLDT 40.   // Maximum nom 20K temperature [K]
 #define MAXINTT  80.   // Maximum nom 77K temperature [K]
@@ -210,6 +241,19 @@ struct chRead2 { // read ADCs
 #define BEXCONF SPI_MISO_M  // read SPI_MISO_M, write all others on BEX
 #define BEXINIT QLOG_CS | ILOG_CS | Q_ATTEN_LE | I_ATTEN_LE | BOARD_T_CS
 
+// SPI bit-banged through the bus expanders, see bexSpiXfer() in argus_io.cpp
+struct bexSpiPins {
+	BYTE addr;     // BEX I2C address
+	BYTE clk;      // SPI clock output
+	BYTE mosi;     // SPI data output, 0 if none
+	BYTE miso;     // SPI data input, 0 if none
+	BYTE csAll;    // every chip select and latch enable on the BEX, idle high
+	BYTE *shadow;  // output register shadow holding the non-SPI outputs, 0 if none
+};
+#define DCM2MOD_SPIPINS {BEX_ADDR, SPI_CLK_M, SPI_MOSI_M, SPI_MISO_M, QLOG_CS | ILOG_CS | Q_ATTEN_LE | I_ATTEN_LE | BOARD_T_CS, 0}
+#define DCM2MB_SPIPINS {BEX_ADDR0, SPI_CLK0_M, 0, SPI_DAT0_M, SPI_CSB1_M, &dcm2MBout}
+#define BEXSPI_MAXBURST 16  // output bytes per I2C write to a bus expander
+
 struct dcm2params {
 	BYTE status[NRX]; // status byte
 	BYTE attenI[NRX]; // command attenuation, I channel
@@ -255,6 +299,18 @@ struct saddlebagParams {
 #define VANETIMEOUT 10.      // seconds for vane movement; declare timeout if longer
 #define VANESTALLTIME 0.5    // seconds; if movement in this time < STALLERRANG, declare stall
 #define VANEFLAGNOPOS 10     // highest integer value for vanePar.vaneFlag returns from vanePos[]; unclear position
+#define VANESAMPLEMS 100     // vane angle and motor current sample period while moving [ms]
+#define VANESTOPMS 1500      // motor stopped time before each move [ms]
+#define VANESETTLEMS 1000    // settling time after arrival, before the final position check [ms]
+#define VANETRAJN 128        // vane trajectory buffer length [samples]
+#define VANECURRCHAN 1       // vane ADC channel for motor current (NC on present boards)
+
+// One vane trajectory sample
+struct vaneTrajPoint {
+	WORD ms;        // time since motor start [ms]
+	float angle;    // vane angle [deg]
+	float curr;     // motor current [A]
+};
 
 struct vaneParams {
 	float adcv[8];
@@ -262,4 +318,126 @@ struct vaneParams {
 	BYTE vaneFlag;
 };
 
+/***************************************************************************/
+/* Monitor sampler definitions */
+
+#define SAMPLERPERIOD 1000           // default sweep period [ms]; 0 stops the sampler
+
+// Published copy of all monitor points from one complete sweep
+struct argusSnapshot {
+	unsigned long seq;   // sweep sequence number, 0 before the first sweep
+	DWORD tick;          // TimeTick at end of sweep
+	DWORD sweepTicks;    // sweep duration [ticks]
+	int lnaPwrState;     // LNA power state during sweep
+	int rtnLNA;          // return sums: power control ADCs and LNA monitor points
+	int rtnBC;           //   bias card power supplies
+	int rtnTherm;        //   cryostat thermometry
+	int rtnSbag;         //   saddlebag ADCs
+	int rtnVane;         //   vane ADC
+	int rtnDcm2;         //   DCM2 main board and modules
+	float pwrCtrl[9];
+	struct receiverParams rx[NRX];
+	struct biasCardParams bc[NBIASC];
+	struct cryostatParams cryo;
+	struct saddlebagParams sb[NSBG];
+	struct vaneParams vane;
+	float dcm2MB[9];
+	struct dcm2params dcm2A;
+	struct dcm2params dcm2B;
+};
+
+/***************************************************************************/
+/* Binary telemetry frame definitions, see argus_telem.cpp */
+
+#define TELEMMAGIC 0x41524754UL  // "ARGT"
+#define TELEMVERSION 2           // frame and block layout version
+#define TELEMSCHEMA_LNA 1        // LNA bias system fields
+#define TELEMSCHEMA_DCM2 2       // DCM2 fields
+#define TELEMMAXBYTES 1024       // longest frame [bytes]
+#define TELEMMAXPTS 320          // most values in a frame, for the delta change table
+
+// header flags
+#define TELEMFLAG_LNAON 0x01     // LNA power on
+#define TELEMFLAG_DELTA 0x02     // delta frame: a telemDelta section follows the header
+#define TELEMFLAG_KEY 0x04       // keyframe: values from the change table, a base for deltas
+
+// block value types; the code is also the value size in bytes
+#define TELEMTYPE_U8 1
+#define TELEMTYPE_I16 2
+#define TELEMTYPE_I32 4
+
+// block field ids, with value units; values are raw*10^exp in these units
+#define TELEM_PWRCTRL 1     // power control ADCs [V], chassis temperature [C]
+#define TELEM_LNAV 2        // LNA monitor points by receiver: vg1, vg2, vd1, vd2 [V]
+#define TELEM_LNAID 3       // LNA monitor points by receiver: id1, id2 [mA]
+#define TELEM_LNASETS 4     // LNA set points by receiver: vg1, vg2, vd1, vd2 [V]
+#define TELEM_BIASCARD 5    // bias card supplies by card [V]
+#define TELEM_CRYOTEMP 6    // cryostat temperatures [K]
+#define TELEM_CRYOAUX 7     // cryostat aux inputs [V]
+#define TELEM_SBADC 8       // saddlebag ADCs by saddlebag, as for the jsbag command
+#define TELEM_SBFLAGS 9     // saddlebag bits by saddlebag: 0 PLL lock, 1 amplifier power
+#define TELEM_VANEADC 10    // vane ADCs [V]
+#define TELEM_VANEANGLE 11  // vane angle [deg]
+#define TELEM_VANEFLAG 12   // vane position flag, as for vanePar.vaneFlag
+#define TELEM_DCM2MB 13     // DCM2 main board ADCs [V], temperature [C]
+// DCM2 module fields come in two blocks each, band A then band B
+#define TELEM_DCM2STATUS 14 // DCM2 module status by module
+#define TELEM_DCM2ATTEN 15  // DCM2 attenuation [0.5 dB] by I, Q then module
+#define TELEM_DCM2POW 16    // DCM2 total power [dBm] by I, Q then module
+#define TELEM_DCM2TEMP 17   // DCM2 module temperature [C] by module
+#define TELEM_NFIELD 17     // highest field id
+
+// Frame header, in network byte order; field blocks follow
+struct telemHeader {
+	DWORD magic;     // TELEMMAGIC
+	BYTE version;    // TELEMVERSION
+	BYTE schema;     // TELEMSCHEMA_LNA or TELEMSCHEMA_DCM2
+	WORD nbytes;     // frame length, header included [bytes]
+	DWORD seq;       // monitor snapshot sequence number
+	DWORD ver;       // change table version of delta and keyframe values, else 0
+	WORD ageMs;      // snapshot age when framed [ms], saturates at 0xffff
+	BYTE flags;      // TELEMFLAG_* bits
+	BYTE errs;       // read errors: bit 0 LNA, 1 bias cards, 2 cryostat, 3 saddlebags, 4 vane, 5 DCM2
+	WORD nblocks;    // number of field blocks
+	WORD pktSeq;     // telemetry service packet number, wrapping; 0 when not published
+};
+
+// Field block header; followed by n validity bits (MSB first), then n values,
+// each part zero-padded to a multiple of four bytes
+struct telemBlock {
+	BYTE id;           // TELEM_* field id
+	BYTE type;         // TELEMTYPE_*
+	signed char exp;   // decimal exponent: value = raw*10^exp
+	BYTE n;            // number of values
+};
+
+// Delta frame section, following the header; n telemDeltaPoint entries follow
+struct telemDelta {
+	DWORD since;     // change table version the delta applies to
+	WORD n;          // number of changed values
+	WORD spare;
+};
+
+// One changed value in a delta frame
+struct telemDeltaPoint {
+	WORD point;      // 256*k + i for value i of block k (from 0) of a keyframe
+	BYTE valid;      // 1 when raw is valid
+	BYTE spare;
+	long raw;        // value, scaled as in the keyframe block
+};
+
+/***************************************************************************/
+/* Set point batch definitions, see argus_batch.cpp */
+
+// Staged LNA bias and DCM2 attenuator set points
+struct biasBatch {
+	float vg[NRX][NSTAGES];       // gate set points [V]
+	float vd[NRX][NSTAGES];       // drain set points [V]
+	BYTE atten[2][2][NRX];        // DCM2 attenuation words, 2 per dB, [band][iq][m]
+	char setG[NRX][NSTAGES];      // 1 when the gate is staged
+	char setD[NRX][NSTAGES];      // 1 when the drain is staged
+	BYTE setA[2][2][NRX];         // 1 when the attenuator is staged
+	int n;                        // number of staged set points
+};
+
 #endif
@@ -0,0 +1,257 @@
+/**
+  \file
+  \author Andy Harris
+  \brief  Set point batches for Argus and DCM2 hardware.
+
+  A batch collects LNA gate and drain set points, or DCM2 attenuator
+  settings, and applies them together.  argus_batchBegin() opens an empty
+  batch, argus_batchStage() adds set points, replacing any staged earlier for
+  the same terminal, and argus_batchCommit() checks the whole set against the
+  soft limits before writing any of it, in one bus pass.  A rejected batch
+  stays open for correction.
+
+  There is one batch.  The control client that opens it owns it until it is
+  committed or discarded, or the client disconnects; the others cannot stage,
+  commit or discard set points meanwhile.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <ucos.h>
+#include <constants.h>
+
+#include "argus.h"
+
+static struct biasBatch batch;       // staged set points, guarded by batchLock
+static char batchOpen = 0;           // set by argus_batchBegin()
+static int batchOwner = -1;          // control client that opened the batch
+static OS_CRIT batchLock;
+static char batchReady = 0;          // set by argus_batchInit()
+
+/****************************************************************************************/
+/**
+  \brief Initialize the batch lock.
+
+  Call once at startup, before the control service accepts clients.
+*/
+void argus_batchInit(void)
+{
+	OSCritInit(&batchLock);
+	batchReady = 1;
+}
+
+/**
+  \brief Lock the batch.
+*/
+static void batchEnter(void)
+{
+	OSCritEnter(&batchLock, 0);
+}
+
+/**
+  \brief Check the staged LNA set points as a set.
+
+  Each staged stage is checked with the staged value of both terminals, or
+  the present setting of an unstaged one, so the drain-gate limit applies to
+  the final state.  Skipped when lnaLimitsBypass is set.
+
+  \param  msg  description of the first violation, for a failed check.
+  \return Zero when the set is within limits, else BATCHERRVAL.
+*/
+static int batchCheckLNA(char *msg)
+{
+	int m, n;
+	float g, d;
+
+	if (lnaLimitsBypass) return 0;
+
+	for (m=0; m<NRX; m++) {
+		for (n=0; n<NSTAGES; n++) {
+			if (!batch.setG[m][n] && !batch.setD[m][n]) continue;
+			g = (batch.setG[m][n] ? batch.vg[m][n] : rxPar[m].LNAsets[n]);
+			d = (batch.setD[m][n] ? batch.vd[m][n] : rxPar[m].LNAsets[n+NSTAGES]);
+			if (g < VGMIN || g > VGMAX) {
+				sprintf(msg, "receiver %d stage %d gate %.3f V outside %.3f to %.3f V",
+						m+1, n+1, g, VGMIN, VGMAX);
+				return BATCHERRVAL;
+			}
+			if (d < VDMIN || d > VDMAX) {
+				sprintf(msg, "receiver %d stage %d drain %.3f V outside %.3f to %.3f V",
+						m+1, n+1, d, VDMIN, VDMAX);
+				return BATCHERRVAL;
+			}
+			if (d - g > VDGMAX) {
+				sprintf(msg, "receiver %d stage %d drain-gate %.3f V above %.3f V",
+						m+1, n+1, d - g, VDGMAX);
+				return BATCHERRVAL;
+			}
+		}
+	}
+	return 0;
+}
+
+/****************************************************************************************/
+/**
+  \brief Open an empty batch, discarding any staged set points.
+
+  \param  client  Requesting control client.
+  \return Zero, or BATCHERRVAL if another client has a batch open.
+*/
+int argus_batchBegin(int client)
+{
+	batchEnter();
+	if (batchOpen && batchOwner != client) {
+		OSCritLeave(&batchLock);
+		return BATCHERRVAL;
+	}
+	memset(&batch, 0, sizeof(batch));
+	batchOpen = 1;
+	batchOwner = client;
+	OSCritLeave(&batchLock);
+	return 0;
+}
+
+/**
+  \brief Stage a set point.
+
+  LNA set points need an LNA bias system and attenuators a DCM2.  Limits are
+  checked at commit, against the whole batch.
+
+  \param  client  Requesting control client.
+  \param  term  g or d for a gate or drain, a for a DCM2 attenuator.
+  \param  m     mth receiver or module.
+  \param  n     nth stage within a receiver, or 2*band + iq for an attenuator
+                (band 0 for A, 1 for B; iq 0 for I, 1 for Q).
+  \param  v     value in V, or attenuation in dB.
+  \return Zero on success, -1 for invalid selection, BATCHERRVAL if the
+          client has no batch open, WRONGBOX for the wrong hardware.
+*/
+int argus_batchStage(int client, char term, int m, int n, float v)
+{
+	char *set;
+
+	if ((term == 'a') == (foundLNAbiasSys != 0)) return WRONGBOX;
+	if (m < 0 || m >= NRX || n < 0 || n >= (term == 'a' ? 4 : NSTAGES)) return -1;
+	if (term != 'g' && term != 'd' && term != 'a') return -1;
+
+	batchEnter();
+	if (!batchOpen || batchOwner != client) {
+		OSCritLeave(&batchLock);
+		return BATCHERRVAL;
+	}
+	if (term == 'g') {
+		set = &batch.setG[m][n];
+		batch.vg[m][n] = v;
+	} else if (term == 'd') {
+		set = &batch.setD[m][n];
+		batch.vd[m][n] = v;
+	} else {
+		if (v < 0.) v = 0.;
+		if (v > MAXATTEN) v = MAXATTEN;
+		set = (char *)&batch.setA[n/2][n%2][m];
+		batch.atten[n/2][n%2][m] = (BYTE)round(v*2);
+	}
+	if (!*set) batch.n += 1;
+	*set = 1;
+	OSCritLeave(&batchLock);
+
+	return 0;
+}
+
+/**
+  \brief Check and apply the open batch.
+
+  Nothing is written unless every staged LNA set point is within limits.  On
+  success the batch is closed; a rejected batch stays open.
+
+  \param  client  Requesting control client.
+  \param  msg  output string, a description of the result.
+  \return Zero on success; BATCHERRVAL if the client has no batch open or
+          the set is out of limits; else the return value of
+          argus_setBiasBatch() or dcm2_setAttenBatch().
+*/
+int argus_batchCommit(int client, char *msg)
+{
+	int rtn, n;
+	char open;
+
+	batchEnter();
+	if (!batchOpen || batchOwner != client) {
+		open = batchOpen;
+		OSCritLeave(&batchLock);
+		sprintf(msg, (open ? "batch open by another client" : "no batch open"));
+		return BATCHERRVAL;
+	}
+	n = batch.n;
+	if (foundLNAbiasSys) {
+		rtn = batchCheckLNA(msg);
+		if (rtn) {
+			OSCritLeave(&batchLock);
+			return rtn;
+		}
+		rtn = (n ? argus_setBiasBatch(&batch) : 0);
+	} else {
+		rtn = (n ? dcm2_setAttenBatch(&batch) : 0);
+	}
+	if (rtn != I2CBUSERRVAL && rtn != FREEZEERRVAL && rtn != LNASEQBUSYVAL && rtn != LNAPWROFFVAL) {
+		batchOpen = 0;
+	}
+	open = batchOpen;
+	OSCritLeave(&batchLock);
+
+	if (open) sprintf(msg, "%d set points not applied, batch still open", n);
+	else if (rtn) sprintf(msg, "%d set points applied, %d writes failed", n, rtn);
+	else sprintf(msg, "%d set points applied", n);
+	return rtn;
+}
+
+/**
+  \brief Discard the client's open batch.
+
+  \param  client  Requesting control client.
+  \return Zero, or BATCHERRVAL if another client has the batch open.
+*/
+int argus_batchAbort(int client)
+{
+	int rtn = 0;
+
+	batchEnter();
+	if (batchOpen && batchOwner != client) rtn = BATCHERRVAL;
+	else batchOpen = 0;
+	OSCritLeave(&batchLock);
+	return rtn;
+}
+
+/**
+  \brief Discard the batch of a departing control client, if it has one open.
+
+  Called for every hardware variant; does nothing before argus_batchInit().
+
+  \param  client  Departing control client.
+*/
+void argus_batchRelease(int client)
+{
+	if (!batchReady) return;
+	batchEnter();
+	if (batchOpen && batchOwner == client) batchOpen = 0;
+	OSCritLeave(&batchLock);
+}
+
+/**
+  \brief Describe the batch.
+
+  \param  str  Output string.
+  \return Number of characters written.
+*/
+int argus_batchReport(char *str)
+{
+	int n;
+
+	batchEnter();
+	if (batchOpen) n = sprintf(str, "open by client %d, %d set points staged", batchOwner, batch.n);
+	else n = sprintf(str, "closed");
+	OSCritLeave(&batchLock);
+	return n;
+}
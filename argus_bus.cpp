@@ -0,0 +1,295 @@
+/**
+  \file
+  \author Andy Harris
+  \brief  I2C bus arbiter for Argus and DCM2 hardware.
+
+  All routines that talk on the I2C bus take it with i2cBusLock() and give it
+  back with i2cBusUnlock().  A caller that finds the bus taken waits, in task
+  priority order, for up to i2cBusWait ms before giving up with I2CBUSERRVAL.
+
+  The NetBurner uC/OS port can only change the priority of the calling task,
+  so inversion is bounded with a priority ceiling instead of inheritance: an
+  owner from below the service tasks (the monitor sampler) runs at I2CBUSPRIO
+  while it holds the bus.  Service and server tasks keep their priority, since
+  Service::createServer() may hand their slot to a new client meanwhile.
+
+  Locks nest: re-locking by the owner succeeds at once and is counted, and
+  the bus is released by the matching outermost unlock.  Unlocking by anyone
+  else is ignored.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ucos.h>
+#include <constants.h>
+
+#include "argus.h"
+#include "services.h"
+
+unsigned char i2cBusBusy = 1;       // 1 while the I2C bus is held (clears in i2cBusInit())
+unsigned int busLockCtr = 0;        // I2C successful bus lock request counter
+unsigned int busNoLockCtr = 0;      // I2C unsuccessful bus lock request counter
+unsigned int i2cBusWait = I2CBUSWAIT;  // maximum wait for the bus [ms]
+
+// Hold time statistics for one caller
+struct i2cBusCaller {
+	const char *who;       // caller name, as passed to i2cBusLock()
+	unsigned long n;       // successful locks
+	unsigned long waited;  // locks that had to wait
+	DWORD holdTicks;       // total hold time [ticks]
+	DWORD maxTicks;        // longest hold [ticks]
+};
+
+static OS_SEM busSem;                 // one count: the bus
+static char busReady = 0;             // set once busSem is initialized
+static OS_TCB *busOwner = 0;          // owner task, 0 if free
+static int busDepth = 0;              // owner's lock nesting depth
+static BYTE busOwnerPrio;             // owner priority before the ceiling
+static char busBoosted = 0;           // 1 when the owner runs at I2CBUSPRIO
+static OS_TCB *orphanTcb = 0;         // boosted owner displaced by i2cBusReset()
+static BYTE orphanPrio;               // its priority before the ceiling
+static DWORD busT0;                   // TimeTick when the owner took the bus
+static struct i2cBusCaller *busCaller;  // statistics entry of the owner
+
+static struct i2cBusCaller callers[I2CBUSNCALLERS];
+static unsigned long waitHist[I2CBUSNHIST];  // lock wait times, log2 tick bins
+static unsigned long waitTimeouts = 0;       // lock requests that gave up
+
+/****************************************************************************************/
+/**
+  \brief Find or add the statistics entry for a caller.
+
+  Names are compared by pointer; callers pass __FUNCTION__ or a string
+  literal.  The last entry collects everyone once the table is full.
+*/
+static struct i2cBusCaller *findCaller(const char *who)
+{
+	int i;
+	for (i = 0; i < I2CBUSNCALLERS-1 && callers[i].who; i++) {
+		if (callers[i].who == who) return &callers[i];
+	}
+	if (!callers[i].who) callers[i].who = (i < I2CBUSNCALLERS-1 ? who : "(other)");
+	return &callers[i];
+}
+
+/****************************************************************************************/
+/**
+  \brief Initialize the I2C bus arbiter.
+
+  Call at boot, before the first i2cBusLock().  The bus starts free.  Later
+  calls do nothing, since tasks may be holding or waiting for the bus.
+*/
+void i2cBusInit(void)
+{
+	if (busReady) return;
+	OSSemInit(&busSem, 1);
+	busOwner = 0;
+	busDepth = 0;
+	busBoosted = 0;
+	i2cBusBusy = 0;
+	busReady = 1;
+}
+
+/****************************************************************************************/
+/**
+  \brief Take the I2C bus.
+
+  Waits up to i2cBusWait ms for the bus; waiters are served highest priority
+  first.  Returns at once if the calling task already holds the bus; each
+  such nested lock needs its own i2cBusUnlock().
+
+  \param who Caller name for hold time statistics (use __FUNCTION__).
+  \return Zero when the bus is held, else I2CBUSERRVAL.
+*/
+int i2cBusLock(const char *who)
+{
+	OS_TCB *me = (OS_TCB *)OSTCBCur;
+	DWORD t0, wait, timeout;
+	int k;
+
+	if (!busReady) {busNoLockCtr += 1; return I2CBUSERRVAL;}
+	if (busOwner == me) {busDepth += 1; return 0;}  // already ours
+
+	t0 = TimeTick;
+	timeout = (i2cBusWait*TICKS_PER_SECOND + 999)/1000;
+	if (OSSemPend(&busSem, (timeout ? timeout : 1)) != OS_NO_ERR) {
+		busNoLockCtr += 1;
+		waitTimeouts += 1;
+		return I2CBUSERRVAL;
+	}
+	wait = TimeTick - t0;
+
+	busOwner = me;
+	busDepth = 1;
+	busOwnerPrio = me->OSTCBPrio;
+	busT0 = TimeTick;
+	busCaller = findCaller(who);
+	busCaller->n += 1;
+	if (wait) busCaller->waited += 1;
+	i2cBusBusy = 1;
+	busLockCtr += 1;
+
+	for (k = 0; k < I2CBUSNHIST-1 && (wait >> k); k++);
+	waitHist[k] += 1;
+
+	// low-priority owners run at the ceiling while holding the bus
+	busBoosted = (busOwnerPrio >= ZPEC_MONITOR_PRIO && OSChangePrio(I2CBUSPRIO) == OS_NO_ERR);
+
+	return 0;
+}
+
+/****************************************************************************************/
+/**
+  \brief Give back the I2C bus.
+
+  Does nothing unless the calling task holds the bus.  A nested unlock only
+  counts down; the outermost one frees the bus and drops the priority
+  ceiling.
+*/
+void i2cBusUnlock(void)
+{
+	OS_TCB *me = (OS_TCB *)OSTCBCur;
+	DWORD hold;
+	BYTE prio;
+	char boosted;
+
+	if (me == orphanTcb) {  // bus was taken away by i2cBusReset()
+		orphanTcb = 0;
+		OSChangePrio(orphanPrio);
+		return;
+	}
+	if (busOwner != me) return;
+	if (--busDepth > 0) return;
+
+	hold = TimeTick - busT0;
+	busCaller->holdTicks += hold;
+	if (hold > busCaller->maxTicks) busCaller->maxTicks = hold;
+
+	prio = busOwnerPrio;
+	boosted = busBoosted;
+	busOwner = 0;
+	busBoosted = 0;
+	i2cBusBusy = 0;
+	OSSemPost(&busSem);
+	if (boosted) OSChangePrio(prio);  // waiter, if any, runs from here
+}
+
+/****************************************************************************************/
+/**
+  \brief Free the I2C bus regardless of owner.
+
+  For bus recovery only.  The displaced owner's next i2cBusUnlock() restores
+  its priority.
+*/
+void i2cBusReset(void)
+{
+	OS_TCB *me = (OS_TCB *)OSTCBCur;
+
+	if (!busReady || !busOwner) return;
+	if (busOwner == me) {
+		busDepth = 1;
+		i2cBusUnlock();
+		return;
+	}
+	if (busBoosted) {
+		orphanTcb = busOwner;
+		orphanPrio = busOwnerPrio;
+	}
+	busOwner = 0;
+	busDepth = 0;
+	busBoosted = 0;
+	i2cBusBusy = 0;
+	OSSemPost(&busSem);
+}
+
+/****************************************************************************************/
+/**
+  \brief Hold the I2C bus on behalf of no task, for lock tests.
+
+  \param on 1 to take the bus, waiting as i2cBusLock() does; 0 to release it.
+  \return Zero on success, else I2CBUSERRVAL.
+*/
+int i2cBusTestHold(int on)
+{
+	static OS_TCB *const testOwner = (OS_TCB *)&busSem;  // matches no task
+
+	if (!busReady) return I2CBUSERRVAL;
+	if (on) {
+		if (busOwner == testOwner) return 0;
+		if (OSSemPend(&busSem, (i2cBusWait*TICKS_PER_SECOND + 999)/1000 + 1) != OS_NO_ERR) return I2CBUSERRVAL;
+		busOwner = testOwner;
+		busDepth = 1;
+		busCaller = findCaller("(lock test)");
+		busT0 = TimeTick;
+		i2cBusBusy = 1;
+	} else if (busOwner == testOwner) {
+		busOwner = 0;
+		busDepth = 0;
+		i2cBusBusy = 0;
+		OSSemPost(&busSem);
+	}
+	return 0;
+}
+
+/****************************************************************************************/
+/**
+  \brief Check whether the calling task holds the I2C bus.
+
+  \return 1 if it does, else 0.
+*/
+int i2cBusHeld(void)
+{
+	return (busOwner == (OS_TCB *)OSTCBCur);
+}
+
+/****************************************************************************************/
+/**
+  \brief Name of the current I2C bus owner, as passed to i2cBusLock().
+
+  \return Owner name, or 0 if the bus is free.
+*/
+const char *i2cBusOwner(void)
+{
+	return (busOwner ? busCaller->who : 0);
+}
+
+/****************************************************************************************/
+/**
+  \brief Clear I2C bus wait and hold time statistics.
+*/
+void i2cBusClearStats(void)
+{
+	const char *who = (busOwner ? busCaller->who : 0);
+
+	memset(callers, 0, sizeof(callers));
+	memset(waitHist, 0, sizeof(waitHist));
+	waitTimeouts = 0;
+	if (who) busCaller = findCaller(who);  // keep the current hold accountable
+}
+
+/****************************************************************************************/
+/**
+  \brief Format I2C bus arbiter state and statistics.
+
+  \param str Output string; needs room for about 120 characters per caller.
+  \return Number of characters written.
+*/
+int i2cBusReport(char *str)
+{
+	static const char *hname[I2CBUSNHIST] = {"0", "1", "2-3", "4-7", "8-15", "16-31", "32-63", ">=64"};
+	int i, n;
+
+	n = sprintf(str, "  owner: %s, max wait %u ms, priority ceiling %d\r\n"
+			"  lock wait histogram [ticks of %d ms], timeouts %lu:\r\n   ",
+			(busOwner ? busCaller->who : "none"), i2cBusWait, I2CBUSPRIO,
+			1000/TICKS_PER_SECOND, waitTimeouts);
+	for (i = 0; i < I2CBUSNHIST; i++) n += sprintf(&str[n], " %s:%lu", hname[i], waitHist[i]);
+	n += sprintf(&str[n], "\r\n  %-26s %8s %8s %10s %8s\r\n", "caller", "locks", "waited", "mean [ms]", "max [ms]");
+	for (i = 0; i < I2CBUSNCALLERS && callers[i].who; i++) {
+		n += sprintf(&str[n], "  %-26s %8lu %8lu %10.1f %8lu\r\n", callers[i].who, callers[i].n, callers[i].waited,
+				(callers[i].n ? (float)callers[i].holdTicks*1000./TICKS_PER_SECOND/callers[i].n : 0.),
+				callers[i].maxTicks*1000/TICKS_PER_SECOND);
+	}
+	return n;
+}
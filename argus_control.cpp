@@ -8,20 +8,17 @@
 
 #include "argus.h"
 #include "control.h"
+#include "i2csim.h"
+#include "services.h"
+#include "io.h"
 #include "math.h"
 
-// temporary strings for JSON output work
-char outStr[8192] = {0};
-char str0[512] = {0};
-char str1[512] = {0};
-char str2[512] = {0};
-char str3[512] = {0};
-char str4[512] = {0};
-char str5[512] = {0};
-char str6[512] = {0};
-char str7[512] = {0};
-char str8[512] = {0};
-char str9[512] = {0};
+// LNA monitor point JSON names, in output order, and their LNAmonPts[] indices
+static const char *lnaMonNames[] = {"vg1", "vd1", "id1", "vg2", "vd2", "id2"};
+static const int lnaMonIdx[] = {0, 2, 4, 1, 3, 5};
+
+// fill value for LNA bias arrays while LNA power is off
+static const float lnaOffFill = 99.;
 
 // names for cryostat test points
 //char *cnames[] = {"T0", "T1", "T2", "T3", "T4", "T5", "Pressure"};
@@ -72,6 +69,41 @@ char *vanePos[] = {"OBS     ",       // number of entries should match 0..VANEFL
 // decimal points for display in exexArgusMonPts
 int d1 = 1, d2 = 2;
 
+/********************************************************************************/
+/**
+  \brief Write monitor snapshot sequence number and age as JSON members.
+
+  \param js   JSON writer.
+  \param seq  Snapshot sequence number.
+  \param tick Snapshot time stamp [ticks].
+*/
+static void snapStamp(zpec_json_t *js, unsigned long seq, DWORD tick)
+{
+	zpec_json_member(js, "\"snapSeq\":[%lu]", seq);
+	zpec_json_member(js, "\"snapAge\":[%.2f]", (float)(TimeTick - tick)/TICKS_PER_SECOND);
+}
+
+#ifdef SIMULATE
+/********************************************************************************/
+/**
+  \brief Format one line of simulated I2C bus statistics.
+
+  \param str   Output string.
+  \param name  Label for the line.
+  \param rtn   Return value of the measured function.
+  \return Number of characters written.
+*/
+static int simBenchLine(char *str, const char *name, int rtn)
+{
+	i2csim_stats_t st;
+	i2csim_getStats(&st);
+	return sprintf(str, "  %-26s %5u transactions (%u sends, %u reads), %5u bytes, %3u selects, "
+			"%u NACKs, %8.1f ms, rtn %d\r\n",
+			name, st.sends + st.reads, st.sends, st.reads, st.bytes, st.selects, st.nacks,
+			(float)st.busUs/1000., rtn);
+}
+#endif
+
 /********************************************************************************/
 /**
   \brief Argus test command.
@@ -313,7 +345,23 @@ void Correlator::execArgusEngr(return_type status, argument_type arg)
   "    bypassLNAlims   y   magic number y to bypass soft limits on LNA biases.\r\n"
   "    dec             n   n decimal places for MON LNA, MON MIX, MON SETS display\r\n"
   "    clearBus            clear I2C bus busy bit, open main bus switches.\r\n"
-  "    clrCtr              clear counters for I2C bus and freeze/thaw.\r\n"
+  "    clrCtr              clear counters for I2C bus and freeze/thaw, and I2C trace.\r\n"
+  "    bus                 I2C bus arbiter owner, lock wait and hold statistics.\r\n"
+  "    busWait         t   wait at most t ms for the I2C bus before giving up.\r\n"
+  "    trace               I2C transaction trace summary by caller and address.\r\n"
+  "    trace           x   x = 1 to record I2C transactions, 0 to stop.\r\n"
+  "    sampler         t   monitor sampler sweep period t in ms; 0 stops background\r\n"
+  "                        sweeps and JSON queries sweep on demand.\r\n"
+  "    simClk          f   simulated I2C bus clock f in Hz (SIMULATE builds).\r\n"
+  "    spiBurst        x   x = 1 for several DCM2 SPI clock edges per I2C write, 0 for one.\r\n"
+  "    seqEarly        x   x = 1 to end LNA power sequencing waits once the rails are steady.\r\n"
+  "    attenBcast      x   x = 1 to broadcast DCM2 attenuator settings to all modules at once.\r\n"
+  "    spiBench            compare DCM2 SPI transactions per sample, one edge per write\r\n"
+  "                        against burst writes (DCM2 hardware; rewrites one attenuator).\r\n"
+  "    fmtBench            time sprintf against zpec_print_float on present LNA and\r\n"
+  "                        DCM2 monitor values, and check that their outputs agree.\r\n"
+  "    simBench            time monitor sweeps and presets on the simulated I2C bus\r\n"
+  "                        (SIMULATE builds; overwrites simulated state).\r\n"
 		  ;
 
   if (!arg.help) {
@@ -335,6 +383,17 @@ void Correlator::execArgusEngr(return_type status, argument_type arg)
     			d2 = 2;
     		}
       	}
+      	else if (!strcasecmp(kw, "busWait")) i2cBusWait = (val > 0 ? val : 0);
+      	else if (!strcasecmp(kw, "trace")) i2cTraceOn = (val ? 1 : 0);
+      	else if (!strcasecmp(kw, "spiBurst")) bexSpiBurst = (val ? 1 : 0);
+      	else if (!strcasecmp(kw, "attenBcast")) dcm2AttenBcast = (val ? 1 : 0);
+      	else if (!strcasecmp(kw, "seqEarly")) lnaSeqEarly = (val ? 1 : 0);
+      	else if (!strcasecmp(kw, "sampler")) samplerPeriod = (val > 0 ? val : 0);
+      	else if (!strcasecmp(kw, "simClk")) {
+#ifdef SIMULATE
+      		i2csim_setClock(val > 0 ? (unsigned int)val : 0);
+#endif
+      	}
     	else longHelp(status, usage, &Correlator::execArgusEngr);
       	sprintf(status,"\r");
       	}
@@ -351,8 +410,135 @@ void Correlator::execArgusEngr(return_type status, argument_type arg)
         	  freezeCtr = 0;
         	  thawCtr = 0;
         	  freezeErrCtr = 0;
+        	  i2cSelSkipCtr = 0;
+        	  i2cBusClearStats();
+        	  i2cTraceClear();
               sprintf(status,"\r");
           }
+    	  else if (!strcasecmp(kw, "bus")) {
+    		  int n = sprintf(status, "%sI2C bus arbiter:\r\n", statusOK);
+    		  i2cBusReport(&status[n]);
+    	  }
+    	  else if (!strcasecmp(kw, "trace")) {
+    		  unsigned n = sprintf(status, "%sI2C transaction trace:\r\n", statusOK);
+    		  i2cTraceReport(arg.fdWrite, &status[n], ControlService::maxLine - 200 - n);
+    	  }
+    	  else if (!strcasecmp(kw, "spiBench")) {
+    		  // one module for the AD7860 and HMC624, the main board for the AD7814
+    		  int m, rtn = 0;
+    		  char *ab = (char *)"a";
+    		  for (m = 0; m < NRX && dcm2Apar.status[m] && dcm2Bpar.status[m]; m++);
+    		  if (m < NRX && dcm2Apar.status[m]) ab = (char *)"b";
+    		  if (foundLNAbiasSys || m == NRX) {
+    			  sprintf(status, "%sspiBench needs DCM2 hardware with at least one module present.\r\n", statusERR);
+    		  } else {
+    			  BYTE saveBurst = bexSpiBurst;
+    			  float atten = (ab[0] == 'a' ? dcm2Apar.attenI[m] : dcm2Bpar.attenI[m])/2.;
+    			  unsigned long x0, t0, nx[3][2], us[3][2];
+    			  int mode;
+    			  for (mode = 0; mode < 2; mode++) {
+    				  bexSpiBurst = mode;
+    				  x0 = i2cXferCtr; t0 = zpec_usclock();
+    				  dcm2_readOneModTotPwr(m, ab, (char *)"i");
+    				  nx[0][mode] = i2cXferCtr - x0; us[0][mode] = ZPEC_USCLOCK_US(zpec_usclock() - t0);
+    				  x0 = i2cXferCtr; t0 = zpec_usclock();
+    				  rtn |= dcm2_readMBtemp();
+    				  nx[1][mode] = i2cXferCtr - x0; us[1][mode] = ZPEC_USCLOCK_US(zpec_usclock() - t0);
+    				  x0 = i2cXferCtr; t0 = zpec_usclock();
+    				  rtn |= dcm2_setAtten(m, ab, (char *)"i", atten);
+    				  nx[2][mode] = i2cXferCtr - x0; us[2][mode] = ZPEC_USCLOCK_US(zpec_usclock() - t0);
+    			  }
+    			  bexSpiBurst = saveBurst;
+    			  sprintf(status, "%sDCM2 SPI I2C transactions (and time) per sample, module %d%s, "
+    					  "switch selects included:\r\n"
+    					  "  %-22s %12s %12s\r\n"
+    					  "  %-22s %5lu %6lu us %5lu %6lu us\r\n"
+    					  "  %-22s %5lu %6lu us %5lu %6lu us\r\n"
+    					  "  %-22s %5lu %6lu us %5lu %6lu us\r\n",
+    					  (rtn ? statusERR : statusOK), m+1, ab, "", "edge/write", "burst",
+    					  "AD7860 power detector", nx[0][0], us[0][0], nx[0][1], us[0][1],
+    					  "AD7814 temperature", nx[1][0], us[1][0], nx[1][1], us[1][1],
+    					  "HMC624 attenuator", nx[2][0], us[2][0], nx[2][1], us[2][1]);
+    		  }
+    	  }
+    	  else if (!strcasecmp(kw, "fmtBench")) {
+    		  // LNA monitor points at 3 decimals, DCM2 band A detectors and temperatures at 5
+    		  static float v[NRX*9];
+    		  char a[40], b[40];
+    		  unsigned long t0, us[2];
+    		  int i, k, nv = 0, diff = 0;
+    		  for (i = 0; i < NRX; i++) {
+    			  for (k = 0; k < 6; k++) v[nv++] = rxPar[i].LNAmonPts[k];
+    			  v[nv++] = dcm2Apar.powDetI[i];
+    			  v[nv++] = dcm2Apar.powDetQ[i];
+    			  v[nv++] = dcm2Apar.bTemp[i];
+    		  }
+    		  t0 = zpec_usclock();
+    		  for (i = 0; i < nv; i++) sprintf(a, (i%9 < 6 ? "%.3f" : "%.5f"), v[i]);
+    		  us[0] = ZPEC_USCLOCK_US(zpec_usclock() - t0);
+    		  t0 = zpec_usclock();
+    		  for (i = 0; i < nv; i++) zpec_print_float(b, v[i], (i%9 < 6 ? 3 : 5));
+    		  us[1] = ZPEC_USCLOCK_US(zpec_usclock() - t0);
+    		  for (i = 0; i < nv; i++) {
+    			  sprintf(a, (i%9 < 6 ? "%.3f" : "%.5f"), v[i]);
+    			  zpec_print_float(b, v[i], (i%9 < 6 ? 3 : 5));
+    			  if (strcmp(a, b)) diff += 1;
+    		  }
+    		  sprintf(status, "%sFormatting %d monitor values (%d LNA at 3 decimals, %d DCM2 at 5):\r\n"
+    				  "  %-17s %6lu us (%.1f us per value)\r\n"
+    				  "  %-17s %6lu us (%.1f us per value), %d outputs differ\r\n",
+    				  (diff ? statusERR : statusOK), nv, NRX*6, NRX*3,
+    				  "sprintf", us[0], (float)us[0]/nv,
+    				  "zpec_print_float", us[1], (float)us[1]/nv, diff);
+    	  }
+    	  else if (!strcasecmp(kw, "simBench")) {
+#ifdef SIMULATE
+    		  // run the bias and DCM2 paths in turn on the simulated bus, all modules present
+    		  flash_t flashData;
+    		  zpec_readFlash(&flashData);
+    		  i2csim_latency_t lat;
+    		  i2csim_getLatency(&lat);
+    		  int saveBox = foundLNAbiasSys, savePwr = lnaPwrState;
+    		  BYTE saveA[NRX], saveB[NRX];
+    		  memcpy(saveA, dcm2Apar.status, NRX);
+    		  memcpy(saveB, dcm2Bpar.status, NRX);
+
+    		  int rtn, n = sprintf(status, "%sSimulated I2C bus at %u Hz: %u us per byte, %u us per transaction\r\n",
+    				  statusOK, lat.clkHz, lat.byteUs, lat.startUs);
+
+    		  i2csim_reset(1);
+    		  foundLNAbiasSys = 1;
+    		  i2cSwitchInvalidate();
+    		  lnaPwrState = 1;
+    		  i2csim_resetStats();
+    		  rtn = argus_readAllSystemADCs();
+    		  n += simBenchLine(&status[n], "argus_readAllSystemADCs", rtn);
+    		  i2csim_resetStats();
+    		  rtn = comap_presets(&flashData);
+    		  n += simBenchLine(&status[n], "comap_presets (bias)", rtn);
+
+    		  i2csim_reset(0);
+    		  foundLNAbiasSys = 0;
+    		  i2cSwitchInvalidate();
+    		  memset(dcm2Apar.status, 0, NRX);
+    		  memset(dcm2Bpar.status, 0, NRX);
+    		  i2csim_resetStats();
+    		  rtn = dcm2_readAllModTotPwr();
+    		  n += simBenchLine(&status[n], "dcm2_readAllModTotPwr", rtn);
+    		  i2csim_resetStats();
+    		  rtn = comap_presets(&flashData);
+    		  n += simBenchLine(&status[n], "comap_presets (DCM2)", rtn);
+
+    		  memcpy(dcm2Apar.status, saveA, NRX);
+    		  memcpy(dcm2Bpar.status, saveB, NRX);
+    		  foundLNAbiasSys = saveBox;
+    		  lnaPwrState = savePwr;
+    		  i2csim_reset(saveBox);
+    		  i2cSwitchInvalidate();
+#else
+    		  sprintf(status, "%sI2C bus simulator requires a SIMULATE build.\r\n", statusERR);
+#endif
+    	  }
     	  else longHelp(status, usage, &Correlator::execArgusEngr);
       }
       else {
@@ -365,22 +551,28 @@ void Correlator::execArgusEngr(return_type status, argument_type arg)
      				"  i2cBusBusy = %d, freeze = %u\r\n"
      				"  successful and unsuccessful I2C bus lock requests since clrCtr = %u and %u\r\n"
      				"  freeze and thaw requests since clrCtr = %u and %u, denials while frozen = %u\r\n"
+     				"  I2C switch selects skipped as already set since clrCtr = %u\r\n"
+     				"  monitor sampler period = %u ms, sweep %lu took %u ms\r\n"
      				"  bypassLNApsLim = %d\r\n"
      				"  bypassLNAlims = %d\r\n"
      				"  decimal points: %d, %d\r\n"
      				"  power control PIO byte = 0x%02x\r\n"
      				"  version %s\r\n",
      				statusOK, i2cBusBusy, freezeSys,
-     				busLockCtr, busNoLockCtr, freezeCtr, thawCtr, freezeErrCtr,
+     				busLockCtr, busNoLockCtr, freezeCtr, thawCtr, freezeErrCtr, i2cSelSkipCtr,
+     				samplerPeriod, samplerSeq, samplerSweepMs,
      				lnaPSlimitsBypass, lnaLimitsBypass, d1, d2, argus_lnaPowerPIO(), VER);
     	} else {
     		sprintf(status, "%sEngineering report, DCM2 system:\r\n"
     				"  i2cBusBusy = %d, freeze = %u\r\n"
     				"  successful and unsuccessful I2C bus lock requests since clrCtr = %u and %u\r\n"
     				"  freeze and thaw requests since clrCtr = %u and %u, denials while frozen = %u\r\n"
+    				"  I2C switch selects skipped as already set since clrCtr = %u\r\n"
+    				"  monitor sampler period = %u ms, sweep %lu took %u ms\r\n"
     				"  version %s\r\n",
     				statusOK, i2cBusBusy, freezeSys,
-    				busLockCtr, busNoLockCtr, freezeCtr, thawCtr, freezeErrCtr, VER);
+    				busLockCtr, busNoLockCtr, freezeCtr, thawCtr, freezeErrCtr, i2cSelSkipCtr,
+    				samplerPeriod, samplerSeq, samplerSweepMs, VER);
     	}
     }
   } else {
@@ -475,7 +667,7 @@ void Correlator::execArgusDrain(return_type status, argument_type arg)
     		// convert from user's 1-base to code's 0-base
     		OSTimeDly(CMDDELAY);
     		int rtn = argus_setLNAbias("d", m-1, n-1, v, 0);
-    		if (rtn == -10) {
+    		if (rtn == LNAPWROFFVAL) {
         		sprintf(status, "%sLNA cards are not powered, returned status %d.\r\n",
         				statusERR, rtn);
     		} else {
@@ -529,7 +721,7 @@ void Correlator::execJArgusDrain(return_type status, argument_type arg)
     		// convert from user's 1-base to code's 0-base
     		OSTimeDly(CMDDELAY);
     		int rtn = argus_setLNAbias("d", m-1, n-1, v, 0);
-    		if (rtn == -10) {
+    		if (rtn == LNAPWROFFVAL) {
         		sprintf(status, "{\"biasD\":{\"cmdOK\":false}}\r\n"); //LNA cards are not powered
     		} else {
         		sprintf(status, "{\"biasD\":{\"cmdOK\":%s}}\r\n", (rtn==0 ? "true" : "false"));
@@ -581,7 +773,7 @@ void Correlator::execArgusGate(return_type status, argument_type arg)
     		// convert from user's 1-base to code's 0-base
     		OSTimeDly(CMDDELAY);
     		int rtn = argus_setLNAbias("g", m-1, n-1, v, 0);
-    		if (rtn == -10) {
+    		if (rtn == LNAPWROFFVAL) {
         		sprintf(status, "%sLNA cards are not powered, returned status %d.\r\n",
         				statusERR, rtn);
     		} else {
@@ -636,7 +828,7 @@ void Correlator::execJArgusGate(return_type status, argument_type arg)
     		// convert from user's 1-base to code's 0-base
     		OSTimeDly(CMDDELAY);
     		int rtn = argus_setLNAbias("g", m-1, n-1, v, 0);
-    		if (rtn == -10) {
+    		if (rtn == LNAPWROFFVAL) {
         		sprintf(status, "{\"biasG\":{\"cmdOK\":false}}\r\n"); // LNA cards are not powered
     		} else {
         		sprintf(status, "{\"biasG\":{\"cmdOK\":%s}}\r\n", (rtn==0 ? "true" : "false"));
@@ -919,7 +1111,7 @@ void Correlator::execArgusSetAll(return_type status, argument_type arg)
     	OSTimeDly(CMDDELAY);
    		sscanf(act, "%f", &v);
    		int rtn = argus_setAllBias(inp, v, 0);
-    	if (rtn == -10) {
+    	if (rtn == LNAPWROFFVAL) {
         	sprintf(status, "%sLNA cards are not powered, returned status %d.\r\n",
         			statusERR, rtn);
     	} else {
@@ -994,7 +1186,7 @@ void Correlator::execJArgusSetAll(return_type status, argument_type arg)
     	OSTimeDly(CMDDELAY);
    		sscanf(act, "%f", &v);
    		int rtn = argus_setAllBias(inp, v, 0);
-    	if (rtn == -10) {
+    	if (rtn == LNAPWROFFVAL) {
     		sprintf(status, "{\"all%c\": {\"cmdOK\":false}}\r\n", toupper(inp[0]));  //LNA cards are not powered
     	} else {
     		sprintf(status, "{\"all%c\": {\"cmdOK\":%s}}\r\n",
@@ -1058,13 +1250,27 @@ void Correlator::execJCOMAPcryo(return_type status, argument_type arg)
   "  Return cryostat monitor point values in JSON format.\r\n";
 
   if (!arg.help && !arg.str) {
-	  int rtn = argus_readThermADCs();
-	  sprintf(status, "{\"cryostat\":{\"cmdOK\":%s, \"temps\":"
-			  "[%.1f,%.1f,%.1f,%.1f,%.1f,%.1f], \"press\":[%.6f]}}\r\n",
-			  	(rtn==0 ? "true" : "false"), cryoPar.cryoTemps[0], cryoPar.cryoTemps[1],
-	    		cryoPar.cryoTemps[2], cryoPar.cryoTemps[3], cryoPar.cryoTemps[4],
-	    		cryoPar.cryoTemps[5],
-	    		(cryoPar.auxInputs[0] > 1 ? powf(10., cryoPar.auxInputs[0]-6.) : 0.));
+	  zpec_json_t js;
+	  struct cryostatParams cryo;
+	  unsigned long seq;
+	  DWORD tick;
+	  int rtn;
+
+	  // copy from the snapshot; streaming may block on the socket
+	  const struct argusSnapshot *sp = argus_lockSnapshot();
+	  cryo = sp->cryo;
+	  rtn = sp->rtnTherm;
+	  seq = sp->seq;
+	  tick = sp->tick;
+	  argus_unlockSnapshot();
+
+	  zpec_json_open(&js, arg.fdWrite, status, ControlService::maxLine - 200, "cryostat", "execJCOMAPcryo");
+	  zpec_json_member(&js, "\"cmdOK\":%s", (rtn==0 ? "true" : "false"));
+	  snapStamp(&js, seq, tick);
+	  zpec_json_floats(&js, "temps", "%.1f", cryo.cryoTemps, 6, sizeof(float));
+	  zpec_json_member(&js, "\"press\":[%.6f]",
+	    		(cryo.auxInputs[0] > 1 ? powf(10., cryo.auxInputs[0]-6.) : 0.));
+	  zpec_json_close(&js, "\r\n");
   } else {
     	longHelp(status, usage, &Correlator::execJCOMAPcryo);
   }
@@ -1162,15 +1368,19 @@ void Correlator::execArgusPwrCtrl(return_type status, argument_type arg)
         // Execute the command.
       	if (!strcmp(state, "1") || !strcasecmp(state, "ON")) {
       		OSTimeDly(CMDDELAY);
-      		int rtn = argus_lnaPower(1);
-            sprintf(status, "%sLNA power commanded on, status %d.\r\n",
+      		int rtn = argus_lnaPowerStart(1);
+            int n = zpec_sprintf(status, "%sLNA power commanded on, status %d, ",
                              (rtn==0 ? statusOK : statusERR), rtn);
+            n += argus_lnaSeqReport(&status[n]);
+            zpec_sprintf(&status[n], ".\r\n");
       	}
       	else if (!strcmp(state, "0") || !strcasecmp(state, "OFF")) {
       		OSTimeDly(CMDDELAY);
-      		int rtn = argus_lnaPower(0);
-            sprintf(status, "%sLNA power commanded off, status %d.\r\n",
+      		int rtn = argus_lnaPowerStart(0);
+            int n = zpec_sprintf(status, "%sLNA power commanded off, status %d, ",
                              (rtn==0 ? statusOK : statusERR), rtn);
+            n += argus_lnaSeqReport(&status[n]);
+            zpec_sprintf(&status[n], ".\r\n");
       	}
       	else {
       		longHelp(status, usage, &Correlator::execArgusPwrCtrl);
@@ -1179,6 +1389,8 @@ void Correlator::execArgusPwrCtrl(return_type status, argument_type arg)
     } else {
       // Command called without arguments; write LNA state
     	int rtn = 0;
+    	char seq[40];
+    	argus_lnaSeqReport(seq);
     	if (lnaPwrState) {
     		OSTimeDly(CMDDELAY);
     		rtn += argus_readPwrADCs();
@@ -1186,7 +1398,7 @@ void Correlator::execArgusPwrCtrl(return_type status, argument_type arg)
     		rtn += argus_readLNAbiasADCs("vd");
     		rtn += argus_readLNAbiasADCs("id");
 
-    		sprintf(status, "%sLNA power state %s.\r\nSupplies: +15V: %5.2f V; "
+    		zpec_sprintf(status, "%sLNA power state %s, sequencer %s.\r\nSupplies: +15V: %5.2f V; "
 				  "-15V: %5.2f V; +5V: %5.2f V\r\n"
 				  "Voltages in [V], currents in [mA]\r\n\r\n"
 	      			  "          1               2               3               4\r\n"
@@ -1209,7 +1421,7 @@ void Correlator::execArgusPwrCtrl(return_type status, argument_type arg)
 	      			  "VG: %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f\r\n"
 	      			  "VD: %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f\r\n"
 	      			  "ID: %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f\r\n\r\n",
-	      			  (rtn==0 ? statusOK : statusERR), (lnaPwrState==1 ? "ON" : "OFF"),
+	      			  (rtn==0 ? statusOK : statusERR), (lnaPwrState==1 ? "ON" : "OFF"), seq,
 	      			  pwrCtrlPar[2], pwrCtrlPar[1], pwrCtrlPar[0],  //pv, nv, vds
 	      			  d2, rxPar[0].LNAmonPts[0], d2, rxPar[0].LNAmonPts[1], d2, rxPar[1].LNAmonPts[0], d2, rxPar[1].LNAmonPts[1],
 	      			  d2, rxPar[2].LNAmonPts[0], d2, rxPar[2].LNAmonPts[1], d2, rxPar[3].LNAmonPts[0], d2, rxPar[3].LNAmonPts[1],
@@ -1247,9 +1459,9 @@ void Correlator::execArgusPwrCtrl(return_type status, argument_type arg)
 	      			  d1, rxPar[18].LNAmonPts[4], d1, rxPar[18].LNAmonPts[5], d1, rxPar[19].LNAmonPts[4], d1, rxPar[19].LNAmonPts[5]);
  		  } else {
  	    		rtn = argus_readPwrADCs();
-		   		sprintf(status, "%sLNA power state %s.\r\nSupplies: +15V: %5.2f V; "
+		   		zpec_sprintf(status, "%sLNA power state %s, sequencer %s.\r\nSupplies: +15V: %5.2f V; "
  						  "-15V: %5.2f V; +5V: %5.2f V\r\n",
- 		    		  (rtn==0 ? statusOK : statusERR), (lnaPwrState==1 ? "ON" : "OFF"),
+ 		    		  (rtn==0 ? statusOK : statusERR), (lnaPwrState==1 ? "ON" : "OFF"), seq,
  		    		  pwrCtrlPar[2], pwrCtrlPar[1], pwrCtrlPar[0]);
  		  }
     }
@@ -1288,18 +1500,14 @@ void Correlator::execJCOMAPlna(return_type status, argument_type arg)
         sprintf(status, "{\"lna\": {\"cmdOK\":false}}\r\n");
       } else {
         // Execute the command.
-      	if (!strcmp(state, "1") || !strcasecmp(state, "ON")) {
+      	if (!strcmp(state, "1") || !strcasecmp(state, "ON") || !strcmp(state, "0") || !strcasecmp(state, "OFF")) {
       		OSTimeDly(CMDDELAY);
-      		int rtn = argus_lnaPower(1);
-            sprintf(status, "{\"lna\": {\"cmdOK\":%s, \"LNAon\": [%.1f]}}\r\n",
-            		(rtn==0 ? "true" : "false"), (lnaPwrState && !rtn ? 1.0 : 0.0));
+      		int rtn = argus_lnaPowerStart((state[0] == '1' || !strcasecmp(state, "ON")) ? 1 : 0);
+      		char seq[40];
+      		argus_lnaSeqReport(seq);
+            sprintf(status, "{\"lna\": {\"cmdOK\":%s, \"LNAon\": [%.1f], \"lnaSeq\":\"%s\"}}\r\n",
+            		(rtn==0 ? "true" : "false"), (lnaPwrState && !rtn ? 1.0 : 0.0), seq);
       	}
-      	else if (!strcmp(state, "0") || !strcasecmp(state, "OFF")) {
-      		OSTimeDly(CMDDELAY);
-      		int rtn = argus_lnaPower(0);
-            sprintf(status, "{\"lna\": {\"cmdOK\":%s, \"LNAon\": [%.1f]}}\r\n",
-            		(rtn==0 ? "true" : "false"), (lnaPwrState && !rtn ? 1.0 : 0.0));
-     	}
       	else {
       		longHelp(status, usage, &Correlator::execJCOMAPlna);
       	}
@@ -1308,70 +1516,45 @@ void Correlator::execJCOMAPlna(return_type status, argument_type arg)
     } else {
       // Command called without arguments; write LNA state
 
-    	int rtn = 0;
-
-    	if (lnaPwrState) {
-    		OSTimeDly(CMDDELAY);
-    		rtn = argus_readPwrADCs();
-    		rtn += argus_readLNAbiasADCs("vg");
-    		rtn += argus_readLNAbiasADCs("vd");
-    		rtn += argus_readLNAbiasADCs("id");
+    	const struct argusSnapshot *sp;
+    	zpec_json_t js;
+    	char seq[40];
+    	// only the reported points, by name then receiver: 6*JNRX floats (480 bytes)
+    	float pwrCtrl[sizeof(sp->pwrCtrl)/sizeof(sp->pwrCtrl[0])],
+    	      mon[sizeof(lnaMonIdx)/sizeof(lnaMonIdx[0])][JNRX];
+    	unsigned long snapSeq;
+    	DWORD tick;
+    	int i, j, pwrState;
+
+    	// copy from the snapshot; streaming may block on the socket
+    	sp = argus_lockSnapshot();
+    	int rtn = sp->rtnLNA;
+    	pwrState = sp->lnaPwrState;
+    	memcpy(pwrCtrl, sp->pwrCtrl, sizeof(pwrCtrl));
+    	for (i=0; i<6; i++) {
+    		for (j=0; j<JNRX; j++) mon[i][j] = sp->rx[j].LNAmonPts[lnaMonIdx[i]];
     	}
-
-		int i, n0, n1, n2, n3, n4, n5;
-    	int n = sprintf(outStr, "{\"lna\": {\"cmdOK\":%s, \"LNAon\": [%.1f], "
-					"\"powSupp\": [%.1f,%.1f,%.1f], \"Tchassis\": [%.2f], ",
-					(rtn==0 && lnaPwrState==1 ? "true" : "false"), (lnaPwrState && !rtn ? 1.0 : 0.0),
-					pwrCtrlPar[2], pwrCtrlPar[1], pwrCtrlPar[0], pwrCtrlPar[8]);
-
-	    if (lnaPwrState) {
-
-    		n0 = sprintf(str0, "\"vg1\":[%.3f", rxPar[0].LNAmonPts[0]);
-    		n1 = sprintf(str1, "\"vd1\":[%.3f", rxPar[0].LNAmonPts[2]);
-    		n2 = sprintf(str2, "\"id1\":[%.3f", rxPar[0].LNAmonPts[4]);
-    		n3 = sprintf(str3, "\"vg2\":[%.3f", rxPar[0].LNAmonPts[1]);
-    		n4 = sprintf(str4, "\"vd2\":[%.3f", rxPar[0].LNAmonPts[3]);
-    		n5 = sprintf(str5, "\"id2\":[%.3f", rxPar[0].LNAmonPts[5]);
-    		for (i=1; i<JNRX; i++){
-        		n0 += sprintf(&str0[n0], ",%.3f", rxPar[i].LNAmonPts[0]);
-        		n1 += sprintf(&str1[n1], ",%.3f", rxPar[i].LNAmonPts[2]);
-        		n2 += sprintf(&str2[n2], ",%.3f", rxPar[i].LNAmonPts[4]);
-        		n3 += sprintf(&str3[n3], ",%.3f", rxPar[i].LNAmonPts[1]);
-        		n4 += sprintf(&str4[n4], ",%.3f", rxPar[i].LNAmonPts[3]);
-        		n5 += sprintf(&str5[n5], ",%.3f", rxPar[i].LNAmonPts[5]);
+    	snapSeq = sp->seq;
+    	tick = sp->tick;
+    	argus_unlockSnapshot();
+
+    	zpec_json_open(&js, arg.fdWrite, status, ControlService::maxLine - 200, "lna", "execJCOMAPlna");
+    	zpec_json_member(&js, "\"cmdOK\":%s", (rtn==0 && pwrState==1 ? "true" : "false"));
+    	zpec_json_member(&js, "\"LNAon\": [%.1f]", (pwrState && !rtn ? 1.0 : 0.0));
+    	zpec_json_member(&js, "\"powSupp\": [%.1f,%.1f,%.1f]", pwrCtrl[2], pwrCtrl[1], pwrCtrl[0]);
+    	zpec_json_member(&js, "\"Tchassis\": [%.2f]", pwrCtrl[8]);
+    	snapStamp(&js, snapSeq, tick);
+    	argus_lnaSeqReport(seq);
+    	zpec_json_member(&js, "\"lnaSeq\":\"%s\"", seq);
+
+    	for (i=0; i<6; i++) {
+    		if (pwrState) {
+    			zpec_json_floats(&js, lnaMonNames[i], "%.3f", mon[i], JNRX, sizeof(mon[i][0]));
+    		} else {
+    			zpec_json_floats(&js, lnaMonNames[i], "%.1f", &lnaOffFill, JNRX, 0);
     		}
-    		n0 += sprintf(&str0[n0], "]");
-    		n1 += sprintf(&str1[n1], "]");
-    		n2 += sprintf(&str2[n2], "]");
-    		n3 += sprintf(&str3[n3], "]");
-    		n4 += sprintf(&str4[n4], "]");
-    		n5 += sprintf(&str5[n5], "]");
-
- 		  } else {
- 			rtn = argus_readPwrADCs();
- 			n0 = sprintf(str0, "\"vg1\":[99.0");
- 			n1 = sprintf(str1, "\"vd1\":[99.0");
- 			n2 = sprintf(str2, "\"id1\":[99.0");
- 			n3 = sprintf(str3, "\"vg2\":[99.0");
- 			n4 = sprintf(str4, "\"vd2\":[99.0");
- 			n5 = sprintf(str5, "\"id2\":[99.0");
- 			for (i=1; i<JNRX; i++){
- 				n0 += sprintf(&str0[n0], ",99.0");
- 				n1 += sprintf(&str1[n1], ",99.0");
- 				n2 += sprintf(&str2[n2], ",99.0");
- 				n3 += sprintf(&str3[n3], ",99.0");
- 				n4 += sprintf(&str4[n4], ",99.0");
- 				n5 += sprintf(&str5[n5], ",99.0");
-  	    	}
- 			n0 += sprintf(&str0[n0], "]");
- 			n1 += sprintf(&str1[n1], "]");
- 			n2 += sprintf(&str2[n2], "]");
- 			n3 += sprintf(&str3[n3], "]");
- 			n4 += sprintf(&str4[n4], "]");
- 			n5 += sprintf(&str5[n5], "]");
-		  }
-    	n += sprintf(&outStr[n], "%s, %s, %s, %s, %s, %s}}\r\n", str0, str1, str2, str3, str4, str5);
- 		sprintf(status, outStr);
+    	}
+    	zpec_json_close(&js, "\r\n");
     }
   } else {
     longHelp(status, usage, &Correlator::execJCOMAPlna);
@@ -1397,34 +1580,20 @@ void Correlator::execJCOMAPlnaTestRet(return_type status, argument_type arg)
   if (!arg.help) {
 	  if (!arg.str){
 
-		  int i, n0, n1, n2, n3, n4, n5;
-		  int n = sprintf(outStr, "{\"lna\": {\"cmdOK\":%s, \"LNAon\": [%.1f], "
-				  "\"powSupp\": [%.1f,%.1f,%.1f], \"Tchassis\": [%.2f], ",
-				  "true", 1., 15.1, -15.2, 5.3, 27.4);
-
-		  n0 = sprintf(str0, "\"vg1\":[%.3f", 100.1);
-		  n1 = sprintf(str1, "\"vd1\":[%.3f", 200.2);
-		  n2 = sprintf(str2, "\"id1\":[%.3f", 300.3);
-		  n3 = sprintf(str3, "\"vg2\":[%.3f", 400.4);
-		  n4 = sprintf(str4, "\"vd2\":[%.3f", 500.5);
-		  n5 = sprintf(str5, "\"id2\":[%.3f", 600.6);
-		  for (i=1; i<JNRX; i++){
-			  n0 += sprintf(&str0[n0], ",%.3f", 100.1+(float)i);
-			  n1 += sprintf(&str1[n1], ",%.3f", 200.2+(float)i);
-			  n2 += sprintf(&str2[n2], ",%.3f", 300.3+(float)i);
-			  n3 += sprintf(&str3[n3], ",%.3f", 400.4+(float)i);
-			  n4 += sprintf(&str4[n4], ",%.3f", 500.5+(float)i);
-			  n5 += sprintf(&str5[n5], ",%.3f", 600.6+(float)i);
+		  zpec_json_t js;
+		  int i, k;
+
+		  zpec_json_open(&js, arg.fdWrite, status, ControlService::maxLine - 200, "lna", "execJCOMAPlnaTestRet");
+		  zpec_json_member(&js, "\"cmdOK\":%s", "true");
+		  zpec_json_member(&js, "\"LNAon\": [%.1f]", 1.);
+		  zpec_json_member(&js, "\"powSupp\": [%.1f,%.1f,%.1f]", 15.1, -15.2, 5.3);
+		  zpec_json_member(&js, "\"Tchassis\": [%.2f]", 27.4);
+		  for (k=0; k<6; k++) {
+			  zpec_json_array(&js, lnaMonNames[k]);
+			  for (i=0; i<JNRX; i++) zpec_json_value(&js, "%.3f", 100.1*(k+1)+(float)i);
+			  zpec_json_end_array(&js);
 		  }
-		  n0 += sprintf(&str0[n0], "]");
-		  n1 += sprintf(&str1[n1], "]");
-		  n2 += sprintf(&str2[n2], "]");
-		  n3 += sprintf(&str3[n3], "]");
-		  n4 += sprintf(&str4[n4], "]");
-		  n5 += sprintf(&str5[n5], "]");
-
-		  n += sprintf(&outStr[n], "%s, %s, %s, %s, %s, %s}}\r\n", str0, str1, str2, str3, str4, str5);
-		  sprintf(status, outStr);
+		  zpec_json_close(&js, "\r\n");
 	  } else {
 		  longHelp(status, usage, &Correlator::execJCOMAPlnaTestRet);
 	  }
@@ -1449,49 +1618,24 @@ void Correlator::execJCOMAPsets(return_type status, argument_type arg)
   "  Query LNA bias set points.\r\n"
 		  ;
 
-  int i, n, n0, n1, n2, n3;
+  // gate and drain set points in output order, by LNAsets[] index
+  static const char *names[] = {"vg1", "vd1", "vg2", "vd2"};
+  static const int idx[] = {0, 2, 1, 3};
+  zpec_json_t js;
+  int i;
 
   if (!arg.help) {
-	  if (lnaPwrState) {
-
-		  n = sprintf(outStr, "{\"lnasets\": {\"cmdOK\":true, \"LNAon\": [1.0], ");
-
-		  n0 = sprintf(str0, "\"vg1\":[%.3f", rxPar[0].LNAsets[0]);
-		  n1 = sprintf(str1, "\"vd1\":[%.3f", rxPar[0].LNAsets[2]);
-		  n2 = sprintf(str2, "\"vg2\":[%.3f", rxPar[0].LNAsets[1]);
-		  n3 = sprintf(str3, "\"vd2\":[%.3f", rxPar[0].LNAsets[3]);
-		  for (i=1; i<JNRX; i++){
-			  n0 += sprintf(&str0[n0], ",%.3f", rxPar[i].LNAsets[0]);
-			  n1 += sprintf(&str1[n1], ",%.3f", rxPar[i].LNAsets[2]);
-			  n2 += sprintf(&str2[n2], ",%.3f", rxPar[i].LNAsets[1]);
-			  n3 += sprintf(&str3[n3], ",%.3f", rxPar[i].LNAsets[3]);
-		  }
-		  n0 += sprintf(&str0[n0], "]");
-		  n1 += sprintf(&str1[n1], "]");
-		  n2 += sprintf(&str2[n2], "]");
-		  n3 += sprintf(&str3[n3], "]");
-
-	  } else {
-		  n = sprintf(outStr, "{\"lnasets\": {\"cmdOK\":true, \"LNAon\": [0.0], ");
-
-		  n0 = sprintf(str0, "\"vg1\":[99.0");
-		  n1 = sprintf(str1, "\"vd1\":[99.0");
-		  n2 = sprintf(str2, "\"vg2\":[99.0");
-		  n3 = sprintf(str3, "\"vd2\":[99.0");
-		  for (i=1; i<JNRX; i++){
-			  n0 += sprintf(&str0[n0], ",99.0");
-			  n1 += sprintf(&str1[n1], ",99.0");
-			  n2 += sprintf(&str2[n2], ",99.0");
-			  n3 += sprintf(&str3[n3], ",99.0");
+	  zpec_json_open(&js, arg.fdWrite, status, ControlService::maxLine - 200, "lnasets", "execJCOMAPsets");
+	  zpec_json_member(&js, "\"cmdOK\":true");
+	  zpec_json_member(&js, "\"LNAon\": [%.1f]", (lnaPwrState ? 1.0 : 0.0));
+	  for (i=0; i<4; i++) {
+		  if (lnaPwrState) {
+			  zpec_json_floats(&js, names[i], "%.3f", &rxPar[0].LNAsets[idx[i]], JNRX, sizeof(rxPar[0]));
+		  } else {
+			  zpec_json_floats(&js, names[i], "%.1f", &lnaOffFill, JNRX, 0);
 		  }
-		  n0 += sprintf(&str0[n0], "]");
-		  n1 += sprintf(&str1[n1], "]");
-		  n2 += sprintf(&str2[n2], "]");
-		  n3 += sprintf(&str3[n3], "]");
-
 	  }
-	  n += sprintf(&outStr[n], "%s, %s, %s, %s}}\r\n", str0, str1, str2, str3);
-	  sprintf(status, outStr);
+	  zpec_json_close(&js, "\r\n");
 
   } else {
 	  longHelp(status, usage, &Correlator::execJCOMAPsets);
@@ -1536,7 +1680,7 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
 	    	      	  rtn += argus_readLNAbiasADCs("vd");
 	    	      	  rtn += argus_readLNAbiasADCs("id");
 	    	      	  rtn += argus_readPwrADCs();
-	    	      	  sprintf(status, "%sLNA power state %s.\r\nSupplies: +15V: %5.2f V; "
+	    	      	  zpec_sprintf(status, "%sLNA power state %s.\r\nSupplies: +15V: %5.2f V; "
 	    	      			  "-15V: %5.2f V; +5V: %5.2f V\r\n"
 	    	      			  "Voltages in [V], currents in [mA]\r\n\r\n"
 	    	      			  "          1               2               3               4\r\n"
@@ -1596,11 +1740,11 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
 	    	      			  d1, rxPar[16].LNAmonPts[4], d1, rxPar[16].LNAmonPts[5], d1, rxPar[17].LNAmonPts[4], d1, rxPar[17].LNAmonPts[5],
 	    	      			  d1, rxPar[18].LNAmonPts[4], d1, rxPar[18].LNAmonPts[5], d1, rxPar[19].LNAmonPts[4], d1, rxPar[19].LNAmonPts[5]);
 	     		  } else {
-	     			  	  sprintf(status, "%sNo report: LNA power is not on.\r\n", statusERR);
+	     			  	  zpec_sprintf(status, "%sNo report: LNA power is not on.\r\n", statusERR);
 	     		  }
 	    	  } else if (!strcasecmp(state, "sets")) {
 	    		  if (1) {     //(lnaPwrState != 0) {
-	    	      	  sprintf(status, "%sSet values:\r\n"
+	    	      	  zpec_sprintf(status, "%sSet values:\r\n"
 	    	      			  "Voltages in [V], currents in [mA]\r\n\r\n"
 	    	      			  "         1               2               3               4\r\n"
 	    	      			  "G: %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f,   %5.*f, %5.*f\r\n"
@@ -1645,12 +1789,12 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
 	    	      			  d2, rxPar[16].LNAsets[2], d2, rxPar[16].LNAsets[3], d2, rxPar[17].LNAsets[2], d2, rxPar[17].LNAsets[3],
 	    	      			  d2, rxPar[18].LNAsets[2], d2, rxPar[18].LNAsets[3], d2, rxPar[19].LNAsets[2], d2, rxPar[19].LNAsets[3]);
 	   	    		  } else {
-	    			  sprintf(status, "%sNo report: LNA power is not on.\r\n", statusERR);
+	    			  zpec_sprintf(status, "%sNo report: LNA power is not on.\r\n", statusERR);
 	              }
 	    	  } else if (!strcasecmp(state, "cryo")) {
 	    		  OSTimeDly(CMDDELAY);
 	    		  rtn = argus_readThermADCs();
-	    		  sprintf(status, "%sCryostat:\r\n%s:%8.1f K\r\n%s:%8.1f K\r\n%s:%8.1f K\r\n"
+	    		  zpec_sprintf(status, "%sCryostat:\r\n%s:%8.1f K\r\n%s:%8.1f K\r\n%s:%8.1f K\r\n"
 	    		    			   "%s:%8.1f K\r\n%s:%8.1f K\r\n%s:%8.1f K\r\n%s:%8.1e Torr (%4.3f V)\r\n",
 	    		    	    (rtn==0 ? statusOK : statusERR), cnames[0], cryoPar.cryoTemps[0], cnames[1], cryoPar.cryoTemps[1],
 	    		    		cnames[2], cryoPar.cryoTemps[2], cnames[3], cryoPar.cryoTemps[3], cnames[4], cryoPar.cryoTemps[4],
@@ -1661,7 +1805,7 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
 	    		  OSTimeDly(CMDDELAY);
 	    		  rtn = argus_readPwrADCs();
 	    		  rtn += argus_readBCpsV();
-	    		  sprintf(status, "%sPower control card:\r\n"
+	    		  zpec_sprintf(status, "%sPower control card:\r\n"
 	    				  "Analog +15V:     %5.2f V;  -15V:     %5.2f V\r\n"
 	    				  "Digital +5V:     %5.2f V;  Drains:    %5.2f V\r\n"
 	    				  "Chassis temp.:   %5.1f C\r\n\r\n"
@@ -1690,7 +1834,7 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
     		  flash_t flashData;
     		  zpec_readFlash(&flashData);
     		  if (foundLNAbiasSys) {
-    			  sprintf(status, "%sStored bias values in [V]\n\r\n"
+    			  zpec_sprintf(status, "%sStored bias values in [V]\n\r\n"
 	      			  "          1               2               3               4\r\n"
 	      			  "VG: %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f\r\n"
 	      			  "VD: %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f\r\n\r\n"
@@ -1732,7 +1876,7 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
 	      			  flashData.lnaDsets[32], flashData.lnaDsets[33], flashData.lnaDsets[34], flashData.lnaDsets[35],
 	      			  flashData.lnaDsets[36], flashData.lnaDsets[37], flashData.lnaDsets[38], flashData.lnaDsets[39]);
     		  } else {
-        		  sprintf(status, "%sStored A-I/Q and B-I/Q atten values in [dB]\r\n\r\n"
+        		  zpec_sprintf(status, "%sStored A-I/Q and B-I/Q atten values in [dB]\r\n\r\n"
     	      		  "             1               2               3               4\r\n"
     	      		  "A I,Q: %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f\r\n"
     	      		  "B I,Q: %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f,   %5.2f, %5.2f\r\n\r\n"
@@ -1806,7 +1950,7 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
 			  rtn += argus_readLNAbiasADCs("vd");
 			  rtn += argus_readLNAbiasADCs("id");
 
-			  sprintf(status, "%sLNA power state %s.\r\nSupplies: +15V: %5.2f V; "
+			  zpec_sprintf(status, "%sLNA power state %s.\r\nSupplies: +15V: %5.2f V; "
 			"-15V: %5.2f V; +5V: %5.2f V\r\n"
 					  "Voltages in [V], currents in [mA]\r\n\r\n"
     	      			  "          1               2               3               4\r\n"
@@ -1866,7 +2010,7 @@ void Correlator::execArgusMonPts(return_type status, argument_type arg)
     	      			  d1, rxPar[16].LNAmonPts[4], d1, rxPar[16].LNAmonPts[5], d1, rxPar[17].LNAmonPts[4], d1, rxPar[17].LNAmonPts[5],
     	      			  d1, rxPar[18].LNAmonPts[4], d1, rxPar[18].LNAmonPts[5], d1, rxPar[19].LNAmonPts[4], d1, rxPar[19].LNAmonPts[5]);
      		  } else {
-    			  sprintf(status, "%sNo report: LNA power is not on.\r\n", statusERR);
+    			  zpec_sprintf(status, "%sNo report: LNA power is not on.\r\n", statusERR);
     		  }
 	      }
   } else { // help string requested
@@ -1909,11 +2053,11 @@ void Correlator::execDCM2(return_type status, argument_type arg)
 	      // Execute the command.
 	      if (!strcasecmp(kw, "amps")) {
 	    	  rtn = dcm2_ampPow(val);
-	    	  sprintf(status, "%sdcm2_ampPow(%s) returned with status %d\r\n",
+	    	  zpec_sprintf(status, "%sdcm2_ampPow(%s) returned with status %d\r\n",
 	    			  (!rtn ? statusOK : statusERR), val, rtn);
 	      } else if (!strcasecmp(kw, "led")) {
 	    	  rtn = dcm2_ledOnOff(val);
-		      sprintf(status, "%sdcm2_ledOnOff(%s) returned with status %d\r\n",
+		      zpec_sprintf(status, "%sdcm2_ledOnOff(%s) returned with status %d\r\n",
 		    		  (!rtn ? statusOK : statusERR), val, rtn);
 	      } else {
 		      longHelp(status, usage, &Correlator::execDCM2);
@@ -1921,7 +2065,7 @@ void Correlator::execDCM2(return_type status, argument_type arg)
 	  } else if (narg == 3){
 		  if (!strcasecmp(kw, "block")) {
 			  rtn = dcm2_blockMod(val, onoff);
-			  sprintf(status, "%sdcm2_blockMod(%s, %s) returned with status %d\r\n",
+			  zpec_sprintf(status, "%sdcm2_blockMod(%s, %s) returned with status %d\r\n",
 			  		  (!rtn ? statusOK : statusERR), val, onoff, rtn);
 		  } else {
 			  longHelp(status, usage, &Correlator::execDCM2);
@@ -1937,9 +2081,9 @@ void Correlator::execDCM2(return_type status, argument_type arg)
 
       // write output: header, channel reports, then an extra line
 
-      int n = 0;
+      unsigned n = 0;
       int i;
-      n = sprintf(&outStr[0],
+      n = zpec_sprintf(status,
     		  "%sDCM2 parameters:    (status %d)\r\n"
     		  //"%.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f \r\n"
     		  "DCM2 7 & 12 V supply voltages: %.1f V, %.1f V, fanout board temp.: %.1f C\r\n"
@@ -1953,7 +2097,8 @@ void Correlator::execDCM2(return_type status, argument_type arg)
     		  (dcm2MBpar[2] > PLLLOCKTHRESH && dcm2MBpar[2] < 5 ? "locked" : "***UNLOCKED***"),
     		  (dcm2MBpar[3] > PLLLOCKTHRESH && dcm2MBpar[3] < 5 ? "locked" : "***UNLOCKED***"));
       for (i=0; i<NRX; i++) {
-    	  n += sprintf(&outStr[n],
+    	  zpec_write_if_full(arg.fdWrite, status, &n, ControlService::maxLine - 200, "execDCM2");
+    	  n += zpec_sprintf(&status[n],
 		     "Ch %2d: %d %4.1f %4.1f %7.3f %7.3f %6.2f | %d %4.1f %4.1f %7.3f %7.3f %6.2f\r\n",
 		     i+1, dcm2Apar.status[i], 
 		     (float)dcm2Apar.attenI[i]/2., (float)dcm2Apar.attenQ[i]/2.,
@@ -1964,8 +2109,7 @@ void Correlator::execDCM2(return_type status, argument_type arg)
 		     dcm2Bpar.powDetI[i], dcm2Bpar.powDetQ[i], 
 		     dcm2Bpar.bTemp[i]);
       }
-      n += sprintf(&outStr[n], "\r\n");
-      sprintf(status, outStr);  // send it out
+      zpec_sprintf(&status[n], "\r\n");
 	}
   } else {
 	  longHelp(status, usage, &Correlator::execDCM2);
@@ -2025,69 +2169,48 @@ void Correlator::execJDCM2(return_type status, argument_type arg)
 		  longHelp(status, usage, &Correlator::execJDCM2);
 	  }
 	} else {
-      rtn = dcm2_readMBadc();
-      rtn += dcm2_readMBtemp();
-      rtn += dcm2_readAllModTemps();
-      rtn += dcm2_readAllModTotPwr();
-
-      // write output: build up JSON string
-
-      int n, n0, n1, n2, n3, n4, n5;
-      int i;
-
-      n = sprintf(&outStr[0], "{\"dcm2\": {\"cmdOK\":%s, \"psVolts\":[%.1f,%.1f], "
-    		  "\"temp\":[%.1f], \"pllLock\":[%.1f,%.1f], ",
-    		  (!rtn ? "true" : "false"),
-    		  dcm2MBpar[5], dcm2MBpar[4], dcm2MBpar[7],
-    		  (dcm2MBpar[2] > PLLLOCKTHRESH && dcm2MBpar[2] < 5 ? 1.0 : 0.0),
-    		  (dcm2MBpar[3] > PLLLOCKTHRESH && dcm2MBpar[3] < 5 ? 1.0 : 0.0));
-
-      n0 = sprintf(&str0[0], "\"Astatus\":[%.1f", (float)dcm2Apar.status[0]);
-      n1 = sprintf(&str1[0], "\"AattenI\":[%.1f", (float)dcm2Apar.attenI[0]/2.);
-      n2 = sprintf(&str2[0], "\"AattenQ\":[%.1f", (float)dcm2Apar.attenQ[0]/2.);
-      n3 = sprintf(&str3[0], "\"ApowI\":[%.5f", dcm2Apar.powDetI[0]);
-      n4 = sprintf(&str4[0], "\"ApowQ\":[%.5f", dcm2Apar.powDetQ[0]);
-      n5 = sprintf(&str5[0], "\"Atemp\":[%.5f", dcm2Apar.bTemp[0]);
-      for (i=1; i<JNRX; i++) {
-    	  n0 += sprintf(&str0[n0], ",%.1f", (float)dcm2Apar.status[i]);
-    	  n1 += sprintf(&str1[n1], ",%.1f", (float)dcm2Apar.attenI[i]/2.);
-    	  n2 += sprintf(&str2[n2], ",%.1f", (float)dcm2Apar.attenQ[i]/2.);
-    	  n3 += sprintf(&str3[n3], ",%.5f", dcm2Apar.powDetI[i]);
-    	  n4 += sprintf(&str4[n4], ",%.5f", dcm2Apar.powDetQ[i]);
-    	  n5 += sprintf(&str5[n5], ",%.5f", dcm2Apar.bTemp[i]);
-      }
-	  n0 += sprintf(&str0[n0], "]");
-	  n1 += sprintf(&str1[n1], "]");
-	  n2 += sprintf(&str2[n2], "]");
-	  n3 += sprintf(&str3[n3], "]");
-	  n4 += sprintf(&str4[n4], "]");
-	  n5 += sprintf(&str5[n5], "]");
-
-	  n += sprintf(&outStr[n], "%s, %s, %s, %s, %s, %s, ", str0, str1, str2, str3, str4, str5);
-
-      n0 = sprintf(&str0[0], "\"Bstatus\":[%.1f", (float)dcm2Bpar.status[0]);
-      n1 = sprintf(&str1[0], "\"BattenI\":[%.1f", (float)dcm2Bpar.attenI[0]/2.);
-      n2 = sprintf(&str2[0], "\"BattenQ\":[%.1f", (float)dcm2Bpar.attenQ[0]/2.);
-      n3 = sprintf(&str3[0], "\"BpowI\":[%.5f", dcm2Bpar.powDetI[0]);
-      n4 = sprintf(&str4[0], "\"BpowQ\":[%.5f", dcm2Bpar.powDetQ[0]);
-      n5 = sprintf(&str5[0], "\"Btemp\":[%.5f", dcm2Bpar.bTemp[0]);
-      for (i=1; i<JNRX; i++) {
-    	  n0 += sprintf(&str0[n0], ",%.1f", (float)dcm2Bpar.status[i]);
-    	  n1 += sprintf(&str1[n1], ",%.1f", (float)dcm2Bpar.attenI[i]/2.);
-    	  n2 += sprintf(&str2[n2], ",%.1f", (float)dcm2Bpar.attenQ[i]/2.);
-    	  n3 += sprintf(&str3[n3], ",%.5f", dcm2Bpar.powDetI[i]);
-    	  n4 += sprintf(&str4[n4], ",%.5f", dcm2Bpar.powDetQ[i]);
-    	  n5 += sprintf(&str5[n5], ",%.5f", dcm2Bpar.bTemp[i]);
-      }
-	  n0 += sprintf(&str0[n0], "]");
-	  n1 += sprintf(&str1[n1], "]");
-	  n2 += sprintf(&str2[n2], "]");
-	  n3 += sprintf(&str3[n3], "]");
-	  n4 += sprintf(&str4[n4], "]");
-	  n5 += sprintf(&str5[n5], "]");
-
-	  n += sprintf(&outStr[n], "%s, %s, %s, %s, %s, %s}}", str0, str1, str2, str3, str4, str5);
-	  sprintf(status, "%s", outStr);
+      const struct argusSnapshot *sp;
+      float mb[sizeof(sp->dcm2MB)/sizeof(sp->dcm2MB[0])];
+      struct dcm2params a, b;  // 2*300 bytes for NRX receivers
+      unsigned long seq;
+      DWORD tick;
+
+      // copy from the snapshot; streaming may block on the socket
+      sp = argus_lockSnapshot();
+      rtn = sp->rtnDcm2;
+      memcpy(mb, sp->dcm2MB, sizeof(mb));
+      a = sp->dcm2A;
+      b = sp->dcm2B;
+      seq = sp->seq;
+      tick = sp->tick;
+      argus_unlockSnapshot();
+
+      // write output: stream JSON into status
+      zpec_json_t js;
+      zpec_json_open(&js, arg.fdWrite, status, ControlService::maxLine - 200, "dcm2", "execJDCM2");
+      zpec_json_member(&js, "\"cmdOK\":%s", (!rtn ? "true" : "false"));
+      zpec_json_member(&js, "\"psVolts\":[%.1f,%.1f]", mb[5], mb[4]);
+      zpec_json_member(&js, "\"temp\":[%.1f]", mb[7]);
+      zpec_json_member(&js, "\"pllLock\":[%.1f,%.1f]",
+    		  (mb[2] > PLLLOCKTHRESH && mb[2] < 5 ? 1.0 : 0.0),
+    		  (mb[3] > PLLLOCKTHRESH && mb[3] < 5 ? 1.0 : 0.0));
+      snapStamp(&js, seq, tick);
+
+      zpec_json_bytes(&js, "Astatus", "%.1f", a.status, JNRX, 1.);
+      zpec_json_bytes(&js, "AattenI", "%.1f", dcm2Apar.attenI, JNRX, 0.5);
+      zpec_json_bytes(&js, "AattenQ", "%.1f", dcm2Apar.attenQ, JNRX, 0.5);
+      zpec_json_floats(&js, "ApowI", "%.5f", a.powDetI, JNRX, sizeof(float));
+      zpec_json_floats(&js, "ApowQ", "%.5f", a.powDetQ, JNRX, sizeof(float));
+      zpec_json_floats(&js, "Atemp", "%.5f", a.bTemp, JNRX, sizeof(float));
+
+      zpec_json_bytes(&js, "Bstatus", "%.1f", b.status, JNRX, 1.);
+      zpec_json_bytes(&js, "BattenI", "%.1f", dcm2Bpar.attenI, JNRX, 0.5);
+      zpec_json_bytes(&js, "BattenQ", "%.1f", dcm2Bpar.attenQ, JNRX, 0.5);
+      zpec_json_floats(&js, "BpowI", "%.5f", b.powDetI, JNRX, sizeof(float));
+      zpec_json_floats(&js, "BpowQ", "%.5f", b.powDetQ, JNRX, sizeof(float));
+      zpec_json_floats(&js, "Btemp", "%.5f", b.bTemp, JNRX, sizeof(float));
+
+	  zpec_json_close(&js, "");
 	}
   } else {
 	  longHelp(status, usage, &Correlator::execJDCM2);
@@ -2275,54 +2398,38 @@ void Correlator::execJSaddlebag(return_type status, argument_type arg)
 			  longHelp(status, usage, &Correlator::execJSaddlebag);
 		  }
 		} else {
-		  rtn = 0;
-	      int n, n0, n1, n2, n3, n4, n5, n6, n7, n8, n9;
+	      // JSON names of saddlebag adcv[] channels; see sbnames[]
+	      static const char *names[] = {"ps12v", "ps-8v", "fanspeed1", "fanspeed2",
+	    		  "temp1", "temp2", "temp3", "temp4"};
+	      zpec_json_t js;
+	      struct saddlebagParams sb[NSBG];
+	      unsigned long seq;
+	      DWORD tick;
 	      int i;
 
-	      for (i=0; i<NSBG; i++) {  // read out ADCs and check PLL status
-	    	  rtn += sb_readADC(i);
-	    	  sbPar[i].pll = sb_readPLLmon(i);
+	      // copy from the snapshot; streaming may block on the socket
+	      const struct argusSnapshot *sp = argus_lockSnapshot();
+	      rtn = sp->rtnSbag;
+	      memcpy(sb, sp->sb, sizeof(sb));
+	      seq = sp->seq;
+	      tick = sp->tick;
+	      argus_unlockSnapshot();
+
+	      // Stream JSON return string into status
+	      zpec_json_open(&js, arg.fdWrite, status, ControlService::maxLine - 200, "sbag", "execJSaddlebag");
+	      zpec_json_member(&js, "\"cmdOK\":%s", (!rtn ? "true" : "false"));
+	      snapStamp(&js, seq, tick);
+	      for (i=0; i<8; i++) {
+	    	  zpec_json_floats(&js, names[i], "%.1f", &sb[0].adcv[i], NSBG, sizeof(sb[0]));
 	      }
-
-	      // Assemble JSON return string
-	      n = sprintf(&outStr[0], "{\"sbag\": {\"cmdOK\":%s, ",
-	    		  (!rtn ? "true" : "false"));
-	      n0 = sprintf(&str0[0], "\"ps12v\":[%.1f", sbPar[0].adcv[0]);
-	      n1 = sprintf(&str1[0], "\"ps-8v\":[%.1f", sbPar[0].adcv[1]);
-	      n2 = sprintf(&str2[0], "\"fanspeed1\":[%.1f", sbPar[0].adcv[2]);
-	      n3 = sprintf(&str3[0], "\"fanspeed2\":[%.1f", sbPar[0].adcv[3]);
-	      n4 = sprintf(&str4[0], "\"temp1\":[%.1f", sbPar[0].adcv[4]);
-	      n5 = sprintf(&str5[0], "\"temp2\":[%.1f", sbPar[0].adcv[5]);
-	      n6 = sprintf(&str6[0], "\"temp3\":[%.1f", sbPar[0].adcv[6]);
-	      n7 = sprintf(&str7[0], "\"temp4\":[%.1f", sbPar[0].adcv[7]);
-	      n8 = sprintf(&str8[0], "\"pllLock\":[%.1f", (sbPar[0].pll==1 ? 1. : 0.));
-	      n9 = sprintf(&str9[0], "\"ampOn\":[%.1f", (sbPar[0].ampPwr==1 ? 1. : 0.));
-	      for (i=1; i<NSBG; i++) {
-	    	  n0 += sprintf(&str0[n0], ",%.1f", sbPar[i].adcv[0]);
-	    	  n1 += sprintf(&str1[n1], ",%.1f", sbPar[i].adcv[1]);
-	    	  n2 += sprintf(&str2[n2], ",%.1f", sbPar[i].adcv[2]);
-	    	  n3 += sprintf(&str3[n3], ",%.1f", sbPar[i].adcv[3]);
-	    	  n4 += sprintf(&str4[n4], ",%.1f", sbPar[i].adcv[4]);
-	    	  n5 += sprintf(&str5[n5], ",%.1f", sbPar[i].adcv[5]);
-	    	  n6 += sprintf(&str6[n6], ",%.1f", sbPar[i].adcv[6]);
-	    	  n7 += sprintf(&str7[n7], ",%.1f", sbPar[i].adcv[7]);
-	    	  n8 += sprintf(&str8[n8], ",%.1f", (sbPar[i].pll==1 ? 1. : 0.));
-	    	  n9 += sprintf(&str9[n9], ",%.1f", (sbPar[i].ampPwr==1 ? 1. : 0.));
-	      }
-    	  n0 += sprintf(&str0[n0], "]");
-    	  n1 += sprintf(&str1[n1], "]");
-    	  n2 += sprintf(&str2[n2], "]");
-    	  n3 += sprintf(&str3[n3], "]");
-    	  n4 += sprintf(&str4[n4], "]");
-    	  n5 += sprintf(&str5[n5], "]");
-    	  n6 += sprintf(&str6[n6], "]");
-    	  n7 += sprintf(&str7[n7], "]");
-    	  n8 += sprintf(&str8[n8], "]");
-    	  n9 += sprintf(&str9[n9], "]");
-
-    	  n += sprintf(&outStr[n], "%s, %s, %s, %s, %s, %s, %s, %s, %s, %s}}\r\n", str0, str1, str2, str3, str4,
-    			  str5, str6, str7, str8, str9);
-    	  sprintf(status, "%s", outStr);
+	      zpec_json_array(&js, "pllLock");
+	      for (i=0; i<NSBG; i++) zpec_json_value(&js, "%.1f", (sb[i].pll==1 ? 1. : 0.));
+	      zpec_json_end_array(&js);
+	      zpec_json_array(&js, "ampOn");
+	      for (i=0; i<NSBG; i++) zpec_json_value(&js, "%.1f", (sbPar[i].ampPwr==1 ? 1. : 0.));
+	      zpec_json_end_array(&js);
+
+    	  zpec_json_close(&js, "\r\n");
 		}
 	  } else {
 		  longHelp(status, usage, &Correlator::execJSaddlebag);
@@ -2347,6 +2454,7 @@ void Correlator::execVane(return_type status, argument_type arg)
       "    OBS moves ambient vane out of the beam.\r\n"
 	  "    CAL moves ambient vane into calibration position.\r\n"
       "    MAN switches off both relays for manual control.\r\n"
+	  "  Moves return at once; position reads MOVING until the move ends.\r\n"
 	  "  No argument returns monitor point data.\r\n"
 			  ;
 
@@ -2382,6 +2490,8 @@ void Correlator::execVane(return_type status, argument_type arg)
 	  // check vane position for bus error or uninitialized
 	  if (rtn) {
 		  vanePar.vaneFlag = 4;
+	  } else if (vaneMoving) {
+		  // MOVING until the vane task finishes
 	  } else if (vanePar.vaneFlag >= 2 && vanePar.vaneFlag <= 4) {
 		  // no change for stall, timeout, or bus error
 	  } else if (fabs(vanePar.vaneAngleDeg) < VANECALERRANGLE) {
@@ -2461,6 +2571,8 @@ void Correlator::execJVane(return_type status, argument_type arg)
 		  // check vane position for bus error or uninitialized
 		  if (rtn) {
 			  vanePar.vaneFlag = 4;
+		  } else if (vaneMoving) {
+			  // MOVING until the vane task finishes
 		  } else if (vanePar.vaneFlag >= 2 && vanePar.vaneFlag <= 4) {
 			  // no change for stall, timeout, or bus error
 		  } else if (fabs(vanePar.vaneAngleDeg) < VANECALERRANGLE) {
@@ -2498,68 +2610,249 @@ void Correlator::execArgusLock(return_type status, argument_type arg)
   int rtn;
 
   if (!arg.help) {
-	  int busy = 1;  // i2cBusBusy value for all tests
+	  int busy = 1;  // hold the I2C bus for all tests
 	  int lnaps = 0; // LNA power state; set to 1 to reach bus lock tests for LNA, 0 for CIF
+	  unsigned int wait = i2cBusWait;
+
+	  i2cBusWait = 0;  // give up after one tick
+	  if (busy) i2cBusTestHold(1);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readAllSystemADCs();
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readAllSystemADCs()\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readPwrADCs();
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readPwrADCs();\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readBCpsV();
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readBCpsV();\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readThermADCs();
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readThermADCs();\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readLNAbiasADCs("vg");
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readLNAbiasADCs(vg);\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readLNAbiasADCs("vd");
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readLNAbiasADCs(vd);\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readLNAbiasADCs("id");
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readLNAbiasADCs(id);\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readLNAbiasADCs("vm");
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readLNAbiasADCs(vm);\r\n", i2cBusBusy, rtn);
 
-	  i2cBusBusy = busy;
 	  rtn = argus_readLNAbiasADCs("im");
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_readLNAbiasADCs(im);\r\n", i2cBusBusy, rtn);
 
 	  lnaPwrState = lnaps;
-	  i2cBusBusy = busy;
 	  rtn = argus_setLNAbias("d", 2, 1, .5, 0);
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_setLNAbias(d, 2, 1, .5, 0)\r\n", i2cBusBusy, rtn);
 
 	  lnaPwrState = lnaps;
-	  i2cBusBusy = busy;
 	  rtn = argus_setLNAbias("m", 2, 1, .5, 0);
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_setLNAbias(m, 2, 1, .5, 0)\r\n", i2cBusBusy, rtn);
 
 	  lnaPwrState = lnaps;
-	  i2cBusBusy = busy;
 	  rtn = argus_setAllBias("d", 0.5, 0);
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_setAllBias(d, 0.5, 0)\r\n", i2cBusBusy, rtn);
 
 	  lnaPwrState = lnaps;
-	  i2cBusBusy = busy;
 	  rtn = argus_lnaPower(1);
 	  iprintf("i2cBusBusy = %u, rtn = %d for argus_lnaPower(1)\r\n", i2cBusBusy, rtn);
 
+	  i2cBusTestHold(0);
+	  i2cBusWait = wait;
+
 	  sprintf(status, "# I2C bus lock test results output to UART0.\r\n");
 
   } else {
     longHelp(status, usage, &Correlator::execArgusLock);
   }
 }
+
+/*************************************************************************************/
+/**
+  \brief Argus I2C trace command.
+
+  This method dumps the I2C transaction trace and its summary: bytes per second,
+  NACK rate per device address, worst-case transaction time, and transactions
+  per caller.  JSON return; output longer than the status buffer is written
+  directly to the client.
+
+  \param status Storage buffer for return status (should contain at least
+                ControlService::maxLine characters).
+  \param arg    Argument list: [N]
+*/
+void Correlator::execJArgusTrace(return_type status, argument_type arg)
+{
+  static const char *usage =
+  "[N]\r\n"
+  "  I2C transaction trace summary and the N most recent transactions\r\n"
+  "  (default: whole trace; 0 for summary only).  Each transaction lists\r\n"
+  "  [start us, address, bytes (< 0 for reads), status, duration us,\r\n"
+  "  first data byte, caller].\r\n";
+
+  if (!arg.help) {
+	  int nrec = I2CTRACEN;
+	  if (arg.str && sscanf(arg.str, "%d", &nrec) != 1) nrec = -1;
+	  if (nrec >= 0) {
+		  i2cTraceJSON(arg.fdWrite, status, ControlService::maxLine - 200, nrec);
+	  } else {
+		  longHelp(status, usage, &Correlator::execJArgusTrace);
+	  }
+  } else {
+	  longHelp(status, usage, &Correlator::execJArgusTrace);
+  }
+}
+
+/*************************************************************************************/
+/**
+  \brief JSON vane trajectory.
+
+  Returns the angle and motor current samples of the latest vane move, with
+  motor current statistics, while it runs or after it ends.
+
+  \param status Storage buffer for return status (should contain at least
+                ControlService::maxLine characters).
+  \param arg    Argument list: none
+*/
+void Correlator::execJVaneTraj(return_type status, argument_type arg)
+{
+  static const char *usage =
+  "\r\n"
+  "  Vane trajectory of the latest move: time since motor start [ms],\r\n"
+  "  angle [deg] and motor current [A] every 100 ms, with current statistics.\r\n";
+
+  if (!arg.help && !arg.str) {
+	  vane_trajJSON(arg.fdWrite, status, ControlService::maxLine - 200);
+  } else {
+	  longHelp(status, usage, &Correlator::execJVaneTraj);
+  }
+}
+
+/**
+  \brief Binary telemetry frame and telemetry service settings.
+
+  With no argument, writes a binary frame of the latest monitor snapshot to
+  the client, followed by the usual prompt; see argus_telemFrame().  The
+  frame length is in its header.
+
+  \param status Storage buffer for return status (should contain at least
+                ControlService::maxLine characters).
+  \param arg    Argument list: [since N | deadband F D | period [MS] | key [N]]
+*/
+void Correlator::execTelem(return_type status, argument_type arg)
+{
+  static const char *usage =
+  "[KEYWORD [VALUE [VALUE]]]\r\n"
+  "  Binary telemetry frame of the latest monitor data, for machine clients.\r\n"
+  "  The 24-byte header gives the frame length; see argus_telem.cpp.\r\n"
+  "    since N     changes since change table version N, or a keyframe; N = 0\r\n"
+  "                for a keyframe.\r\n"
+  "    deadband F D  change deadband for field id F to D raw units.\r\n"
+  "    period      report the UDP telemetry service settings and subscribers.\r\n"
+  "    period MS   publish at most every MS ms (100 minimum); frames are sent only\r\n"
+  "                for new monitor sampler sweeps (see engr sampler).\r\n"
+  "    key N       publish deltas with a keyframe every N frames; 0 for full frames.\r\n";
+
+  if (!arg.help && !arg.str) {
+	  DWORD frame[TELEMMAXBYTES/4];
+	  int n = argus_telemFrame((BYTE *)frame, sizeof(frame));
+	  zpec_write_retry(arg.fdWrite, frame, n, "execTelem");
+	  status[0] = '\0';
+  } else if (!arg.help) {
+	  char kw[10] = {0};
+	  unsigned long val = 0;
+	  unsigned val2 = 0;
+	  int narg = sscanf(arg.str, "%9s %lu %u", kw, &val, &val2);
+	  if (narg == 2 && !strcasecmp(kw, "since")) {
+		  DWORD frame[TELEMMAXBYTES/4];
+		  int n = argus_telemDelta((BYTE *)frame, sizeof(frame), val);
+		  zpec_write_retry(arg.fdWrite, frame, n, "execTelem");
+		  status[0] = '\0';
+	  } else if (narg == 3 && !strcasecmp(kw, "deadband") && val >= 1 && val <= TELEM_NFIELD) {
+		  telemDeadband[val] = val2;
+		  sprintf(status, "%sTelemetry field %lu deadband %u\r\n", statusOK, val, val2);
+	  } else if (narg >= 1 && (!strcasecmp(kw, "period") || !strcasecmp(kw, "key"))) {
+		  if (narg == 2 && !strcasecmp(kw, "period")) telemetryServer.setPeriod(val);
+		  if (narg == 2 && !strcasecmp(kw, "key")) telemetryServer.setKeyEvery(val);
+		  sprintf(status, "%sTelemetry service on UDP port %u: period %u ms, sampler period %u ms, "
+				  "keyframe every %u frames, %u subscribers\r\n", statusOK, TelemetryService::telemPort,
+				  telemetryServer.getPeriod(), samplerPeriod, telemetryServer.getKeyEvery(),
+				  telemetryServer.getSubscribers());
+	  } else {
+		  longHelp(status, usage, &Correlator::execTelem);
+	  }
+  } else {
+	  longHelp(status, usage, &Correlator::execTelem);
+  }
+}
+
+/**
+  \brief Set point batches.
+
+  Stages LNA gate and drain set points, or DCM2 attenuations, and applies
+  them together; see argus_batch.cpp.  Commands may share a line, separated
+  by semicolons.
+
+  \param status Storage buffer for return status (should contain at least
+                ControlService::maxLine characters).
+  \param arg    Argument list: [begin | g|d M N V | a M A|B I|Q DB | commit | abort]
+*/
+void Correlator::execBatch(return_type status, argument_type arg)
+{
+  static const char *usage =
+  "[KEYWORD [VALUES]]\r\n"
+  "  Stage set points and apply them together, checked as a set.\r\n"
+  "    begin         open an empty batch.\r\n"
+  "    g M N V       stage gate voltage V for receiver M, stage N.\r\n"
+  "    d M N V       stage drain voltage V for receiver M, stage N.\r\n"
+  "    a M A|B I|Q DB  stage DCM2 attenuation DB for module M.\r\n"
+  "    commit        check the batch against the limits and apply it in one bus pass.\r\n"
+  "    abort         discard the batch.\r\n"
+  "  No argument reports the batch.  An out of limits batch stays open.\r\n"
+  "  The batch belongs to the client that opened it until it is applied or discarded.\r\n"
+  "  Example: batch begin; batch g 3 1 0.1; batch d 3 1 0.9; batch commit\r\n";
+
+  int rtn = 0;
+
+  if (!arg.help) {
+	  char kw[10] = {0}, ab[2] = {0}, iq[2] = {0};
+	  char msg[120];
+	  int m = 0, n = 0;
+	  float v = 0.;
+	  int narg = (arg.str ? sscanf(arg.str, "%9s", kw) : 0);
+
+	  if (narg == 0) {
+		  argus_batchReport(msg);
+		  sprintf(status, "%sBatch %s\r\n", statusOK, msg);
+	  } else if (!strcasecmp(kw, "begin")) {
+		  rtn = argus_batchBegin(arg.client);
+		  if (!rtn) sprintf(status, "%sBatch open\r\n", statusOK);
+		  else sprintf(status, "%sBatch open by another client (status %d)\r\n", statusERR, rtn);
+	  } else if (!strcasecmp(kw, "commit")) {
+		  rtn = argus_batchCommit(arg.client, msg);
+		  sprintf(status, "%sBatch: %s (status %d)\r\n", (!rtn ? statusOK : statusERR), msg, rtn);
+	  } else if (!strcasecmp(kw, "abort")) {
+		  rtn = argus_batchAbort(arg.client);
+		  if (!rtn) sprintf(status, "%sBatch discarded\r\n", statusOK);
+		  else sprintf(status, "%sBatch open by another client (status %d)\r\n", statusERR, rtn);
+	  } else if ((!strcasecmp(kw, "g") || !strcasecmp(kw, "d"))
+			  && sscanf(arg.str, "%*s %d %d %f", &m, &n, &v) == 3) {
+		  rtn = argus_batchStage(arg.client, tolower(kw[0]), m-1, n-1, v);
+		  sprintf(status, "%sBatch %s receiver %d stage %d %.3f V (status %d)\r\n",
+				  (!rtn ? statusOK : statusERR), (kw[0] == 'g' || kw[0] == 'G' ? "gate" : "drain"),
+				  m, n, v, rtn);
+	  } else if (!strcasecmp(kw, "a") && sscanf(arg.str, "%*s %d %1s %1s %f", &m, ab, iq, &v) == 4
+			  && strchr("AaBb", ab[0]) && strchr("IiQq", iq[0])) {
+		  n = 2*(toupper(ab[0]) == 'B') + (toupper(iq[0]) == 'Q');
+		  rtn = argus_batchStage(arg.client, 'a', m-1, n, v);
+		  sprintf(status, "%sBatch module %d %c%c attenuation %.1f dB (status %d)\r\n",
+				  (!rtn ? statusOK : statusERR), m, toupper(ab[0]), toupper(iq[0]), v, rtn);
+	  } else {
+		  longHelp(status, usage, &Correlator::execBatch);
+	  }
+  } else {
+	  longHelp(status, usage, &Correlator::execBatch);
+  }
+}
@@ -25,6 +25,7 @@
 #include "constants.h"
 
 #include "argus.h"
+#include "i2csim.h"
 
 //I2C global setups
 BYTE buffer[I2C_MAX_BUF_SIZE];
@@ -40,14 +41,12 @@ unsigned char lnaLimitsBypass = BYPASS;    // bypass soft limits on LNA bias whe
 float gvdiv;
 float vaneOffset;                          // Vane offset voltage for angle calculation
 float vaneV2Deg;                           // Vane volts to degrees
-unsigned char i2cBusBusy = 1;              // set to 1 when I2C bus is busy (clears in argus_init())
-unsigned int busLockCtr = 0;               // I2C successful bus lock request counter
-unsigned int busNoLockCtr = 0;             // I2C unsuccessful bus lock request counter
 unsigned char freezeSys =  0;              // freeze system state when = 1
 unsigned int freezeCtr = 0;                // freeze request counter
 unsigned int thawCtr = 0;                  // thaw request counter
 unsigned int freezeErrCtr = 0;             // freeze error counter (access request while frozen)
 int i2cState[2];                           // I2C bus SCL (0/1) and SDA (0/2) values, before and after reset
+unsigned int i2cSelSkipCtr = 0;            // I2C switch select writes skipped by switch shadow
 
 //Pointer defs
 struct chSet *chSetPtr; // pointer to structure of form chSet
@@ -339,56 +338,165 @@ float adc2v(short int adcw, float sc, float offs, char bip) {
 }
 
 
-/********************************************************************/
+/****************************************************************************************/
+// Shadow of the PCA954x/TCA9548A switch settings.  Backplane and DCM2 top-level
+// switches share address I2CSWITCH_BP.  Each backplane channel leads to at most one
+// sub-bus switch: DCM2_SSBADDR on a DCM2 group, SB_SSBADDR on the subbus card.
+struct i2cSwitchShadow {
+	BYTE bpValid;   // 1 when bp matches the backplane switch
+	BYTE bp;        // backplane switch setting
+	BYTE subValid;  // bit k set when sub[k] matches the sub-bus switch on backplane channel 1<<k
+	BYTE sub[8];    // sub-bus switch setting behind each backplane channel
+};
+static struct i2cSwitchShadow i2cSw = {0};
+
 /**
-  \brief Set LNA DAC.
+  \brief Invalidate the I2C switch shadow.
 
-  This command sets the DACs for LNA and mixer bias voltages
+  Call after anything that may change switch settings behind the shadow's back:
+  J2[28] switch resets, bus recovery, or a change of hardware type.
+*/
+void i2cSwitchInvalidate(void)
+{
+	i2cSw.bpValid = 0;
+	i2cSw.subValid = 0;
+}
 
-  \param  i   terminal: g, d, or m for gate, drain, and mixer (char).
-  \param  m   mth receiver.
-  \param  n   nth stage within a receiver.
-  \param  v   value in V
-  \param busy set to 0 to release I2C bus, 1 to retain (1 for loops)
-  \return Zero on success, -1 for invalid selection, -10 if bias card power is not on,
-              else number of I2C read fails.
+/**
+  \brief Single-byte I2C write through the switch shadow.
+
+  Body of the I2CSEND1 macro.  Sends buffer[0] to address, except that a switch
+  select that would leave the backplane or sub-bus switch where it already is
+  is skipped.  Must be called with the I2C bus locked, as for I2CSEND1.
+
+  \return Zero on success or skipped select, else NB I2C error code.
 */
-int argus_setLNAbias(char *term, int m, int n, float v, unsigned char busyOverride)
+int i2cSend1(void)
 {
-	if (!foundLNAbiasSys) return WRONGBOX;
+	BYTE subAddr = (foundLNAbiasSys ? SB_SSBADDR : DCM2_SSBADDR);
+	BYTE bp = i2cSw.bp;
+	int k, stat;
+
+	if (address == I2CSWITCH_BP) {
+		if (i2cSw.bpValid && bp == buffer[0]) {i2cSelSkipCtr += 1; return 0;}
+		stat = I2CTRACED(I2CSEND1_BUS, 1);
+		i2cSw.bp = buffer[0];
+		i2cSw.bpValid = (stat == 0);
+		return stat;
+	}
 
-	unsigned short int dacw;
-	short I2CStat;
-	int baseAdd; //base address offset for gate, drain, mixer
-	char bcard_i2caddr[] = BCARD_I2CADDR;//{0x01, 0x01, 0x01, 0x01, 0xff}; //BCARD_I2CADDR;
-	float vDiv;  // voltage divider ratio,  vDiv <= 1
+	if (address == subAddr && i2cSw.bpValid && bp) {
+		// skip if every sub-bus switch reachable through the backplane is already set
+		if ((i2cSw.subValid & bp) == bp) {
+			for (k = 0; k < 8; k++) {
+				if ((bp & (1 << k)) && i2cSw.sub[k] != buffer[0]) break;
+			}
+			if (k == 8) {i2cSelSkipCtr += 1; return 0;}
+		}
+		stat = I2CTRACED(I2CSEND1_BUS, 1);
+		for (k = 0; k < 8; k++) {
+			if (bp & (1 << k)) i2cSw.sub[k] = buffer[0];
+		}
+		if (stat == 0) i2cSw.subValid |= bp;
+		else i2cSw.subValid &= ~bp;
+		return stat;
+	}
 
-	// return if the LNA boards are not powered
-	if (!lnaPwrState) return (-10);
+	return I2CTRACED(I2CSEND1_BUS, 1);
+}
 
-	// check for freeze
-	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
 
-	// check that I2C bus is available, else return
-	if (i2cBusBusy && !busyOverride) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+/********************************************************************/
+/**
+  \brief Apply soft limits to an LNA bias set point.
 
-    // Write to device
-	// first set I2C bus switch for bias card in backplane
-    address = I2CSWITCH_BP;  // bias cards are in Argus backplane
-   	buffer[0] = bcard_i2caddr[rxPar[m].cardNo];  // select bias card
-	I2CStat = I2CSEND1;    // set i2c bus switch to talk to card
+  Gate and drain limits include the maximum drain-gate voltage against the
+  present setting of the other terminal.
 
-	// then check that voltage is within limits, set address internal to card and channel,
-	// convert voltage, send chip i2c address on card, internal address for channel,
-	// convert voltage to word for DAC
-	if (strcmp(term, "g") == 0) {
+  \param  term  terminal: g, d, or m for gate, drain, and mixer.
+  \param  m     mth receiver.
+  \param  n     nth stage within a receiver.
+  \param  v     requested value in V.
+  \return Limited value in V.
+*/
+static float limitLNAbias(char term, int m, int n, float v)
+{
+	if (term == 'g') {
 		if (lnaLimitsBypass == 0) {   // bypass soft limits on LNA bias when = 1
 			if (v > VGMAX) v = VGMAX;
 			if (v < VGMIN) v = VGMIN;
 			if (rxPar[m].LNAsets[n+NSTAGES] - v > VDGMAX) v = rxPar[m].LNAsets[n+NSTAGES] - VDGMAX;
 		}
+	} else if (term == 'd') {
+		if (lnaLimitsBypass == 0) {   // bypass soft limits on LNA bias when = 1
+			if (v > VDMAX) v = VDMAX;
+			if (v < VDMIN) v = VDMIN;
+			if (v - rxPar[m].LNAsets[n] > VDGMAX) v = rxPar[m].LNAsets[n] + VDGMAX;
+		} else {
+			if (v < 0) v = 0;  // hardware limit
+		}
+	} else if (term == 'm') {
+		if (lnaLimitsBypass == 0) {   // bypass soft limits on LNA bias when = 1
+			if (v > VMMAX) v = VMMAX;
+			if (v < VMMIN) v = VMMIN;
+		}
+	}
+	return v;
+}
+
+
+/********************************************************************/
+/**
+  \brief Bias card channel a bias DAC is physically wired to.
+
+  Equals rxPar[m].bcChan[n] except for the cross-wired pixel 17 gates, whose
+  DACs are those of another channel; see lnaBiasDAC().
+
+  \param  set   DAC table for the terminal.
+  \param  term  terminal: g, d, or m for gate, drain, and mixer.
+  \param  m     mth receiver.
+  \param  n     nth stage within a receiver.
+  \return Channel number 0..7, or -1 if no channel has this DAC.
+*/
+static int lnaBiasChan(const struct chSet *set, char term, int m, int n)
+{
+	int c = rxPar[m].bcChan[n];
+	char addr;
+
+	if (term != 'g' || m != 16) return c;
+	addr = (n == 0 ? 0x32 : 0x41);  // as in lnaBiasDAC()
+	for (c = 0; c < 8; c++) {
+		if (set->i2c[c] == addr && set->add[c] == set->add[rxPar[m].bcChan[n]]) return c;
+	}
+	return -1;
+}
+
+/********************************************************************/
+/**
+  \brief Write one LNA bias DAC.
+
+  Applies the soft limits and records the set point in rxPar[m].LNAsets.  Call
+  with the I2C bus locked and the receiver's bias card selected on the
+  backplane switch.
+
+  \param  term  terminal: g, d, or m for gate, drain, and mixer.
+  \param  m     mth receiver.
+  \param  n     nth stage within a receiver.
+  \param  v     value in V.
+  \return Zero on success, -1 for invalid terminal, else NB I2C error code.
+*/
+static int lnaBiasDAC(char term, int m, int n, float v)
+{
+	unsigned short int dacw;
+	short I2CStat;
+	int baseAdd; //base address offset for gate, drain, mixer
+	float vDiv;  // voltage divider ratio,  vDiv <= 1
+
+	// check that voltage is within limits, set address internal to card and channel,
+	// convert voltage, send chip i2c address on card, internal address for channel,
+	// convert voltage to word for DAC
+	if (term == 'g') {
+		v = limitLNAbias('g', m, n, v);
 		v = v/gvdiv;  // convert from gate voltage to bias card output voltage
 		address = vgSet.i2c[rxPar[m].bcChan[n]];
 		if (m==16 && n==0) address = 0x32;  // override lookups to fix cross-wired connector for pixel 17
@@ -397,35 +505,21 @@ int argus_setLNAbias(char *term, int m, int n, float v, unsigned char busyOverri
 		dacw = v2dac(v, vgSet.sc, vgSet.offset, vgSet.bip);
 		baseAdd = 0;
 		vDiv = gvdiv;
-	} else if (strcmp(term, "d") == 0) {
-		if (lnaLimitsBypass == 0) {   // bypass soft limits on LNA bias when = 1
-			if (v > VDMAX) v = VDMAX;
-			if (v < VDMIN) v = VDMIN;
-			if (v - rxPar[m].LNAsets[n] > VDGMAX) v = rxPar[m].LNAsets[n] + VDGMAX;
-		} else {
-			if (v < 0) v = 0;  // hardware limit
-		}
+	} else if (term == 'd') {
+		v = limitLNAbias('d', m, n, v);
 		address = vdSet.i2c[rxPar[m].bcChan[n]];
 		buffer[0] = vdSet.add[rxPar[m].bcChan[n]];
 		dacw = v2dac(v, vdSet.sc, vdSet.offset, vdSet.bip);
 		baseAdd = 2;
 		vDiv = 1.;
-	} else if (strcmp(term, "m") == 0) {
-		if (lnaLimitsBypass == 0) {   // bypass soft limits on LNA bias when = 1
-			if (v > VMMAX) v = VMMAX;
-			if (v < VMMIN) v = VMMIN;
-		}
+	} else if (term == 'm') {
+		v = limitLNAbias('m', m, n, v);
 		address = vmSet.i2c[rxPar[m].bcChan[n]];
 		buffer[0] = vmSet.add[rxPar[m].bcChan[n]];
 		dacw = v2dac(v, vmSet.sc, vmSet.offset, vmSet.bip);
 		baseAdd = 4;
 		vDiv = 1.;
 	} else {
-		// Disconnect I2C sub-bus
-		address = I2CSWITCH_BP;
-		buffer[0] = 0;
-		i2cBusBusy = 0; // release I2C bus
-		I2CStat = I2CSEND1;
 		return -1;
 	}
 	// write to DAC
@@ -440,18 +534,145 @@ int argus_setLNAbias(char *term, int m, int n, float v, unsigned char busyOverri
 		if (lnaPSlimitsBypass == 1) rxPar[m].LNAsets[n+baseAdd] = v*vDiv;
 		else rxPar[m].LNAsets[n+baseAdd] = 99.;
 	}
+	return I2CStat;
+}
+
+/********************************************************************/
+/**
+  \brief Set LNA DAC.
+
+  This command sets the DACs for LNA and mixer bias voltages
+
+  \param  i   terminal: g, d, or m for gate, drain, and mixer (char).
+  \param  m   mth receiver.
+  \param  n   nth stage within a receiver.
+  \param  v   value in V
+  \param busy set to 0 to release I2C bus, 1 to retain (1 for loops)
+  \return Zero on success, -1 for invalid selection, LNAPWROFFVAL if bias card power is not on,
+              else number of I2C read fails.
+*/
+int argus_setLNAbias(char *term, int m, int n, float v, unsigned char busyOverride)
+{
+	if (!foundLNAbiasSys) return WRONGBOX;
+
+	short I2CStat;
+	char bcard_i2caddr[] = BCARD_I2CADDR;//{0x01, 0x01, 0x01, 0x01, 0xff}; //BCARD_I2CADDR;
+	char t = 0;
+
+	// return if the LNA boards are not powered, or are being sequenced
+	if (!lnaPwrState) return (LNAPWROFFVAL);
+	if (argus_lnaSeqBusy()) return LNASEQBUSYVAL;
+
+	// check for freeze
+	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
+
+	// check that I2C bus is available, else return
+	if (!busyOverride && i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
+
+    // Write to device
+	// first set I2C bus switch for bias card in backplane
+    address = I2CSWITCH_BP;  // bias cards are in Argus backplane
+   	buffer[0] = bcard_i2caddr[rxPar[m].cardNo];  // select bias card
+	I2CStat = I2CSEND1;    // set i2c bus switch to talk to card
+
+	if (strcmp(term, "g") == 0) t = 'g';
+	else if (strcmp(term, "d") == 0) t = 'd';
+	else if (strcmp(term, "m") == 0) t = 'm';
+
+	if (t) {
+		lnaBiasDAC(t, m, n, v);
+	} else {
+		// Disconnect I2C sub-bus
+		address = I2CSWITCH_BP;
+		buffer[0] = 0;
+		I2CStat = I2CSEND1;
+		if (!busyOverride) i2cBusUnlock(); // release I2C bus
+		return -1;
+	}
 	// Disconnect I2C sub-bus
 	address = I2CSWITCH_BP;
 	buffer[0] = 0;
 	I2CStat = I2CSEND1;
 
     // release I2C bus
-	i2cBusBusy = busyOverride;
+	if (!busyOverride) i2cBusUnlock();
 
 	return I2CStat;
 }
 
 
+/****************************************************************************************/
+/**
+  \brief Set a batch of LNA gate and drain biases.
+
+  Writes the staged set points of struct biasBatch one bias card at a time,
+  selecting each card once, under a single hold of the I2C bus.  Within a
+  stage the gate is written first, as in comap_presets(), unless the drain
+  is coming down, so that the drain-gate limit against the present setting
+  of the other terminal never clips a set that is valid as a whole.
+
+  \param  b  staged set points.
+  \return Zero on success; LNAPWROFFVAL if LNA boards have no power; else the number
+          of failed DAC writes.
+*/
+int argus_setBiasBatch(const struct biasBatch *b)
+{
+	if (!foundLNAbiasSys) return WRONGBOX;
+
+	char bcard_i2caddr[] = BCARD_I2CADDR;
+	int c, m, n, k, open, nfail = 0;
+	char order[2];
+
+	// return if the LNA boards are not powered, or are being sequenced
+	if (!lnaPwrState) return (LNAPWROFFVAL);
+	if (argus_lnaSeqBusy()) return LNASEQBUSYVAL;
+
+	// check for freeze
+	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
+
+	// check that I2C bus is available, else return
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
+
+	for (c=0; c<NBIASC; c++) {
+		open = 0;
+		for (m=0; m<NRX; m++) {
+			if (rxPar[m].cardNo != c) continue;
+			for (n=0; n<NSTAGES; n++) {
+				if (!b->setG[m][n] && !b->setD[m][n]) continue;
+				if (!open) {
+					address = I2CSWITCH_BP;
+					buffer[0] = bcard_i2caddr[c];  // select bias card
+					I2CSEND1;
+					open = 1;
+				}
+				if (b->setD[m][n] && b->vd[m][n] < rxPar[m].LNAsets[n+NSTAGES]) {
+					order[0] = 'd';
+					order[1] = 'g';
+				} else {
+					order[0] = 'g';
+					order[1] = 'd';
+				}
+				for (k=0; k<2; k++) {
+					if (order[k] == 'g' && b->setG[m][n]) nfail += (lnaBiasDAC('g', m, n, b->vg[m][n]) != 0);
+					if (order[k] == 'd' && b->setD[m][n]) nfail += (lnaBiasDAC('d', m, n, b->vd[m][n]) != 0);
+				}
+			}
+		}
+		if (open) {
+			// Disconnect I2C sub-bus
+			address = I2CSWITCH_BP;
+			buffer[0] = 0;
+			I2CSEND1;
+		}
+	}
+
+    // release I2C bus
+	i2cBusUnlock();
+
+	return nfail;
+}
+
+
 /****************************************************************************************/
 
 /**
@@ -460,12 +681,18 @@ int argus_setLNAbias(char *term, int m, int n, float v, unsigned char busyOverri
   This command sets all LNA bias voltages to a common value.  Useful
   for initialization.
 
-  This command does not set i2cBusBusy semaphore; that should be done outside
-  if needed
+  Channels whose limited set point is the same for every occupant on every
+  bias card, counting the cross-wired pixel 17 gates on the channel they are
+  wired to, are written once, with the backplane switch opening all cards
+  (ALLBCARD_I2CADDR).  The other channels are set card by card with
+  argus_setLNAbias(), so no DAC ever sees a value beyond its own limit.  A
+  broadcast write is acknowledged if any card answers.
+
+  Set busyOverride when the caller already holds the I2C bus
 
   \param  inp  Select input: char g, d, m for gate, drain, mixer.
   \param  v    Voltage [V].
-  \return 0 on success; -1 for invalid request; -10 if LNA boards have no power,
+  \return 0 on success; -1 for invalid request; LNAPWROFFVAL if LNA boards have no power,
                else a number giving the number of failed I2C writes.
   */
 
@@ -473,38 +700,117 @@ int argus_setAllBias(char *inp, float v, unsigned char busyOverride){
 
 	if (!foundLNAbiasSys) return WRONGBOX;
 
-	int i, j, stat=0;
+	int i, j, c, stat=0;
+	int nch;             // channels per receiver for this terminal
+	int baseAdd;         // offset in LNAsets for this terminal
+	int first;           // receiver setting the broadcast value, -1 if none
+	float vl[NRX][NSTAGES];       // limited set points
+	signed char pc[NRX][NSTAGES]; // physical channel, see lnaBiasChan()
+	char single[NRX][NSTAGES];    // 1 to set individually
+	char same;           // 1 while every occupant of a channel agrees
+	float bv = 0.;       // broadcast value
+	struct chSet *set;
+	short I2CStat;
+	unsigned short int dacw;
+
+    // return if the LNA boards are not powered, or are being sequenced
+	if (!lnaPwrState) return (LNAPWROFFVAL);
+	if (argus_lnaSeqBusy()) return LNASEQBUSYVAL;
 
-    // return if the LNA boards are not powered
-	if (!lnaPwrState) return (-10);
+	// check for freeze
+	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
+
+	if (strcmp(inp, "g") == 0) {
+		set = &vgSet;
+		nch = NSTAGES;
+		baseAdd = 0;
+	} else if (strcmp(inp, "d") == 0) {
+		set = &vdSet;
+		nch = NSTAGES;
+		baseAdd = 2;
+	} else if (strcmp(inp, "m") == 0) {
+		set = &vmSet;
+		nch = NMIX;
+		baseAdd = 4;
+	} else {
+		return -1;
+	}
 
     // check that I2C bus is available, else return
-	if (i2cBusBusy && !busyOverride) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (!busyOverride && i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
- 	if (strcmp(inp, "g") == 0 || strcmp(inp, "d") == 0) {
+	for (i=0; i<NRX; i++) {
+		for (j=0; j<nch; j++) {
+			vl[i][j] = limitLNAbias(inp[0], i, j, v);
+			pc[i][j] = lnaBiasChan(set, inp[0], i, j);
+			single[i][j] = (pc[i][j] < 0);
+		}
+	}
+
+	// open all bias cards, then one write per card channel with a common value
+	address = I2CSWITCH_BP;
+	buffer[0] = ALLBCARD_I2CADDR;
+	I2CStat = I2CSEND1;
+	for (c=0; c<8 && I2CStat==0; c++) {
+		first = -1;
+		same = 1;
 		for (i=0; i<NRX; i++) {
-			for (j=0 ; j<NSTAGES ; j++) {
-				stat += argus_setLNAbias(inp, i, j, v, 1);
+			for (j=0; j<nch; j++) {
+				if (pc[i][j] != c) continue;
+				if (first < 0) {
+					first = i;
+					bv = vl[i][j];
+				} else if (vl[i][j] != bv) {
+					same = 0;
+				}
 			}
 		}
-	}
-	else if (strcmp(inp, "m") == 0 ) {
-		if (NMIX > 0) {
+		if (first < 0) continue;
+		if (!same) {
+			// a broadcast would reach every occupant: set this channel card by card
 			for (i=0; i<NRX; i++) {
-				for (j=0 ; j<NMIX ; j++) {
-					stat += argus_setLNAbias("m", i, j, v, 1);
+				for (j=0; j<nch; j++) {
+					if (pc[i][j] == c) single[i][j] = 1;
 				}
 			}
+			continue;
+		}
+
+		address = set->i2c[c];
+		buffer[0] = set->add[c];
+		dacw = v2dac((inp[0] == 'g' ? bv/gvdiv : bv), set->sc, set->offset, set->bip);
+		buffer[2] = BYTE(dacw);
+		buffer[1] = BYTE(dacw>>8);
+		I2CStat = I2CSEND3;
+		if (I2CStat) break;
+
+		for (i=0; i<NRX; i++) {
+			for (j=0; j<nch; j++) {
+				if (pc[i][j] == c) rxPar[i].LNAsets[j+baseAdd] = bv;
+			}
+		}
+	}
+	if (I2CStat) {
+		// broadcast failed: set this channel and the rest one at a time
+		for (i=0; i<NRX; i++) {
+			for (j=0; j<nch; j++) {
+				if (pc[i][j] >= c) single[i][j] = 1;
+			}
+		}
+	}
+	// Disconnect I2C sub-bus
+	address = I2CSWITCH_BP;
+	buffer[0] = 0;
+	I2CStat = I2CSEND1;
+
+	for (i=0; i<NRX; i++) {
+		for (j=0; j<nch; j++) {
+			if (single[i][j]) stat += argus_setLNAbias(inp, i, j, v, 1);
 		}
-	} else {
-		i2cBusBusy = 0; // release I2C bus
-		return -1;
 	}
 
     // release I2C bus
-	i2cBusBusy = busyOverride;
+	if (!busyOverride) i2cBusUnlock();
 
 	return stat;
 }
@@ -536,9 +842,7 @@ int argus_readLNAbiasADCs(char *sw)
 	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
 
 // check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	// set up for particular monitor point: vg, vd, id, vm, im
 	// baseAddr offsets correspond to offsets in receiver parameters structure
@@ -560,7 +864,7 @@ int argus_readLNAbiasADCs(char *sw)
 		idFlag = 1;  // set to 1 to make shunt current correction
 	} else if (strcmp(sw, "vm") == 0) {
 		if (NMIX == 0) {
-			i2cBusBusy = 0; // release I2C bus
+			i2cBusUnlock(); // release I2C bus
 			return -1;
 		}
 		chReadPtr = &vmRead;
@@ -569,7 +873,7 @@ int argus_readLNAbiasADCs(char *sw)
 		vDivRatio = 1.;
 	} else if (strcmp(sw, "im") == 0) {
 		if (NMIX == 0) {
-			i2cBusBusy = 0; // release I2C bus
+			i2cBusUnlock(); // release I2C bus
 			return -1;
 		}
 		chReadPtr = &imRead;
@@ -577,7 +881,7 @@ int argus_readLNAbiasADCs(char *sw)
 		mmax = NMIX;
 		vDivRatio = 1.;
 	} else {
-		i2cBusBusy = 0; // release I2C bus
+		i2cBusUnlock(); // release I2C bus
 		return -1;
 	}
 
@@ -627,7 +931,7 @@ int argus_readLNAbiasADCs(char *sw)
 	I2CStat = I2CSEND1;
 
     // release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
 
 	return I2CStat;
 }
@@ -658,9 +962,7 @@ int argus_readBCpsV(void)
 	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
 
     // check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	if (lnaPwrState) {
 		for (k = 0; k < NBIASC; k++) {  // loop over cards
@@ -708,7 +1010,7 @@ int argus_readBCpsV(void)
 	I2CStat = I2CSEND1;
 
     // release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
 
 	return writeErrs;
 }
@@ -734,9 +1036,7 @@ int argus_readPwrADCs(void)
 	//float scale[8] = {1, 1, 1, 1, 1, 1, 1, 1};  // for calibration
 	// vds, -15, +15, vcc, vcal, vif, swvif, iif
 
-    if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-    i2cBusBusy = 1;
-    busLockCtr += 1;
+    if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
     // Write to device
 	// first set I2C bus switch
@@ -776,7 +1076,7 @@ int argus_readPwrADCs(void)
 	I2CStat = I2CSEND1;
 
     // release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
 
 	return I2CStat;
 }
@@ -795,9 +1095,7 @@ int argus_lnaPowerPIO(void)
 	unsigned char pioState;
 
     // check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	// set I2C sub-bus switch for power control card in backplane
 	address = I2CSWITCH_BP;
@@ -817,184 +1115,12 @@ int argus_lnaPowerPIO(void)
 	I2CStat = I2CSEND1;
 
     // release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
 
 	return (pioState);
 }
 
 
-/**************************************************************************************/
-/**
-  \brief LNA power control.
-
-  This command turns the LNA power on and off in a safe way.  Checks for power supplies
-  in range for ON, but OFF executes regardless of power supply values.
-
-  \param  state     Power state (1=on, else off).
-  \return Zero on success; else a number giving the number of failed I2C writes or,
-          for power supplies out of range, in order of first failure:
-            9995 for Vcc
-            9996 for -Vamp
-            9997 for +Vamp
-            9998 for VDS
-          */
-int argus_lnaPower(short state)
-{
-	if (!foundLNAbiasSys) return WRONGBOX;
-
-	BYTE pioState;
-
-	I2CStat = argus_readPwrADCs();
-	// get power supply voltages: returns vds, -15, +15, vcc, vcal, vif, swvif, iif, tamb
-
-	// check for freeze
-	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
-
-	// check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
-
-	if (state == 1) {  // check power supply voltages before on, but skip check for off
-		if (lnaPSlimitsBypass != 1) {
-			if (pwrCtrlPar[3] < MINVCCV || pwrCtrlPar[3] > MAXVCCV) {
-				// Disconnect I2C sub-bus
-				address = I2CSWITCH_BP;
-				buffer[0] = 0;
-				I2CStat = I2CSEND1;
-				i2cBusBusy = 0;  // release I2C bus
-				return 9995;   //VCC
-			}
-			if (pwrCtrlPar[1] < -MAXAMPV || pwrCtrlPar[1] > -MINAMPV) {
-				// Disconnect I2C sub-bus
-				address = I2CSWITCH_BP;
-				buffer[0] = 0;
-				I2CStat = I2CSEND1;
-				i2cBusBusy = 0;  // release I2C bus
-				return 9996; //-15V
-			}
-			if (pwrCtrlPar[2] < MINAMPV || pwrCtrlPar[2] > MAXAMPV) {
-				// Disconnect I2C sub-bus
-				address = I2CSWITCH_BP;
-				buffer[0] = 0;
-				I2CStat = I2CSEND1;
-				i2cBusBusy = 0;  // release I2C bus
-				return 9997;   //+15
-			}
-			if (pwrCtrlPar[0] < MINVDSV || pwrCtrlPar[0] > MAXVDSV) {
-				// Disconnect I2C sub-bus
-				address = I2CSWITCH_BP;
-				buffer[0] = 0;
-				I2CStat = I2CSEND1;
-				i2cBusBusy = 0;  // release I2C bus
-				return 9996;   //VDS
-			}
-		}
-	}
-
-	// set I2C bus switch for power control card in backplane
-	address = I2CSWITCH_BP;
-	buffer[0] = PWCTL_I2CADDR;
-	I2CStat = I2CSEND1;
-
-	// Read port register to establish present state;
-	// store byte for later modification
-	address = 0x21;  // PIO I2C address
-	buffer[0] = 0x00;
-	I2CStat += I2CSEND1;
-	I2CREAD1;
-	pioState = buffer[0];
-
-	// control power
-	if (state==1 && lnaPwrState==0) {
-		 // turn on VCC (digital) and allow it to stabilize
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState | ctlVCC;
-		I2CStat += I2CSEND2;
-		OSTimeDly( TICKS_PER_SECOND * 1 );
-		lnaPwrState = 1;  // set state flag
-
-		// initialize DAC values, then return to power control board
-		argus_setAllBias("g", VGSTART, 1);
-		argus_setAllBias("d", VDSTART, 1);
-		argus_setAllBias("m", VMSTART, 1);
-		address = I2CSWITCH_BP;
-		buffer[0] = PWCTL_I2CADDR;
-		I2CStat = I2CSEND1;
-
-		// turn on +/- Vamp (for gates), allow stabilization time
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState | ctlpVamp | ctlnVamp;
-		I2CStat += I2CSEND2;
-		OSTimeDly( TICKS_PER_SECOND * 1 );
-
-		// turn on VDS (for drains)
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState | ctlVDS;
-		I2CStat += I2CSEND2;
-
-		// turn on LED
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState & 0xff^FPLED;
-		I2CStat += I2CSEND2;
-
-	}
-	else if (state==0 && lnaPwrState==1) {
-		// set power supplies to safe voltages for switching
-		argus_setAllBias("g", VGSTART, 1);
-		argus_setAllBias("d", VDSTART, 1);
-		argus_setAllBias("m", VMSTART, 1);
-
-		// set I2C bus switch for power control card in backplane
-		address = I2CSWITCH_BP;
-		buffer[0] = PWCTL_I2CADDR;
-		I2CStat = I2CSEND1;
-
-		// turn off VDS (drains)
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState & 0xff^ctlVDS;
-		I2CStat += I2CSEND2;
-		OSTimeDly( TICKS_PER_SECOND * 0.5 );
-
-		// turn off +/- Vamp (gates)
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState & 0xff^(ctlpVamp | ctlnVamp);
-		I2CStat += I2CSEND2;
-		OSTimeDly( TICKS_PER_SECOND * 0.5 );  // wait
-
-		// turn off VCC (digital)
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState & 0xff^ctlVCC;
-		I2CStat += I2CSEND2;
-		lnaPwrState = 0;  // clear state flag
-
-		// turn off LED
-		address = 0x21;  // PIO I2C address
-		buffer[0] = 0x01;
-		buffer[1] = pioState = pioState | FPLED;
-		I2CStat += I2CSEND2;
-
-	}
-
-	// Disconnect I2C sub-bus
-	address = I2CSWITCH_BP;
-	buffer[0] = 0;
-	I2CStat = I2CSEND1;
-
-    // release I2C bus
-	i2cBusBusy = 0;
-
-	return (I2CStat);
-}
-
-
 /****************************************************************************************/
 
 /**
@@ -1081,9 +1207,7 @@ int argus_readThermADCs(void)
 	//float scale[8] = {1, 1, 1, 1, 1, 1, 1, 1};  // for calibration
 
     // check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
     // Write to device
 	// first set I2C bus switch
@@ -1125,7 +1249,7 @@ int argus_readThermADCs(void)
 	I2CStat = I2CSEND1;
 
     // release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
 
 	return I2CStat;
 }
@@ -1157,6 +1281,10 @@ int argus_clearBus(void)
 	J2[28].set();
 	OSTimeDly(1);
 	J2[28].clr();
+	i2cSwitchInvalidate();
+#ifdef SIMULATE
+	i2csim_switchReset();
+#endif
 
 	// wrap up with check of the state of the I2C bus:
 	i2cState[1] = 0;
@@ -1170,8 +1298,8 @@ int argus_clearBus(void)
 	J2[42].function (PINJ2_42_SCL);  // configure SCL as GPIO
 	J2[39].function (PINJ2_39_SDA);  // configure SDA as GPIO
 
-    // clear busy bit
-	i2cBusBusy = 0;
+    // free the bus, whoever holds it
+	i2cBusReset();
 
 	return I2CStat;
 }
@@ -1425,6 +1553,13 @@ struct dcm2params dcm2Bpar  = {  // structure for IF bank B parameters
 // Vector to store on-board ADC values: Ain3, Ain2, Ain1, Ain0, MonP12, MonP8, GND, GND
 float dcm2MBpar[] = {99, 99, 99, 99, 99, 99, 99, 99, 99};
 
+// Bus expander SPI: main board output register shadow, pin sets, and burst writes
+BYTE dcm2MBout = BEXINIT0;           // DCM2 main board BEX output register
+unsigned char bexSpiBurst = 1;       // several clock edges per I2C write when = 1
+unsigned char dcm2AttenBcast = 1;    // broadcast DCM2 attenuator settings to all modules when = 1
+static const struct bexSpiPins dcm2ModSpi = DCM2MOD_SPIPINS;
+static const struct bexSpiPins dcm2MBspi = DCM2MB_SPIPINS;
+
 // DCM2 I2C switch settings for subbus and subsubbuses
 struct dcm2switches {
 	// I2C switch settings for addressing DCM2 module cards
@@ -1472,15 +1607,13 @@ int foundLNAbiasSys;
 int openI2Csbus(BYTE addr_sb, BYTE swset_sb)
 {
     // check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	address = addr_sb;        // I2C switch address
 	buffer[0] = swset_sb;   // I2C channel address
 	I2CStat = I2CSEND1;
 
-	if (I2CStat) i2cBusBusy = 0;  // clear bit if write errors subbus
+	if (I2CStat) i2cBusUnlock();  // clear bit if write errors subbus
 
 	return I2CStat;
 }
@@ -1500,7 +1633,7 @@ int closeI2Csbus(BYTE addr_sb)
 	  I2CStat = I2CSEND1;
 
 	  // release I2C bus
-	  i2cBusBusy = 0;
+	  i2cBusUnlock();
 
 	  return I2CStat;
 }
@@ -1523,9 +1656,7 @@ int closeI2Csbus(BYTE addr_sb)
 int openI2Cssbus(BYTE addr_sb, BYTE swset_sb, BYTE addr_ssb, BYTE swset_ssb)
 {
     // check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	address = addr_sb;      // I2C switch address
 	buffer[0] = swset_sb;   // I2C switch setting
@@ -1535,7 +1666,7 @@ int openI2Cssbus(BYTE addr_sb, BYTE swset_sb, BYTE addr_ssb, BYTE swset_ssb)
 	buffer[0] = swset_ssb;  // I2C switch setting
 	I2CStat = I2CSEND1;
 
-	if (I2CStat) i2cBusBusy = 0;  // clear bit if write errors on subsubbus
+	if (I2CStat) i2cBusUnlock();  // clear bit if write errors on subsubbus
 
 	return I2CStat;
 }
@@ -1564,7 +1695,7 @@ int closeI2Cssbus(BYTE addr_sb, BYTE addr_ssb)
 	I2CStat = I2CSEND1;
 
 	// release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
 
 	return I2CStat;
 }
@@ -1622,14 +1753,136 @@ int writeBEX(BYTE val, BYTE addr)
   \param  addr I2C address for BEX chip
   \return byte with input value.
 */
-BYTE readBEX(BYTE addr)
+BYTE readBEX(BYTE addr)
+{
+	address = addr;    // I2C address for BEX chip on board
+	buffer[0] = 0x00;  // input port register
+	I2CSEND1;
+	I2CREAD1;
+
+	return (buffer[0]);
+}
+
+/*******************************************************************/
+/**
+  \brief Write buffered output bytes to a bus expander (BEX).
+
+  Sends all bytes in one I2C write to the output port register; the
+  TCA6408A applies each data byte in turn.
+
+  \param  addr  I2C address for BEX chip
+  \param  out   output bytes.
+  \param  nout  number of bytes in out; cleared on return.
+  \return Zero on success, else NB I2C error code.
+*/
+static int bexFlush(BYTE addr, BYTE *out, int *nout)
+{
+	int k;
+
+	if (!*nout) return 0;
+	address = addr;    // I2C address for BEX chip on board
+	buffer[0] = 0x01;  // output port register
+	for (k = 0; k < *nout; k++) buffer[1+k] = out[k];
+	k = *nout;
+	*nout = 0;
+
+	return (I2CSENDN(1+k));
+}
+
+/**
+  \brief Queue one output byte for a bus expander (BEX).
+
+  Writes at once unless bexSpiBurst is set and there is room for more.
+
+  \return Zero on success, else NB I2C error code.
+*/
+static int bexPut(BYTE addr, BYTE *out, int *nout, BYTE val)
+{
+	out[(*nout)++] = val;
+	if (!bexSpiBurst || *nout == BEXSPI_MAXBURST) return (bexFlush(addr, out, nout));
+	return 0;
+}
+
+/*******************************************************************/
+/**
+  \brief SPI transfer of N words bit-banged through a TCA6408A bus expander.
+
+  Lowers chip select cs, runs nlead clock cycles without data, then shifts
+  nwords words of nbits each, msb first: bits of tx are set on MOSI with the
+  clock low, and MISO is sampled into rx at clock high.  Finally raises cs,
+  with the clock low if endClkLow, else high.  All other chip selects are
+  held high throughout.
+
+  The output register is not read back: each output byte is built from the
+  pin masks and, where the BEX has non-SPI outputs, the pin set's shadow.
+  With bexSpiBurst set, consecutive output bytes go in one I2C write, so a
+  read costs three transactions per bit and a write-only transfer just one.
+  With bexSpiBurst clear, every edge is a separate write after reading the
+  BEX first, as the original bit-bang code did.
+
+  Requires previous call to function that sets I2C bus switches to
+  address the interface before use, and close after.  Also requires
+  previous single call to initialize interface chip.
+
+  \param  p         pin set.
+  \param  cs        chip select or latch enable mask.
+  \param  nlead     clock cycles before the first data bit.
+  \param  nbits     bits per word, up to 16.
+  \param  nwords    number of words.
+  \param  tx        words to send, or 0 to leave MOSI alone.
+  \param  rx        words received, or 0 not to sample MISO.
+  \param  endClkLow 1 to finish with the clock low.
+  \return Zero on success, else NB I2C error code of the first failed transaction.
+*/
+int bexSpiXfer(const struct bexSpiPins *p, BYTE cs, int nlead, int nbits, int nwords,
+		const unsigned short *tx, unsigned short *rx, int endClkLow)
 {
-	address = addr;    // I2C address for BEX chip on board
-	buffer[0] = 0x00;  // input port register
-	I2CSEND1;
-	I2CREAD1;
+	BYTE x, out[BEXSPI_MAXBURST];
+	int nout = 0, i, k, stat;
+	unsigned short m;
+
+	// start from the non-SPI outputs, all chip selects and clock high
+	if (bexSpiBurst) x = (p->shadow ? *p->shadow : 0);
+	else x = readBEX(p->addr);
+	x |= p->csAll | p->clk;
+	if ((stat = bexPut(p->addr, out, &nout, x))) return stat;
+	x &= ~cs;   // send CS low to initiate transfer
+	if ((stat = bexPut(p->addr, out, &nout, x))) return stat;
+
+	for (i = 0; i < nlead; i++) {
+		if ((stat = bexPut(p->addr, out, &nout, x & ~p->clk))) return stat;
+		if ((stat = bexPut(p->addr, out, &nout, x))) return stat;
+	}
 
-	return (buffer[0]);
+	for (k = 0; k < nwords; k++) {
+		if (rx) rx[k] = 0;
+		for (m = 1 << (nbits - 1); m; m >>= 1) {
+			if (tx) {
+				if (tx[k] & m) x |= p->mosi;
+				else x &= ~p->mosi;
+			}
+			if ((stat = bexPut(p->addr, out, &nout, x & ~p->clk))) return stat;  // data out, clock low
+			if ((stat = bexPut(p->addr, out, &nout, x))) return stat;            // clock high
+			if (rx) {
+				// read bit
+				if ((stat = bexFlush(p->addr, out, &nout))) return stat;
+				address = p->addr;
+				buffer[0] = 0x00;   // input port register
+				I2CSEND1;
+				if ((stat = I2CREAD1)) return stat;
+				if (buffer[0] & p->miso) rx[k] |= m;
+			}
+		}
+	}
+
+	// all done, deselect with CS& high
+	if (endClkLow) x &= ~p->clk;
+	x |= cs;
+	if ((stat = bexPut(p->addr, out, &nout, x))) return stat;
+	stat = bexFlush(p->addr, out, &nout);
+	if (p->shadow && !stat) *p->shadow = x;
+
+	return stat;
 }
 
 /*******************************************************************/
@@ -1692,10 +1945,11 @@ int dcm2_ampPow(char *inp)
 	if (I2CStatus) return (I2CStatus);
 
 	if (!strcasecmp(inp, "off") || !strcasecmp(inp, "0")) {
-		I2CStatus = writeBEX(readBEX(BEX_ADDR0) | DCM2_AMPPOW, BEX_ADDR0);
+		dcm2MBout |= DCM2_AMPPOW;
 	} else {
-		I2CStatus = writeBEX(readBEX(BEX_ADDR0) & ~DCM2_AMPPOW, BEX_ADDR0);
+		dcm2MBout &= ~DCM2_AMPPOW;
 	}
+	I2CStatus = writeBEX(dcm2MBout, BEX_ADDR0);
 
 	closeI2Csbus(DCM2_SBADDR);
 	return(I2CStatus);
@@ -1723,12 +1977,15 @@ int dcm2_ledOnOff(char *inp)
 		// Hidden command: configure and initialize BEX on main board
 		openI2Csbus(0x77, DCM2PERIPH_SBADDR);
 		configBEX(BEXCONF0, BEX_ADDR0);
-		writeBEX(BEXINIT0, BEX_ADDR0);
+		dcm2MBout = BEXINIT0;
+		writeBEX(dcm2MBout, BEX_ADDR0);
 		closeI2Csbus(0x77);
 	} else if (!strcasecmp(inp, "off") || !strcasecmp(inp, "0")) {
-		I2CStatus = writeBEX(readBEX(BEX_ADDR0) | (DCM2_BD_LED | DCM2_FP_LED), BEX_ADDR0); // high for off
+		dcm2MBout |= (DCM2_BD_LED | DCM2_FP_LED);   // high for off
+		I2CStatus = writeBEX(dcm2MBout, BEX_ADDR0);
 	} else {
-		I2CStatus = writeBEX(readBEX(BEX_ADDR0) & ~(DCM2_BD_LED | DCM2_FP_LED), BEX_ADDR0);  // low for on
+		dcm2MBout &= ~(DCM2_BD_LED | DCM2_FP_LED);  // low for on
+		I2CStatus = writeBEX(dcm2MBout, BEX_ADDR0);
 	}
 
 	closeI2Csbus(DCM2_SBADDR);
@@ -1746,93 +2003,18 @@ int dcm2_ledOnOff(char *inp)
   address the interface before use, and close after.  Also requires
   previous single call to initialize interface chip.
 
-  \param  val  value to convert and send
-  \return voltage, or (990 + NB I2C error code) for bus errors.
+  \param  p    bus expander pin set.
+  \param  cs   chip select mask.
+  \return temperature [C], or (990 + NB I2C error code) for bus errors.
 */
-float AD7814_SPI_bitbang(BYTE spi_clk_m, BYTE spi_dat_m, BYTE spi_csb_m, BYTE addr)
+float AD7814_SPI_bitbang(const struct bexSpiPins *p, BYTE cs)
 {
+	unsigned short w;   // 10-bit two's complement, 0.25 C per count
+	int I2CStat = bexSpiXfer(p, cs, 1, 10, 1, 0, &w, 0);  // one leading zero, then MSB first
 
-	/* Mask definitions are hardware dependent
-	*/
-
-	BYTE x = 0;             // Working command byte
-	int I2CStat = 0;        // Comms error
- 	// var and var_m are defined below
-
-	// get command state of output pins on interface
-	x = readBEX(addr);
-
-	// COMAP special: force CS& high on all devices to start
-	x |= (QLOG_CS | ILOG_CS | Q_ATTEN_LE | I_ATTEN_LE | BOARD_T_CS);
-
-    buffer[0] = 0x01;    // write register
-	address = addr;      // I2C address for BEX chip on board
-	// set up for read
-	x |= spi_csb_m;       // ensure CS is high at start
-	x |= spi_clk_m;      // ensure CLK is high at start
-	buffer[1] = x;
-	I2CStat = I2CSEND2;
-	if (I2CStat) return (9000+I2CStat);
-
-	x &= ~spi_csb_m;      // send CS low to initiate read
-	buffer[1] = x;
-	I2CSEND2;
-
-	// read initial zero, one cycle
-	x &= ~spi_clk_m;     // set clock low
-	buffer[1] = x;
-	I2CSEND2;
-	x |= spi_clk_m;      // set clock high
-	buffer[1] = x;
-	I2CSEND2;
-
-	// read MSB at clock high to get sign bit
-	x &= ~spi_clk_m;      // set clock low
-	buffer[1] = x;
-	I2CSEND2;
-	x |= spi_clk_m;       // set clock high
-	buffer[1] = x;
-	I2CSEND2;
-	buffer[0] = 0x00;     // set input port register and get pin data
-	I2CSEND1;
-	I2CREAD1;
-
-	int flag = 0;
-	// define input variable and mask, deal with negative values
-	short int val = 0;              // initialize value
-	short int val_m = 0x0100;       // initialize mask
-	if (buffer[0] & (unsigned short)spi_dat_m) {
-		flag = 1;
-		val = 0xfe00; // fill top bits of word if val < 0
-	}
-
-	// step through remainder of input word, reading at clock high
-	while (val_m > 0) {
-		// set clock low
-		x &= ~spi_clk_m;
-		buffer[0] = 0x01;
-		buffer[1] = x;
-		I2CSEND2;
-		// set clock high
-		x |= spi_clk_m;
-		buffer[1] = x;
-		I2CSEND2;
-		// read bit
-		buffer[0] = 0x00;
-		I2CSEND1;
-		I2CREAD1;
-		// put bit in word and rotate mask for next-LSB
-		if (buffer[0] & (unsigned short)spi_dat_m) val |= val_m;
-		val_m >>= 1;
-	}
-
-	// all done, deselect with CS& high
-	x |= spi_csb_m;
-	buffer[0] = 0x01;
-	buffer[1] = x;
-	I2CStat = I2CSEND2;
+	if (w & 0x0200) w |= 0xfc00;  // extend sign bit
 
-	return ( I2CStat ? (float)(990+I2CStat) : (float)val*0.25 );
+	return ( I2CStat ? (float)(990+I2CStat) : (float)(short)w*0.25 );
 }
 
 /*******************************************************************/
@@ -1853,7 +2035,7 @@ int dcm2_readMBtemp(void)
 	if (I2CStatus) return (I2CStatus);
 
 	// read thermometer
-	dcm2MBpar[7] = AD7814_SPI_bitbang(SPI_CLK0_M, SPI_DAT0_M, SPI_CSB1_M, BEX_ADDR0);
+	dcm2MBpar[7] = AD7814_SPI_bitbang(&dcm2MBspi, SPI_CSB1_M);
 
 	I2CStat = closeI2Csbus(DCM2_SBADDR);  // release I2C bus
 
@@ -1878,9 +2060,7 @@ int dcm2_readAllModTemps(void)
 	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
 
 	// use this approach to lock bus for multiple readouts
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	int m;  // loop counter
 	for (m=0; m<NRX; m++){
@@ -1893,7 +2073,7 @@ int dcm2_readAllModTemps(void)
 			address = DCM2_SSBADDR;
 			buffer[0] = dcm2sw.ssba[m];  // I2C subsubbus address
 			I2CSEND1;
-			dcm2Apar.bTemp[m] = AD7814_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, BOARD_T_CS, BEX_ADDR);
+			dcm2Apar.bTemp[m] = AD7814_SPI_bitbang(&dcm2ModSpi, BOARD_T_CS);
 		}
 
 		// read temperatures B band
@@ -1904,13 +2084,11 @@ int dcm2_readAllModTemps(void)
 			address = DCM2_SSBADDR;
 			buffer[0] = dcm2sw.ssbb[m];  // I2C subsubbus address
 			I2CSEND1;
-			dcm2Bpar.bTemp[m] = AD7814_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, BOARD_T_CS, BEX_ADDR);
+			dcm2Bpar.bTemp[m] = AD7814_SPI_bitbang(&dcm2ModSpi, BOARD_T_CS);
 		}
 	}
-	// close switches
+	// close switches; closeI2Cssbus() releases the I2C bus
 	int I2CStat = closeI2Cssbus(DCM2_SBADDR, DCM2_SSBADDR);
-	// release I2C bus
-	i2cBusBusy = 0;
 
 	return I2CStat;
 
@@ -1927,73 +2105,15 @@ int dcm2_readAllModTemps(void)
   address the interface before use, and close after.  Also requires
   previous single call to initialize interface chip.
 
-  \param  val  value to convert and send
+  \param  p    bus expander pin set.
+  \param  cs   chip select mask.
+  \param  vdd  ADC reference voltage.
   \return voltage, or (9000 + NB I2C error code) for bus errors.
 */
-float AD7860_SPI_bitbang(BYTE spi_clk_m, BYTE spi_dat_m, BYTE spi_csb_m, float vdd, BYTE addr)
+float AD7860_SPI_bitbang(const struct bexSpiPins *p, BYTE cs, float vdd)
 {
-
-	BYTE x ;                        // Working command byte
-	int I2CStat = 0;                // Comms error counter
-	short unsigned int val = 0;     // ADC value
-	short unsigned int val_m;       // Mask
-
-	// get command state of output pins on interface
-	x = readBEX(addr);
-
-	// COMAP special: force CS& high on all devices to start
-	x |= (QLOG_CS | ILOG_CS | Q_ATTEN_LE | I_ATTEN_LE | BOARD_T_CS);
-
-	// set up for read
-	x |= spi_csb_m;       // ensure CS is high at start
-	x |= spi_clk_m;      // ensure CLK is high at start
-    buffer[0] = 0x01;    // write register
-	buffer[1] = x;
-	I2CSEND2;
-	x &= ~spi_csb_m;      // send CS low to initiate read
-	buffer[1] = x;
-	I2CSEND2;
-
-	// read three cycles of initial zeros
-	val_m = 1 << (3 - 1);
-	while (val_m > 0) {
-		x &= ~spi_clk_m;     // set clock low
-		buffer[1] = x;
-		I2CSEND2;
-		x |= spi_clk_m;      // set clock high
-		buffer[1] = x;
-		I2CSEND2;
-		val_m >>= 1;
-	}
-
-	// step through 16-bit input word, msb to lsb, reading at clock high
-	val_m = 1 << (16 - 1);
-	while (val_m > 0) {
-		// set clock low
-		x &= ~spi_clk_m;
-		buffer[0] = 0x01;
-		buffer[1] = x;
-		I2CSEND2;
-		// set clock high
-		x |= spi_clk_m;
-		buffer[1] = x;
-		I2CSEND2;
-		// read bit
-		buffer[0] = 0x00;
-		I2CSEND1;
-		I2CREAD1;
-		// put bit in word and rotate mask for next-LSB
-		if (buffer[0] & (unsigned short)spi_dat_m) val |= val_m;
-		val_m >>= 1;
-	}
-
-	// all done. clock low, then deselect with CS& high
-	buffer[0] = 0x01;
-	x &= ~spi_clk_m;
-	buffer[1] = x;
-	x |= spi_csb_m;
-	buffer[1] = x;
-	I2CStat = I2CSEND2;
+	unsigned short val;  // ADC value
+	int I2CStat = bexSpiXfer(p, cs, 3, 16, 1, 0, &val, 1);  // three leading zeros, then MSB first
 
 	return ( I2CStat ? (float)(9000+I2CStat) : (float)val*vdd/65536. );
 }
@@ -2017,9 +2137,7 @@ int dcm2_readAllModTotPwr(void)
 
 	// check that I2C bus is available, else return
 	// use this approach to lock bus during multiple readouts
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	int m;  // loop counter
 	for (m=0; m<NRX; m++){
@@ -2032,8 +2150,8 @@ int dcm2_readAllModTotPwr(void)
 			address = DCM2_SSBADDR;
 			buffer[0] = dcm2sw.ssbb[m];  // I2C subsubbus address
 			I2CSEND1;
-			dcm2Bpar.powDetQ[m] = AD7860_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, QLOG_CS, ADCVREF, BEX_ADDR);
-			dcm2Bpar.powDetI[m] = AD7860_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, ILOG_CS, ADCVREF, BEX_ADDR);
+			dcm2Bpar.powDetQ[m] = AD7860_SPI_bitbang(&dcm2ModSpi, QLOG_CS, ADCVREF);
+			dcm2Bpar.powDetI[m] = AD7860_SPI_bitbang(&dcm2ModSpi, ILOG_CS, ADCVREF);
 			dcm2Bpar.powDetI[m] = (dcm2Bpar.powDetI[m] < ADCVREF ? dcm2Bpar.powDetI[m]*DBMSCALE + DBMOFFSET : -99.);
 			dcm2Bpar.powDetQ[m] = (dcm2Bpar.powDetQ[m] < ADCVREF ? dcm2Bpar.powDetQ[m]*DBMSCALE + DBMOFFSET : -99.);
 		}
@@ -2047,8 +2165,8 @@ int dcm2_readAllModTotPwr(void)
 			address = DCM2_SSBADDR;
 			buffer[0] = dcm2sw.ssba[m];  // I2C subsubbus address
 			I2CSEND1;
-			dcm2Apar.powDetQ[m] = AD7860_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, QLOG_CS, ADCVREF, BEX_ADDR);
-			dcm2Apar.powDetI[m] = AD7860_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, ILOG_CS, ADCVREF, BEX_ADDR);
+			dcm2Apar.powDetQ[m] = AD7860_SPI_bitbang(&dcm2ModSpi, QLOG_CS, ADCVREF);
+			dcm2Apar.powDetI[m] = AD7860_SPI_bitbang(&dcm2ModSpi, ILOG_CS, ADCVREF);
 			dcm2Apar.powDetI[m] = (dcm2Apar.powDetI[m] < ADCVREF ? dcm2Apar.powDetI[m]*DBMSCALE + DBMOFFSET : -99.);
 			dcm2Apar.powDetQ[m] = (dcm2Apar.powDetQ[m] < ADCVREF ? dcm2Apar.powDetQ[m]*DBMSCALE + DBMOFFSET : -99.);
 		}
@@ -2079,12 +2197,6 @@ float dcm2_readOneModTotPwr(int m, char *ab, char *iq)
 	// check for freeze
 	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
 
-	// check that I2C bus is available, else return
-	// use this approach to lock bus during multiple readouts
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
-
 	float pdet = -99.;
 	BYTE ssbusAddr, iqSel, chStatus;
 
@@ -2111,6 +2223,10 @@ float dcm2_readOneModTotPwr(int m, char *ab, char *iq)
 		return 8030;
 	}
 
+	// check that I2C bus is available, else return
+	// use this approach to lock bus during multiple readouts
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
+
 	if (!chStatus) {
 		// first set addresses to select band for DCM2 module
 		address = DCM2_SBADDR;     // I2C switch address DCM2_SBADDR for top-level switch
@@ -2121,7 +2237,7 @@ float dcm2_readOneModTotPwr(int m, char *ab, char *iq)
 		buffer[0] = ssbusAddr;
 		I2CSEND1;
 		// read voltage, convert to dBm
-		pdet = AD7860_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, iqSel, ADCVREF, BEX_ADDR);
+		pdet = AD7860_SPI_bitbang(&dcm2ModSpi, iqSel, ADCVREF);
 		pdet = (pdet < ADCVREF ? pdet*DBMSCALE + DBMOFFSET : -99.);
 	}
 
@@ -2143,151 +2259,246 @@ float dcm2_readOneModTotPwr(int m, char *ab, char *iq)
   address the interface before use, and close after.  Also requires
   previous single call to initialize interface chip.
 
+  \param  p      bus expander pin set.
+  \param  le     latch enable mask.
   \param  atten  attenuation to convert and send
+  \param  bits   attenuation word sent.
   \return NB I2C error code for bus errors.
 
 */
-int HMC624_SPI_bitbang(BYTE spi_clk_m, BYTE spi_dat_m, BYTE spi_csb_m, float atten, BYTE addr, BYTE *bits)
+int HMC624_SPI_bitbang(const struct bexSpiPins *p, BYTE le, float atten, BYTE *bits)
 {
-
-	BYTE x = 0;                       // working byte
-	int I2CStat = 0;                  // comms errors
-	BYTE attenBits, attenBits_m;    // binary value word and mask
+	unsigned short w;   // data word as sent
 
 	if (atten < 0.) atten = 0.;
 	if (atten > MAXATTEN) atten = MAXATTEN;
-    attenBits = (BYTE)round(atten*2);
- 	*bits = attenBits;
+	*bits = (BYTE)round(atten*2);
+	w = ~*bits & 0x3f;  // bit inversion: 0 is logical TRUE
 
-	// get command state of output pins on interface
-	x = readBEX(addr);
+	return ( bexSpiXfer(p, le, 0, 6, 1, &w, 0, 0) );
+}
 
-	// COMAP special: force CS& high on all devices to start
-	x |= (QLOG_CS | ILOG_CS | Q_ATTEN_LE | I_ATTEN_LE | BOARD_T_CS);
+/********************************************************************/
+/**
+  \brief Open the DCM2 switches to several modules at once.
 
-    buffer[0] = 0x01;    // write register
-	address = addr;      // I2C address for BEX chip on board
-	// set up for read
-	x |= spi_csb_m;       // ensure CS is high at start
-	x |= spi_clk_m;      // ensure CLK is high at start
-	buffer[1] = x;
-	I2CStat = I2CSEND2;
-	if (I2CStat) return (9000+I2CStat);
+  Sets each top-level group's sub-sub-bus switch to all of its selected
+  modules, then opens the groups together, so that the following BEX writes
+  reach every selected module.  Nothing can be read back while more than one
+  module is selected.  Call with the I2C bus locked, and close with
+  closeI2Cssbus(DCM2_SBADDR, DCM2_SSBADDR).
 
-	x &= ~spi_csb_m;      // send CS low to initiate read
-	buffer[1] = x;
-	I2CSEND2;
+  \param  sel  module selection, nonzero to select; sel[0] is band A, sel[1] band B.
+  \return Zero on success, else NB I2C error code for the first failed write.
+*/
+static int dcm2_openModules(BYTE sel[2][NRX])
+{
+	BYTE ssb[8] = {0}, sb = 0;  // sub-sub-bus setting for each top-level channel
+	int m, k, stat;
+
+	for (m = 0; m < NRX; m++) {
+		for (k = 0; k < 8 && !(dcm2sw.sb[m] & (1 << k)); k++);
+		if (k == 8) continue;
+		if (sel[0][m]) ssb[k] |= dcm2sw.ssba[m];
+		if (sel[1][m]) ssb[k] |= dcm2sw.ssbb[m];
+		if (ssb[k]) sb |= (1 << k);
+	}
+	for (k = 0; k < 8; k++) {
+		if (!ssb[k]) continue;
+		address = DCM2_SBADDR;
+		buffer[0] = (1 << k);
+		if ((stat = I2CSEND1)) return stat;
+		address = DCM2_SSBADDR;
+		buffer[0] = ssb[k];
+		if ((stat = I2CSEND1)) return stat;
+	}
+	address = DCM2_SBADDR;
+	buffer[0] = sb;
+	return (I2CSEND1);
+}
+
+/********************************************************************/
+/**
+  \brief Broadcast DCM2 attenuator settings.
 
-	// step through input word with mask; write data with clock low, then raise clock
-	attenBits_m = 1 << (6 - 1);
-	while (attenBits_m > 0) {
-		x &= ~spi_clk_m; // set clock low
-		if (attenBits & attenBits_m) { // look at bit value in word to set data bit
-			x &= ~spi_dat_m;  // bit inversion: 0 is logical TRUE
+  For each distinct attenuation word, selects every live module that needs it
+  on I, Q or both, and clocks it into all of those HMC624s in one SPI frame,
+  so a uniform setting costs a single frame.  Stops at the first I2C error
+  and leaves the remaining channels to dcm2_setEachAtten().  Call with the
+  I2C bus locked.
+
+  \param  want  attenuation words, 2 per dB, indexed [band][iq][m].
+  \param  done  set to 1 for each channel written.
+  \return Zero on success, else NB I2C error code.
+*/
+static int dcm2_bcastAttens(BYTE want[2][2][NRX], BYTE done[2][2][NRX])
+{
+	static const BYTE le[3] = {I_ATTEN_LE | Q_ATTEN_LE, I_ATTEN_LE, Q_ATTEN_LE};
+	struct dcm2params *par[2] = {&dcm2Apar, &dcm2Bpar};
+	BYTE sel[2][NRX], w = 0, attenBits;
+	int b, m, iq, g, nsel, stat;
+
+	while (1) {
+		// next word still to be sent
+		for (b = 0, iq = 2; b < 2 && iq == 2; b++) {
+			for (m = 0; m < NRX && iq == 2; m++) {
+				if (par[b]->status[m]) continue;
+				for (iq = 0; iq < 2 && done[b][iq][m]; iq++);
+				if (iq < 2) w = want[b][iq][m];
+			}
+		}
+		if (iq == 2) return 0;
+
+		// modules that want w on both channels, then on I only, then on Q only
+		for (g = 0; g < 3; g++) {
+			for (b = 0, nsel = 0; b < 2; b++) {
+				for (m = 0; m < NRX; m++) {
+					sel[b][m] = (!par[b]->status[m]
+							&& ((le[g] & I_ATTEN_LE) ? !done[b][0][m] && want[b][0][m] == w : 1)
+							&& ((le[g] & Q_ATTEN_LE) ? !done[b][1][m] && want[b][1][m] == w : 1));
+					nsel += sel[b][m];
+				}
+			}
+			if (!nsel) continue;
+
+			if ((stat = dcm2_openModules(sel))) return stat;
+			if ((stat = HMC624_SPI_bitbang(&dcm2ModSpi, le[g], w/2., &attenBits))) return stat;
+			for (b = 0; b < 2; b++) {
+				for (m = 0; m < NRX; m++) {
+					if (!sel[b][m]) continue;
+					if (le[g] & I_ATTEN_LE) {par[b]->attenI[m] = attenBits; done[b][0][m] = 1;}
+					if (le[g] & Q_ATTEN_LE) {par[b]->attenQ[m] = attenBits; done[b][1][m] = 1;}
+				}
+			}
 		}
-		else {
-			x |= spi_dat_m;
+	}
+}
+
+/********************************************************************/
+/**
+  \brief Set DCM2 attenuators one module at a time.
+
+  Writes each live channel not yet marked done, for error tracking.  Failed
+  channels read back as 198.  Call with the I2C bus locked.
+
+  \param  want  attenuation words, 2 per dB, indexed [band][iq][m].
+  \param  done  channels already written, skipped.
+  \return NB I2C error code of the last attenuator write.
+*/
+static int dcm2_setEachAtten(BYTE want[2][2][NRX], BYTE done[2][2][NRX])
+{
+	struct dcm2params *par[2] = {&dcm2Apar, &dcm2Bpar};
+	BYTE attenBits;
+	int b, m, I2CStat = 0;
+
+	for (m=0; m<NRX; m++){
+		for (b=0; b<2; b++) {
+			if (par[b]->status[m] || (done[b][0][m] && done[b][1][m])) continue;
+
+			// first set addresses to select a and b channels of DCM2 modules
+			address = DCM2_SBADDR;        // I2C switch address DCM2_SBADDR for top-level switch
+			buffer[0] = dcm2sw.sb[m];     // I2C channel address
+			I2CSEND1;
+			address = DCM2_SSBADDR;       // I2C switch address DCM2_SSBADDR for second-level switch
+			buffer[0] = (b ? dcm2sw.ssbb[m] : dcm2sw.ssba[m]);
+			I2CSEND1;
+
+			if (!done[b][0][m]) {
+				I2CStat = HMC624_SPI_bitbang(&dcm2ModSpi, I_ATTEN_LE, want[b][0][m]/2., &attenBits);
+				par[b]->attenI[m] = (I2CStat ? 198 : attenBits);  // store command bits for atten
+			}
+			if (!done[b][1][m]) {
+				I2CStat = HMC624_SPI_bitbang(&dcm2ModSpi, Q_ATTEN_LE, want[b][1][m]/2., &attenBits);
+				par[b]->attenQ[m] = (I2CStat ? 198 : attenBits);  // store command bits for atten
+			}
 		}
-		buffer[1] = x;
-		I2CSEND2;        // write to bus extender
-		x |= spi_clk_m;  // set clock high, data will be valid here
-		buffer[1] = x;
-		I2CSEND2;        // write to bus extender
-		attenBits_m >>= 1;     // rotate to next-MSB
 	}
+	return I2CStat;
+}
+
+/********************************************************************/
+/**
+  \brief Set DCM2 attenuators for all live modules.
 
-	// done, set CS high to terminate SPI write
-	x |= spi_csb_m;
-	buffer[1] = x;
-	I2CStat += I2CSEND2;
+  Broadcasts when dcm2AttenBcast and bexSpiBurst are set (the legacy
+  bit-bang pattern reads the BEX back, which can't be done with several
+  modules selected), then writes any remaining channels one by one.  Call
+  with the I2C bus locked.
 
-	return ( I2CStat );
+  \param  want  attenuation words, 2 per dB, indexed [band][iq][m].
+  \param  skip  channels to leave alone, indexed as want; 0 for none.
+  \return NB I2C error code of the last individual write, else zero.
+*/
+static int dcm2_setAttens(BYTE want[2][2][NRX], const BYTE skip[2][2][NRX])
+{
+	BYTE done[2][2][NRX];
 
+	if (skip) memcpy(done, skip, sizeof(done));
+	else memset(done, 0, sizeof(done));
+	if (dcm2AttenBcast && bexSpiBurst) dcm2_bcastAttens(want, done);
+	return (dcm2_setEachAtten(want, done));
 }
 
 /********************************************************************/
 /**
-  \brief Set all DCM2 attenuators.
+  \brief Set one DCM2 attenuator.
 
-  This command sets the attenuators in the DCM2 modules
+  This command sets one attenuator in a DCM2 module, through
+  dcm2_setAttens() with every other channel skipped.
 
-  \param  inp  select on a for attenuation.
-  \param  m    mth receiver.
-  \param  ab   A or B channel
-  \param  iq   I or Q channel
+  \param  m      mth receiver.
+  \param  ab     A or B channel
+  \param  iq     I or Q channel
   \param  atten  attenuation value.
-  \return Zero on success, -1 for invalid selection, else number of I2C read fails.
+  \return Zero on success, -10, -20 or -40 for invalid m, ab or iq, -30 if
+          the module is blocked, else NB I2C error code.
 */
 int dcm2_setAtten(int m, char *ab, char *iq, float atten)
 {
-
-
 	if (foundLNAbiasSys) return WRONGBOX;  // return if no DCM2 is present
 
-	BYTE ssb;         // subsubbus address
-	BYTE attenBits;   // attenuator command bits
-	                  // dcm2parPtr defined globally
-	struct dcm2params *dcm2parPtr; // pointer to structure of form dcm2params
+	struct dcm2params *par[2] = {&dcm2Apar, &dcm2Bpar};
+	BYTE want[2][2][NRX], skip[2][2][NRX];
+	int b, i, rtn;
 
 	// check for freeze
 	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
 
-	// check for out-of-range channel number
-	if (m > NRX) {
-		return -10;
-	}
-	// select card for band A or B, set pointer to correct parameter structure
-	if (!strcasecmp(ab, "a")) {
-		ssb = dcm2sw.ssba[m];
-		dcm2parPtr = &dcm2Apar;
-	} else if (!strcasecmp(ab, "b")) {
-		ssb = dcm2sw.ssbb[m];
-		dcm2parPtr = &dcm2Bpar;
-	} else {
-		return -20;
-	}
+	// check selection
+	if (m < 0 || m >= NRX) return -10;
+	if (!strcasecmp(ab, "a")) b = 0;
+	else if (!strcasecmp(ab, "b")) b = 1;
+	else return -20;
+	if (!strcasecmp(iq, "i")) i = 0;
+	else if (!strcasecmp(iq, "q")) i = 1;
+	else return -40;
+	if (par[b]->status[m]) return -30;  // return if channel is blocked
 
-	if (!dcm2parPtr->status) {
-		return -30;  // return if channel is blocked
-	}
+	// check that I2C bus is available, else return
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
-	// open communication to DCM2 module
-	int I2CStatus = openI2Cssbus(DCM2_SBADDR, dcm2sw.sb[m], DCM2_SSBADDR, ssb); // get bus control
-	if (I2CStatus) return (I2CStatus);
+	if (atten < 0.) atten = 0.;
+	if (atten > MAXATTEN) atten = MAXATTEN;
+	memset(want, 0, sizeof(want));
+	memset(skip, 1, sizeof(skip));
+	want[b][i][m] = (BYTE)round(atten*2);
+	skip[b][i][m] = 0;
+	rtn = dcm2_setAttens(want, skip);
 
-	// send command
-	// select I or Q input on card
-	if (!strcasecmp(iq, "i")) {
-		I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, I_ATTEN_LE, atten, BEX_ADDR, &attenBits);
-		if (!I2CStat) {
-			dcm2parPtr->attenI[m] = attenBits;  // store command byte for atten
-		} else {
-			dcm2parPtr->attenI[m] = 198;
-		}
-	} else if (!strcasecmp(iq, "q")){
-		I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, Q_ATTEN_LE, atten, BEX_ADDR, &attenBits);
-		if (!I2CStat) {
-			dcm2parPtr->attenQ[m] = attenBits;  // store command byte for atten
-		} else {
-			dcm2parPtr->attenQ[m] = 198;
-		}
-	} else {  // invalid choice for IQ channels
+	// close up and return
+	if (rtn) {
 		closeI2Cssbus(DCM2_SBADDR, DCM2_SSBADDR);
-		return (-40);
+		return rtn;
 	}
-
-	// close up and return
 	return (closeI2Cssbus(DCM2_SBADDR, DCM2_SSBADDR));
 }
 
-/*******************************************************************************************/
+/********************************************************************/
 /**
   \brief Set all DCM2 attenuators.
 
   This command sets the attenuators in the DCM2 modules
 
-  \param  inp  select on a for attenuation.
-  \param  m    mth receiver.
   \param  atten  attenuation value.
   \return Zero on success, -1 for invalid selection, else number of I2C read fails.
 */
@@ -2301,67 +2512,68 @@ int dcm2_setAllAttens(float atten)
 
 	// check that I2C bus is available, else return
 	// use the explicit method here and below to simplify bus lock/unlock
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
-	int m;  // loop counter
-	int I2CStat = 0;
-	BYTE attenBits;
+	BYTE want[2][2][NRX];
 
-	// do this one atten at a time for error tracking
-	for (m=0; m<NRX; m++){
+	if (atten < 0.) atten = 0.;
+	if (atten > MAXATTEN) atten = MAXATTEN;
+	memset(want, (BYTE)round(atten*2), sizeof(want));
+	dcm2_setAttens(want, 0);
 
-		if (!dcm2Apar.status[m]) {
-			// first set addresses to select a and b channels of DCM2 modules
-			address = DCM2_SBADDR;        // I2C switch address DCM2_SBADDR for top-level switch
-			buffer[0] = dcm2sw.sb[m];   // I2C channel address  0x01 for second-level switch
-			I2CSEND1;
-			address = DCM2_SSBADDR;        // I2C switch address DCM2_SSBADDR for second-level switch, band A
-			buffer[0] = dcm2sw.ssba[m];
-			I2CSEND1;
+	// close up and return; will show error if bus writes are a problem
+	return (closeI2Cssbus(DCM2_SBADDR, DCM2_SSBADDR));
+}
 
-			I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, I_ATTEN_LE, atten, BEX_ADDR, &attenBits);
-			if (!I2CStat) {
-				dcm2Apar.attenI[m] = attenBits;  // store command bits for atten
-			} else {
-				dcm2Apar.attenI[m] = 198;
-			}
+/********************************************************************/
+/**
+  \brief Set a batch of DCM2 attenuators.
 
-			I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, Q_ATTEN_LE, atten, BEX_ADDR, &attenBits);
-			if (!I2CStat) {
-				dcm2Apar.attenQ[m] = attenBits;  // store command bits for atten
-			} else {
-				dcm2Apar.attenQ[m] = 198;
-			}
-		}
+  Writes the staged attenuators of struct biasBatch, broadcasting common
+  settings as for dcm2_setAllAttens(), under a single hold of the I2C bus.
+  Blocked modules are skipped, and their staged attenuators count as failed.
 
-		if (!dcm2Bpar.status[m]) {
-			// first set addresses to select a and b channels of DCM2 modules
-			address = DCM2_SBADDR;        // I2C switch address DCM2_SBADDR for top-level switch
-			buffer[0] = dcm2sw.sb[m];   // I2C channel address  0x01 for second-level switch
-			I2CSEND1;
-			address = DCM2_SSBADDR;        // I2C switch address DCM2_SSBADDR for second-level switch, band A
-			buffer[0] = dcm2sw.ssbb[m];
-			I2CSEND1;
+  \param  b  staged set points.
+  \return Zero on success, else the number of failed or skipped attenuator
+          writes, plus one if closing the bus switches failed.
+*/
+int dcm2_setAttenBatch(const struct biasBatch *b)
+{
+	if (foundLNAbiasSys) return WRONGBOX;  // return if no DCM2 is present
 
-			I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, I_ATTEN_LE, atten, BEX_ADDR, &attenBits);
-			if (!I2CStat) {
-				dcm2Bpar.attenI[m] = attenBits;  // store command bits for atten
-			} else {
-				dcm2Bpar.attenI[m] = 198;
-			}
+	struct dcm2params *par[2] = {&dcm2Apar, &dcm2Bpar};
+	BYTE want[2][2][NRX], skip[2][2][NRX];
+	int i, j, m, nfail = 0;
 
-			I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, Q_ATTEN_LE, atten, BEX_ADDR, &attenBits);
-			if (!I2CStat) {
-				dcm2Bpar.attenQ[m] = attenBits;  // store command bits for atten
-			} else {
-				dcm2Bpar.attenQ[m] = 198;
+	// check for freeze
+	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
+
+	// check that I2C bus is available, else return
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
+
+	memcpy(want, b->atten, sizeof(want));
+	for (i=0; i<2; i++) {
+		for (j=0; j<2; j++) {
+			for (m=0; m<NRX; m++) skip[i][j][m] = !b->setA[i][j][m];
+		}
+	}
+	dcm2_setAttens(want, skip);
+
+	// failed channels read back as 198, see dcm2_setEachAtten(); blocked
+	// modules were not written at all
+	for (i=0; i<2; i++) {
+		for (m=0; m<NRX; m++) {
+			if (par[i]->status[m]) {
+				nfail += (b->setA[i][0][m] != 0) + (b->setA[i][1][m] != 0);
+				continue;
 			}
+			if (b->setA[i][0][m] && par[i]->attenI[m] == 198) nfail += 1;
+			if (b->setA[i][1][m] && par[i]->attenQ[m] == 198) nfail += 1;
 		}
 	}
-	    // close up and return; will show error if bus writes are a problem
-		return (closeI2Cssbus(DCM2_SBADDR, DCM2_SSBADDR));
+
+	// close up and return
+	return (nfail + (closeI2Cssbus(DCM2_SBADDR, DCM2_SSBADDR) != 0));
 }
 
 /********************************************************************/
@@ -2426,7 +2638,7 @@ int dcm2_setPow(int m, char *ab, char *iq, float pow)
 
 	for (int i=0; i<5; i++) {  // iterate to find closest atten value; max iterations hard-coded here
 		// read current power level
-		float pval = AD7860_SPI_bitbang(SPI_CLK_M, SPI_MISO_M, cs, ADCVREF, BEX_ADDR);
+		float pval = AD7860_SPI_bitbang(&dcm2ModSpi, cs, ADCVREF);
 		pval = (pval < ADCVREF ? pval*DBMSCALE + DBMOFFSET : -99.);
 		// calculate new attenuation value
 		float atten = (pval - pow) +  currAtten;
@@ -2434,7 +2646,7 @@ int dcm2_setPow(int m, char *ab, char *iq, float pow)
 		// send command to attenuator
 		// select I or Q input on card, then set new atten val.  return with error code for bus write problem.
 		if (!strcasecmp(iq, "i")) {
-			I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, I_ATTEN_LE, atten, BEX_ADDR, &attenBits);
+			I2CStat = HMC624_SPI_bitbang(&dcm2ModSpi, I_ATTEN_LE, atten, &attenBits);
 			if (!I2CStat) {
 				dcm2parPtr->attenI[m] = attenBits;  // store command byte for atten
 				currAtten = ((float) attenBits)/2.;
@@ -2442,7 +2654,7 @@ int dcm2_setPow(int m, char *ab, char *iq, float pow)
 				break;
 			}
 		} else if (!strcasecmp(iq, "q")){
-			I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, Q_ATTEN_LE, atten, BEX_ADDR, &attenBits);
+			I2CStat = HMC624_SPI_bitbang(&dcm2ModSpi, Q_ATTEN_LE, atten, &attenBits);
 			if (!I2CStat) {
 				dcm2parPtr->attenQ[m] = attenBits;  // store command byte for atten
 				currAtten = ((float) attenBits)/2.;
@@ -2553,6 +2765,10 @@ int init_dcm2(void)
 		J2[28].set();  // reset I2C bus switches in case a subsub bus is stuck
 		OSTimeDly(1);
 		J2[28].clr();  // enable I2C switches
+		i2cSwitchInvalidate();
+#ifdef SIMULATE
+		i2csim_switchReset();
+#endif
 
 		// select, configure, and initialize B bank; keep track in status element
 		address = 0x77;            // I2C switch address 0x77 for top-level switch
@@ -2566,13 +2782,18 @@ int init_dcm2(void)
 		J2[28].set();  // reset I2C bus switches in case a subsub bus is stuck
 		OSTimeDly(1);
 		J2[28].clr();  // enable I2C switches
+		i2cSwitchInvalidate();
+#ifdef SIMULATE
+		i2csim_switchReset();
+#endif
 	}
 	closeI2Cssbus(0x77, 0x73);
 
 	// Configure and initialize BEX on main board
 	openI2Csbus(0x77, DCM2PERIPH_SBADDR);
 	configBEX(BEXCONF0, BEX_ADDR0);
-	writeBEX(BEXINIT0, BEX_ADDR0);
+	dcm2MBout = BEXINIT0;
+	writeBEX(dcm2MBout, BEX_ADDR0);
 	closeI2Csbus(0x77);
 
 	// Read out once to initialize
@@ -2919,7 +3140,7 @@ struct vaneParams vanePar = {
 };
 
 // Scale and offset for vane ADC channels
-// order: Vin, NC, NC, NC, angle, temp_load, temp_outside, temp_shroud
+// order: Vin, NC (motor current if fitted, VANECURRCHAN), NC, NC, angle, temp_load, temp_outside, temp_shroud
 const float offset[8] = {0, 0, 0, 0, 0., -50., -50., -50.};
 const float scale[8] = {10., -10., 1., 1., 1., 100., 100., 100.};
 
@@ -3029,110 +3250,29 @@ int vane_angle(void)
 }
 
 /**
-  \brief Move vane in or out.
-
-  This function toggles bits on vane control I2C interface card to drive vane in and out of beam
-  (obs and cal positions).
+  \brief Get vane motor current.
 
-  Bus expander should be configured in an init file
+  This function reads the vane motor current channel.
 
-  \par inp  string: "obs" or "0" for vane out of beam, else vane is in beam
+  Bus expander must be configured externally
 
-  \return NB error code for write to BEX.
+  \return NB error code for write to ADC.
 */
-int vane_obscal(char *inp)
+int vane_current(void)
 {
-	if (!foundLNAbiasSys) return WRONGBOX;
-
-	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}                    // check for freeze
-
-	int tStallCheck = (int)((float)TICKS_PER_SECOND * VANESTALLTIME);  // time between stall checks
-	int nmax = (int) VANETIMEOUT/VANESTALLTIME;  // number of stall checks to timeout
-	int n;  // loop counter
-	float lastAng = -1000.;   // last angle read, for stall comparison
-
-	// open communication channel
-	int I2CStatus = openI2Cssbus(SB_SBADDR, I2CSSB_I2CADDR, SB_SSBADDR, VANE_SWADDR);
-	if (I2CStatus) return (I2CStatus);
-
-	// ensure delay with motor stopped before further motion
-	I2CStatus = vane_relayCtrl("man");        // stop motor if running
-	OSTimeDly( TICKS_PER_SECOND * 3 / 2 );    // delay 1.5 sec before anything else
+	unsigned short int rawu;
 
-	// move to obs or cal positions
-	if (!strcasecmp(inp, "obs") || !strcasecmp(inp, "0")) {
-		I2CStatus = vane_relayCtrl("obs");  // pin value low to drive to obs, all others but LED high
-    	if (!I2CStatus) {
-    		for (n=0; n<nmax; n++){
-    		    // read ADC to get angle
-    			vane_angle();
-     			// check vane position
-    			if (fabsf(vanePar.vaneAngleDeg - VANESWINGANGLE) < VANEOBSERRANGLE) {
-    				// vane reaches obs position
-        			OSTimeDly(TICKS_PER_SECOND);  // 1 sec settling delay before checking position
-    				// check final position
-        			vane_angle();
-    				if (fabsf(vanePar.vaneAngleDeg - VANESWINGANGLE) < VANEOBSERRANGLE) {
-    					vanePar.vaneFlag = 0;  // record position as obs
-    					break;
-    				} else {
-    					vanePar.vaneFlag = 6;  // record position as near obs
-    					break;
-    				}
-    			}
-    			if (fabsf(vanePar.vaneAngleDeg - lastAng) <= STALLERRANG) {
-    				vanePar.vaneFlag = 2; // record position as stalled
-    				break;
-    			}
-    			lastAng = vanePar.vaneAngleDeg;  // update angle for stall check
-    			OSTimeDly(tStallCheck);  // wait for next angle check
-    		}
-			if (n == nmax) {  // timeout
-				vanePar.vaneFlag = 3; // timeout; unknown position
-			}
-    	} else {  // I2C bus error
-			vanePar.vaneFlag = 4;
-    	}
-	} else 	if (!strcasecmp(inp, "cal") || !strcasecmp(inp, "1")) {
-		I2CStatus = vane_relayCtrl("cal");  // pin value low to drive to obs, all others but LED high
-    	if (!I2CStatus) {
-    		for (n=0; n<nmax; n++){
-    		    // read ADC to get angle
-    			vane_angle();
-     			// check vane position
-    			if (fabsf(vanePar.vaneAngleDeg) < VANECALERRANGLE) {
-    				// vane should be in cal position
-        			OSTimeDly(TICKS_PER_SECOND);  // 1 sec settling delay before checking final
-    				// check final position
-        			vane_angle();
-    	   			if (fabsf(vanePar.vaneAngleDeg) < VANECALERRANGLE) {
-    					vanePar.vaneFlag = 1;  // record position as cal
-    					break;
-    				} else {
-    					vanePar.vaneFlag = 7;  // record position as near cal
-    					break;
-    				}
-    			}
-    			if (fabsf(vanePar.vaneAngleDeg - lastAng) <= STALLERRANG) {
-    				vanePar.vaneFlag = 2; // record position as stalled
-    				break;
-    			}
-    			lastAng = vanePar.vaneAngleDeg;  // update angle for stall check
-    			OSTimeDly(tStallCheck);  // wait for next angle check
-    		}
-			if (n == nmax) {  // timeout
-				vanePar.vaneFlag = 3; // timeout; unknown position
-			}
-    	} else {  // I2C bus error
-			vanePar.vaneFlag = 4; // record command position as in beam, actual position unknown
-    	}
+	address = SBADC_ADDR;               // ADC device address on I2C bus (same hardware as saddlebags)
+	buffer[0] = (BYTE)pcRead.add[VANECURRCHAN];    // internal address for channel
+	int I2CStatus = I2CSEND1;           // send command for conversion
+	I2CREAD2;                           // read device buffer back
+	if (I2CStatus == 0) {                 // convert if valid, else write error defaults
+		rawu =(unsigned short int)(((unsigned char)buffer[0]<<8) | (unsigned char)buffer[1]);
+		vanePar.adcv[VANECURRCHAN] = rawu*scale[VANECURRCHAN]*4.096/65535 + offset[VANECURRCHAN];
+	} else {
+		vanePar.adcv[VANECURRCHAN] = 9999.;  // error condition
 	}
-
-	vane_relayCtrl("man");  // turn off motor
-	// clean up and return
-	closeI2Cssbus(SB_SBADDR, SB_SSBADDR);
-
-	return(I2CStatus);
+	return (I2CStatus);
 }
 
 
@@ -3195,14 +3335,11 @@ int comap_presets(const flash_t *flash)
 	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
 
 	// check that I2C bus is available, else return
-	if (i2cBusBusy) {busNoLockCtr += 1; return I2CBUSERRVAL;}
-	i2cBusBusy = 1;
-	busLockCtr += 1;
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
 
 	// Data written in control.cpp, approx line 405; structure defined in zpec.h
 	short i, j, k;
 	int rtn = 0;
-	BYTE attenBits;
 
 	if (foundLNAbiasSys) {  // set LNA bias
 		for (i=0; i<NRX; i++) {
@@ -3215,56 +3352,16 @@ int comap_presets(const flash_t *flash)
 			}
 		}
 	} else {  // set DCM2 attens
-		for (i=0; i<NRX; i++) {
-		// do this one atten at a time for error tracking
-			if (!dcm2Apar.status[i]) {
-				// first set addresses to select a and b channels of DCM2 modules
-				address = DCM2_SBADDR;        // I2C switch address DCM2_SBADDR for top-level switch
-				buffer[0] = dcm2sw.sb[i];     // I2C channel address
-				I2CSEND1;
-				address = DCM2_SSBADDR;        // I2C switch address DCM2_SSBADDR for second-level switch, band A
-				buffer[0] = dcm2sw.ssba[i];
-				I2CSEND1;
-				//HMC624_SPI_bitbang(BYTE spi_clk_m, BYTE spi_dat_m, BYTE spi_csb_m, float atten, BYTE addr, BYTE *bits)
-				I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, I_ATTEN_LE, ((float)flash->attenAI[i])/2., BEX_ADDR, &attenBits);
-				if (!I2CStat) {
-					dcm2Apar.attenI[i] = attenBits;  // store command bits for atten
-				} else {
-					dcm2Apar.attenI[i] = 198;
-				}
-				I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, Q_ATTEN_LE, ((float)flash->attenAQ[i])/2., BEX_ADDR, &attenBits);
-				if (!I2CStat) {
-					dcm2Apar.attenQ[i] = attenBits;  // store command bits for atten
-				} else {
-					dcm2Apar.attenQ[i] = 198;
-				}
-			}
-			if (!dcm2Bpar.status[i]) {
-				// first set addresses to select a and b channels of DCM2 modules
-				address = DCM2_SBADDR;        // I2C switch address DCM2_SBADDR for top-level switch
-				buffer[0] = dcm2sw.sb[i];   // I2C channel address  0x01 for second-level switch
-				I2CSEND1;
-				address = DCM2_SSBADDR;        // I2C switch address DCM2_SSBADDR for second-level switch, band A
-				buffer[0] = dcm2sw.ssbb[i];
-				I2CSEND1;
-				I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, I_ATTEN_LE, ((float)flash->attenBI[i])/2., BEX_ADDR, &attenBits);
-				if (!I2CStat) {
-					dcm2Bpar.attenI[i] = attenBits;  // store command bits for atten
-				} else {
-					dcm2Bpar.attenI[i] = 198;
-				}
-				I2CStat = HMC624_SPI_bitbang(SPI_CLK_M, SPI_MOSI_M, Q_ATTEN_LE, ((float)flash->attenBQ[i])/2., BEX_ADDR, &attenBits);
-				if (!I2CStat) {
-					dcm2Bpar.attenQ[i] = attenBits;  // store command bits for atten
-				} else {
-					dcm2Bpar.attenQ[i] = 198;
-				}
-			}
-		}
+		BYTE want[2][2][NRX];
+		memcpy(want[0][0], flash->attenAI, NRX);
+		memcpy(want[0][1], flash->attenAQ, NRX);
+		memcpy(want[1][0], flash->attenBI, NRX);
+		memcpy(want[1][1], flash->attenBQ, NRX);
+		I2CStat = dcm2_setAttens(want, 0);
 	}
 
 	// release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
 
 	return I2CStat;
 }
@@ -3317,14 +3414,15 @@ void init_bias(void)
 /**
   \brief Initialize hardware.
 
-  This routine is called automatically at boot (for Argus hardware).
+  This routine is called automatically at boot (for Argus hardware), after
+  i2cBusInit() and i2cTraceInit(), and again by the init command.
 
   \param  flash  User flash data structure.
 */
 void argus_init(const flash_t *flash)
 {
 
-	i2cBusBusy = 1;  // lock bus from outside use during initialization
+	i2cBusLock(__FUNCTION__);  // lock bus from outside use during initialization
 
 	// get voltage divider value from flash
 	printf("argus_init: flash vgdiv %f\n", flash->gvdiv);
@@ -3355,6 +3453,10 @@ void argus_init(const flash_t *flash)
 	J2[28].set();  // reset
 	OSTimeDly(1);
 	J2[28].clr();  // enable I2C switches
+	i2cSwitchInvalidate();
+#ifdef SIMULATE
+	i2csim_reset(FOUNDLNABIASSYS);  // simulated bus: chassis topology, power-on device state
+#endif
 
 	// Try to detect bias system power control card is there
 	// If so, initialize for the bias system; else initialize for DCM2 control
@@ -3376,6 +3478,7 @@ void argus_init(const flash_t *flash)
 #else
 	foundLNAbiasSys = FOUNDLNABIASSYS;
 #endif
+	i2cSwitchInvalidate();  // sub-bus switch address depends on hardware type
 
 	if (foundLNAbiasSys) {
 		init_bias();       // initialize front-end LNA bias system
@@ -3386,8 +3489,16 @@ void argus_init(const flash_t *flash)
 	}
 
     // release I2C bus
-	i2cBusBusy = 0;
+	i2cBusUnlock();
+
+	// start background monitor point sweeps
+	argus_startSampler();
 
+	// LNA power sequences and vane moves run in their own tasks from here on
+	if (foundLNAbiasSys) {
+		argus_startLnaSeq();
+		vane_startTask();
+	}
 }
 
 
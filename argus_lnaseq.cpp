@@ -0,0 +1,320 @@
+/**
+  \file
+  \author Andy Harris
+  \brief  LNA power sequencer for Argus hardware.
+
+  LNA power comes up in three steps, VCC, then the gate amplifier supplies,
+  then VDS, and goes down in the reverse order, with settling time between
+  steps.  A sequencer task runs the steps so that commands return as soon as
+  a sequence has started.  The I2C bus is held only while a step writes to
+  the power control card, so monitor queries carry on in between.
+
+  With lnaSeqEarly set, each wait ends as soon as the rails just switched
+  read steady in pwrCtrlPar[], after a minimum of LNASEQMINMS; the fixed
+  wait remains the upper limit.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <ucos.h>
+#include <constants.h>
+
+#include "argus.h"
+
+extern BYTE address;   // I2C transaction globals, defined in argus_io.cpp
+extern BYTE buffer[];
+extern int I2CStat;
+extern BYTE ctlVDS, ctlnVamp, ctlpVamp, ctlVCC, FPLED;  // power control board PIO bits
+
+int lnaSeqStep = 0;                // sequence step in progress, 0 when idle
+short lnaSeqState = 0;             // power state being sequenced to
+int lnaSeqRtn = 0;                 // return value of the latest completed sequence
+unsigned char lnaSeqEarly = 0;     // end settling waits when rails are steady when = 1
+
+static unsigned long seqCount = 0;   // completed sequences
+static OS_TCB *seqTcb = 0;           // task running the sequence, 0 before it starts
+static OS_SEM seqSem;                // posted to start the sequencer task
+static OS_CRIT seqLock;              // guards lnaSeqStep while starting
+static char seqReady = 0;            // set once the sequencer task is running
+static DWORD seqStack[USER_TASK_STK_SIZE] __attribute__( ( aligned( 4 ) ) );
+
+/****************************************************************************************/
+/**
+  \brief Change power control PIO bits.
+
+  Reads the PIO port to establish the present state, then sets and clears the
+  given bits.  Holds the I2C bus for this write only.
+
+  \param  set  bits to set.
+  \param  clr  bits to clear.
+  \return Zero on success, else number of failed I2C writes or I2CBUSERRVAL.
+*/
+static int lnaSeqPIO(BYTE set, BYTE clr)
+{
+	BYTE pioState;
+
+	if (i2cBusLock(__FUNCTION__)) return I2CBUSERRVAL;
+
+	// set I2C bus switch for power control card in backplane
+	address = I2CSWITCH_BP;
+	buffer[0] = PWCTL_I2CADDR;
+	I2CStat = I2CSEND1;
+
+	// Read port register to establish present state
+	address = 0x21;  // PIO I2C address
+	buffer[0] = 0x00;
+	I2CStat += I2CSEND1;
+	I2CREAD1;
+	pioState = buffer[0];
+
+	address = 0x21;  // PIO I2C address
+	buffer[0] = 0x01;
+	buffer[1] = (pioState | set) & ~clr;
+	I2CStat += I2CSEND2;
+
+	// Disconnect I2C sub-bus
+	address = I2CSWITCH_BP;
+	buffer[0] = 0;
+	I2CSEND1;
+
+    // release I2C bus
+	i2cBusUnlock();
+
+	return I2CStat;
+}
+
+/**
+  \brief Wait for switched supplies to settle.
+
+  Waits ms, or with lnaSeqEarly set, until successive readings of the two
+  pwrCtrlPar[] rails agree within LNASEQTOL, but no less than LNASEQMINMS.
+
+  \param  ms  maximum wait [ms].
+  \param  r0  first rail index in pwrCtrlPar[].
+  \param  r1  second rail index, may equal r0.
+*/
+static void lnaSeqSettle(unsigned int ms, int r0, int r1)
+{
+	DWORD t0 = TimeTick;
+	DWORD tmax = (ms*TICKS_PER_SECOND + 999)/1000;
+	DWORD tmin = (LNASEQMINMS*TICKS_PER_SECOND + 999)/1000;
+	float v0 = 0., v1 = 0.;
+	int valid = 0;
+
+	if (!lnaSeqEarly) {
+		OSTimeDly(tmax);
+		return;
+	}
+	while (TimeTick - t0 < tmax) {
+		OSTimeDly(TICKS_PER_SECOND/10);
+		if (argus_readPwrADCs()) {valid = 0; continue;}
+		if (valid && TimeTick - t0 >= tmin
+				&& fabs(pwrCtrlPar[r0] - v0) < LNASEQTOL && fabs(pwrCtrlPar[r1] - v1) < LNASEQTOL) return;
+		v0 = pwrCtrlPar[r0];
+		v1 = pwrCtrlPar[r1];
+		valid = 1;
+	}
+}
+
+/**
+  \brief Run an LNA power sequence.
+
+  Rail indices are those of argus_readPwrADCs(): vds, -15, +15, vcc.
+
+  \param  state  1 for on, 0 for off.
+  \return Zero on success, else sum of step return values.
+*/
+static int lnaSeqRun(short state)
+{
+	int rtn = 0;
+
+	seqTcb = (OS_TCB *)OSTCBCur;
+	if (state == 1) {
+		// turn on VCC (digital) and allow it to stabilize
+		lnaSeqStep = 1;
+		rtn += lnaSeqPIO(ctlVCC, 0);
+		lnaSeqSettle(LNASEQVCCMS, 3, 3);
+		lnaPwrState = 1;  // set state flag
+
+		// initialize DAC values, turn on +/- Vamp (for gates), allow stabilization time
+		lnaSeqStep = 2;
+		argus_setAllBias("g", VGSTART, 0);
+		argus_setAllBias("d", VDSTART, 0);
+		argus_setAllBias("m", VMSTART, 0);
+		rtn += lnaSeqPIO(ctlpVamp | ctlnVamp, 0);
+		lnaSeqSettle(LNASEQAMPMS, 1, 2);
+
+		// turn on VDS (for drains) and LED
+		lnaSeqStep = 3;
+		rtn += lnaSeqPIO(ctlVDS, FPLED);
+	} else {
+		// set power supplies to safe voltages for switching, turn off VDS (drains)
+		lnaSeqStep = 1;
+		argus_setAllBias("g", VGSTART, 0);
+		argus_setAllBias("d", VDSTART, 0);
+		argus_setAllBias("m", VMSTART, 0);
+		rtn += lnaSeqPIO(0, ctlVDS);
+		lnaSeqSettle(LNASEQOFFMS, 0, 0);
+
+		// turn off +/- Vamp (gates)
+		lnaSeqStep = 2;
+		rtn += lnaSeqPIO(0, ctlpVamp | ctlnVamp);
+		lnaSeqSettle(LNASEQOFFMS, 1, 2);
+
+		// turn off VCC (digital) and LED
+		lnaSeqStep = 3;
+		rtn += lnaSeqPIO(FPLED, ctlVCC);
+		lnaPwrState = 0;  // clear state flag
+	}
+
+	lnaSeqRtn = rtn;
+	seqCount += 1;
+	seqTcb = 0;
+	lnaSeqStep = 0;
+
+	return rtn;
+}
+
+/****************************************************************************************/
+/**
+  \brief Sequencer task.  Runs one sequence per post of seqSem.
+*/
+static void lnaSeqTask(void *pd)
+{
+	while (1) {
+		OSSemPend(&seqSem, 0);
+		lnaSeqRun(lnaSeqState);
+	}
+}
+
+/**
+  \brief Start the LNA power sequencer task.
+
+  Call at the end of hardware initialization.  Until then, and if the task
+  can't be created, sequences run in the calling task.  Only the first call
+  does anything, since the task may be waiting on seqSem, or a caller may
+  hold seqLock, when the init command re-runs argus_init().
+*/
+void argus_startLnaSeq(void)
+{
+	static char started = 0;
+
+	if (started) return;
+	started = 1;
+
+	OSSemInit(&seqSem, 0);
+	OSCritInit(&seqLock);
+
+	if (OSTaskCreate(lnaSeqTask, (void *)0, (void *)&seqStack[USER_TASK_STK_SIZE],
+			(void *)&seqStack[0], LNASEQPRIO) == OS_NO_ERR) {
+		seqReady = 1;
+	} else {
+		printf("argus_startLnaSeq: task priority %d unavailable\n", LNASEQPRIO);
+	}
+}
+
+/****************************************************************************************/
+/**
+  \brief Start LNA power sequencing.
+
+  Checks for power supplies in range for ON, but OFF executes regardless of
+  power supply values.  Returns once the sequence has started; follow it with
+  lnaSeqStep, or use argus_lnaPower() to wait for the result.  Without the
+  sequencer task, or when the calling task holds the I2C bus, the sequence
+  runs to completion in the calling task instead.
+
+  \param  state     Power state (1=on, else off).
+  \return Zero when started or already in state; LNASEQBUSYVAL if a sequence
+          is in progress; else a number giving the number of failed I2C writes or,
+          for power supplies out of range, in order of first failure:
+            9995 for Vcc
+            9996 for -Vamp
+            9997 for +Vamp
+            9998 for VDS
+*/
+int argus_lnaPowerStart(short state)
+{
+	if (!foundLNAbiasSys) return WRONGBOX;
+
+	I2CStat = argus_readPwrADCs();
+	// get power supply voltages: returns vds, -15, +15, vcc, vcal, vif, swvif, iif, tamb
+
+	// check for freeze
+	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}
+
+	// check that I2C bus is available, else return
+	if (I2CStat == I2CBUSERRVAL) return I2CBUSERRVAL;
+
+	state = (state == 1);
+	if (state == 1 && lnaPSlimitsBypass != 1) {  // check power supply voltages before on, but skip check for off
+		if (pwrCtrlPar[3] < MINVCCV || pwrCtrlPar[3] > MAXVCCV) return 9995;    //VCC
+		if (pwrCtrlPar[1] < -MAXAMPV || pwrCtrlPar[1] > -MINAMPV) return 9996;  //-15V
+		if (pwrCtrlPar[2] < MINAMPV || pwrCtrlPar[2] > MAXAMPV) return 9997;    //+15
+		if (pwrCtrlPar[0] < MINVDSV || pwrCtrlPar[0] > MAXVDSV) return 9998;    //VDS
+	}
+
+	if (seqReady) OSCritEnter(&seqLock, 0);
+	if (lnaSeqStep) {
+		if (seqReady) OSCritLeave(&seqLock);
+		return LNASEQBUSYVAL;
+	}
+	if (state == lnaPwrState) {
+		if (seqReady) OSCritLeave(&seqLock);
+		return 0;
+	}
+	lnaSeqStep = 1;
+	lnaSeqState = state;
+	if (seqReady) OSCritLeave(&seqLock);
+
+	// a caller holding the I2C bus (argus_init() via init_bias()) would
+	// lock out the sequencer task, so run the sequence here on its hold
+	if (!seqReady || i2cBusHeld()) return (lnaSeqRun(state));
+
+	OSSemPost(&seqSem);
+	return 0;
+}
+
+/**
+  \brief LNA power control.
+
+  This command turns the LNA power on and off in a safe way, and waits for
+  the sequence to finish.  See argus_lnaPowerStart().
+
+  \param  state     Power state (1=on, else off).
+  \return Zero on success, else as for argus_lnaPowerStart(), or the
+          number of failed I2C writes during the sequence.
+*/
+int argus_lnaPower(short state)
+{
+	unsigned long count = seqCount;
+	int rtn;
+
+	rtn = argus_lnaPowerStart(state);
+	if (rtn || !seqReady) return rtn;
+	while (lnaSeqStep) OSTimeDly(1);
+	return (seqCount != count ? lnaSeqRtn : 0);
+}
+
+/**
+  \brief Check whether an LNA power sequence excludes the calling task.
+
+  \return 1 while a sequence run by another task is in progress, else 0.
+*/
+int argus_lnaSeqBusy(void)
+{
+	return (lnaSeqStep && seqTcb != (OS_TCB *)OSTCBCur);
+}
+
+/**
+  \brief Describe LNA power sequencer progress.
+
+  \param  str  Output string.
+  \return Number of characters written.
+*/
+int argus_lnaSeqReport(char *str)
+{
+	if (!lnaSeqStep) return (sprintf(str, "idle"));
+	return (sprintf(str, "sequencing %s, step %d of 3", (lnaSeqState ? "on" : "off"), lnaSeqStep));
+}
@@ -0,0 +1,185 @@
+/**
+  \file
+  \author Andy Harris
+  \brief  Background monitor point sampler for Argus and DCM2 hardware.
+
+  A low-priority task sweeps all monitor point readers into the live parameter
+  structures, copies the results into the back half of a double buffer, and
+  publishes it with a sequence number and time stamp.  JSON queries format from
+  the published snapshot instead of sweeping the I2C bus themselves.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ucos.h>
+#include <constants.h>
+
+#include "argus.h"
+
+unsigned int samplerPeriod = SAMPLERPERIOD;  // sweep period [ms], 0 when stopped
+unsigned long samplerSeq = 0;                // sequence number of latest published sweep
+unsigned int samplerSweepMs = 0;             // duration of latest sweep [ms]
+
+static struct argusSnapshot snap[2];   // double buffer; snap[front] is published
+static int front = 0;
+static OS_CRIT sampleLock;             // one sweep at a time
+static OS_CRIT snapLock;               // held by readers of the published snapshot
+static char started = 0;               // locks initialized by argus_startSampler()
+static DWORD samplerStack[USER_TASK_STK_SIZE] __attribute__( ( aligned( 4 ) ) );
+
+/****************************************************************************************/
+/**
+  \brief Sweep all monitor points and publish a new snapshot.
+
+  Runs every monitor point reader for the detected hardware, copies the
+  results into the back buffer, then swaps buffers.  May be called from any
+  task; concurrent calls are serialized.
+
+  \return Sum of the reader return values; zero on success.
+*/
+int argus_sample(void)
+{
+	struct argusSnapshot *s;
+	DWORD t0;
+	int i, rtn;
+
+	OSCritEnter(&sampleLock, 0);
+	t0 = TimeTick;
+	s = &snap[1 - front];  // back buffer: never seen by readers
+
+	s->lnaPwrState = lnaPwrState;
+	s->rtnLNA = s->rtnBC = s->rtnTherm = s->rtnSbag = s->rtnVane = s->rtnDcm2 = 0;
+	if (foundLNAbiasSys) {
+		s->rtnLNA = argus_readPwrADCs();
+		if (lnaPwrState) {
+			s->rtnLNA += argus_readLNAbiasADCs("vg");
+			s->rtnLNA += argus_readLNAbiasADCs("vd");
+			s->rtnLNA += argus_readLNAbiasADCs("id");
+		}
+		s->rtnBC = argus_readBCpsV();
+		s->rtnTherm = argus_readThermADCs();
+		for (i = 0; i < NSBG; i++) {
+			s->rtnSbag += sb_readADC(i);
+			sbPar[i].pll = sb_readPLLmon(i);
+		}
+		s->rtnVane = vane_readADC();
+	} else {
+		s->rtnDcm2 = dcm2_readMBadc();
+		s->rtnDcm2 += dcm2_readMBtemp();
+		s->rtnDcm2 += dcm2_readAllModTemps();
+		s->rtnDcm2 += dcm2_readAllModTotPwr();
+	}
+	rtn = s->rtnLNA + s->rtnBC + s->rtnTherm + s->rtnSbag + s->rtnVane + s->rtnDcm2;
+
+	// copy results out of the live structures
+	memcpy(s->pwrCtrl, pwrCtrlPar, sizeof(s->pwrCtrl));
+	memcpy(s->rx, rxPar, sizeof(s->rx));
+	memcpy(s->bc, bcPar, sizeof(s->bc));
+	s->cryo = cryoPar;
+	memcpy(s->sb, sbPar, sizeof(s->sb));
+	s->vane = vanePar;
+	memcpy(s->dcm2MB, dcm2MBpar, sizeof(s->dcm2MB));
+	s->dcm2A = dcm2Apar;
+	s->dcm2B = dcm2Bpar;
+	s->seq = samplerSeq + 1;
+	s->tick = TimeTick;
+	s->sweepTicks = s->tick - t0;
+
+	// publish
+	OSCritEnter(&snapLock, 0);
+	front = 1 - front;
+	samplerSeq = s->seq;
+	OSCritLeave(&snapLock);
+	samplerSweepMs = s->sweepTicks*1000/TICKS_PER_SECOND;
+
+	OSCritLeave(&sampleLock);
+
+	return rtn;
+}
+
+/****************************************************************************************/
+/**
+  \brief Lock and return the published snapshot.
+
+  Sweeps synchronously first when the sampler is stopped or has not yet
+  published.  The snapshot stays valid until argus_unlockSnapshot(); hold it
+  only long enough to copy what a reply needs, never across socket writes,
+  as the sampler cannot publish meanwhile.
+
+  \return Pointer to the published snapshot.
+*/
+const struct argusSnapshot *argus_lockSnapshot(void)
+{
+	if (!samplerPeriod || !samplerSeq) argus_sample();
+	OSCritEnter(&snapLock, 0);
+	return &snap[front];
+}
+
+/**
+  \brief Release the snapshot returned by argus_lockSnapshot().
+*/
+void argus_unlockSnapshot(void)
+{
+	OSCritLeave(&snapLock);
+}
+
+/****************************************************************************************/
+/**
+  \brief Sampler task.
+
+  Sweeps every samplerPeriod ms, measured start to start; idles while
+  samplerPeriod is zero.
+*/
+static void samplerTask(void *pd)
+{
+	DWORD t0, period;
+
+	while (1) {
+		if (samplerPeriod) {
+			t0 = TimeTick;
+			argus_sample();
+			period = (samplerPeriod*TICKS_PER_SECOND + 999)/1000;
+			if (TimeTick - t0 < period) OSTimeDly(period - (TimeTick - t0));
+			else OSTimeDly(1);  // sweep overran the period: keep at least a tick between sweeps
+		} else {
+			OSTimeDly(TICKS_PER_SECOND/4);
+		}
+	}
+}
+
+/****************************************************************************************/
+/**
+  \brief Start the monitor sampler.
+
+  Call after the hardware has been initialized and the I2C bus released.
+  Only the first call does anything: argus_init() runs again on the init
+  command, while the sampler is running and may hold its locks.
+*/
+void argus_startSampler(void)
+{
+	if (started) return;
+	started = 1;
+
+	OSCritInit(&sampleLock);
+	OSCritInit(&snapLock);
+	argus_telemInit();  // before the telemetry and data services start
+
+	if (OSTaskCreate(samplerTask, (void *)0, (void *)&samplerStack[USER_TASK_STK_SIZE],
+			(void *)&samplerStack[0], SAMPLERPRIO) != OS_NO_ERR) {
+		samplerPeriod = 0;  // queries fall back to synchronous sweeps
+		printf("argus_startSampler: task priority %d unavailable\n", SAMPLERPRIO);
+	}
+}
+
+/****************************************************************************************/
+/**
+  \brief Whether argus_startSampler() has run.
+
+  Snapshot and telemetry readers from other modules must check this first:
+  before then the locks are uninitialized, and on other hardware it never runs.
+*/
+int argus_samplerReady(void)
+{
+	return started;
+}
@@ -0,0 +1,403 @@
+/**
+  \file
+  \author Andy Harris
+  \brief  Binary telemetry frames for Argus and DCM2 hardware.
+
+  A frame packs the latest monitor snapshot for machine clients: a fixed
+  telemHeader, then one block per field, each with a telemBlock header,
+  validity bits and scaled integer values.  Values that failed to read (the
+  99, 999 and 9999 sentinels), LNA values while LNA power is off, and values
+  out of range for their type are sent as zero with the validity bit clear.
+
+  The schema id selects the field set: TELEMSCHEMA_LNA for the LNA bias
+  system, TELEMSCHEMA_DCM2 for DCM2.
+
+  argus_telemDelta() adds change detection for clients that poll: a change
+  table holds the last reported value of every point, replaced only when a
+  new value differs by more than the field's deadband, and stamped with the
+  table version.  A client holding version N asks for the points changed
+  since N and gets a delta frame, or a keyframe when N is unknown or the
+  delta would be larger than a keyframe.  A frame is well under TELEMMAXBYTES,
+  takes no float formatting, and is the same whether read with the telem
+  control command, the 'a' request of the data service, or published by
+  the telemetry service.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <ucos.h>
+#include <constants.h>
+
+#include "argus.h"
+
+// deadbands by field id, in raw value units
+unsigned short telemDeadband[TELEM_NFIELD+1] = {
+	0,
+	2,     // TELEM_PWRCTRL [10 mV]
+	2,     // TELEM_LNAV [mV]
+	2,     // TELEM_LNAID [10 uA]
+	0,     // TELEM_LNASETS
+	5,     // TELEM_BIASCARD [mV]
+	5,     // TELEM_CRYOTEMP [10 mK]
+	2,     // TELEM_CRYOAUX [mV]
+	50,    // TELEM_SBADC [0.001]
+	0,     // TELEM_SBFLAGS
+	5,     // TELEM_VANEADC [mV]
+	20,    // TELEM_VANEANGLE [0.01 deg]
+	0,     // TELEM_VANEFLAG
+	2,     // TELEM_DCM2MB [10 mV]
+	0,     // TELEM_DCM2STATUS
+	0,     // TELEM_DCM2ATTEN
+	5,     // TELEM_DCM2POW [0.01 dB]
+	10,    // TELEM_DCM2TEMP [0.01 C]
+};
+
+// One entry of the change table
+struct telemPoint {
+	long raw;             // last reported value
+	unsigned long ver;    // table version when last reported
+	WORD id;              // delta point id
+	BYTE valid;           // 1 when raw is valid
+};
+
+static struct telemPoint points[TELEMMAXPTS];   // change table, guarded by deltaLock
+static int nPoints = 0;
+static BYTE pointsSchema = 0;        // schema of the change table
+static unsigned long tableVer = 0;   // latest table version
+static unsigned long tableBase = 0;  // version of the last table reset
+static OS_CRIT deltaLock;
+static char deltaReady = 0;          // set by argus_telemInit()
+
+// Frame under construction
+struct telemOut {
+	BYTE *p;       // next block
+	BYTE *end;     // end of buffer
+	int nblocks;   // blocks written
+};
+
+/****************************************************************************************/
+/**
+  \brief Round up to a multiple of four bytes.
+*/
+static unsigned pad4(unsigned n)
+{
+	return ((n + 3) & ~3);
+}
+
+/**
+  \brief Start a field block.
+
+  \param  t     Frame under construction.
+  \param  id    TELEM_* field id.
+  \param  type  TELEMTYPE_* value type.
+  \param  exp   Decimal exponent of the values.
+  \param  n     Number of values.
+  \return Pointer to the zeroed validity bits, followed by the values, or 0 if
+          the block doesn't fit.
+*/
+static BYTE *telemStart(struct telemOut *t, BYTE id, BYTE type, signed char exp, int n)
+{
+	struct telemBlock *b = (struct telemBlock *)t->p;
+	unsigned len = sizeof(*b) + pad4((n + 7)/8) + pad4(n*type);
+
+	if (t->p + len > t->end) return 0;
+	b->id = id;
+	b->type = type;
+	b->exp = exp;
+	b->n = n;
+	memset(t->p + sizeof(*b), 0, len - sizeof(*b));
+	t->p += len;
+	t->nblocks += 1;
+	return ((BYTE *)(b + 1));
+}
+
+/**
+  \brief Write a block of float values as scaled integers.
+
+  Values are taken row by row from a table or array of structures.
+
+  \param  t         Frame under construction.
+  \param  id        TELEM_* field id.
+  \param  type      TELEMTYPE_I16 or TELEMTYPE_I32.
+  \param  exp       Decimal exponent, -3 to 0.
+  \param  v         First value.
+  \param  rows      Number of rows.
+  \param  cols      Values per row, contiguous.
+  \param  rowStride Bytes between rows.
+  \param  ok        Zero to mark every value invalid.
+*/
+static void telemFloats(struct telemOut *t, BYTE id, BYTE type, signed char exp,
+		const float *v, int rows, int cols, unsigned rowStride, int ok)
+{
+	static const float scale[] = {1., 10., 100., 1000.};
+	float lim = (type == TELEMTYPE_I16 ? 32767. : 2.e9);
+	BYTE *valid = telemStart(t, id, type, exp, rows*cols);
+	BYTE *val;
+	const float *row;
+	float x;
+	long raw;
+	int r, c, k;
+
+	if (!valid || !ok) return;
+	val = valid + pad4((rows*cols + 7)/8);
+	for (r = 0, k = 0; r < rows; r++) {
+		row = (const float *)((const char *)v + r*rowStride);
+		for (c = 0; c < cols; c++, k++) {
+			x = row[c];
+			if (x != x || x == 99. || x == 999. || x == 9999.) continue;  // NaN or sentinel
+			x *= scale[-exp];
+			if (fabsf(x) > lim) continue;
+			raw = (long)(x < 0 ? x - 0.5 : x + 0.5);
+			if (type == TELEMTYPE_I16) ((short *)val)[k] = raw;
+			else ((long *)val)[k] = raw;
+			valid[k >> 3] |= 0x80 >> (k & 7);
+		}
+	}
+}
+
+/**
+  \brief Write a block of byte values.
+
+  \param  t   Frame under construction.
+  \param  id  TELEM_* field id.
+  \param  v   Values.
+  \param  n   Number of values.
+  \param  ok  Zero to mark every value invalid.
+*/
+static void telemBytes(struct telemOut *t, BYTE id, const BYTE *v, int n, int ok)
+{
+	BYTE *valid = telemStart(t, id, TELEMTYPE_U8, 0, n);
+	int k;
+
+	if (!valid || !ok) return;
+	memcpy(valid + pad4((n + 7)/8), v, n);
+	for (k = 0; k < n; k++) valid[k >> 3] |= 0x80 >> (k & 7);
+}
+
+/****************************************************************************************/
+/**
+  \brief Build a binary telemetry frame from the latest monitor snapshot.
+
+  Multi-byte fields are in native order, which is network byte order on the
+  ColdFire, as for LagData::write().
+
+  \param  buf       Output buffer.
+  \param  maxbytes  Size of buf; TELEMMAXBYTES holds any frame.
+  \return Frame length [bytes], or 0 if buf is too small for the header.
+*/
+int argus_telemFrame(BYTE *buf, unsigned maxbytes)
+{
+	struct telemHeader *h = (struct telemHeader *)buf;
+	struct telemOut t = {buf + sizeof(*h), buf + maxbytes, 0};
+	const struct argusSnapshot *sp;
+	DWORD age;
+	int i, lnaOK;
+
+	if (maxbytes < sizeof(*h)) return 0;
+
+	sp = argus_lockSnapshot();
+	age = (TimeTick - sp->tick)*1000/TICKS_PER_SECOND;
+	h->magic = TELEMMAGIC;
+	h->version = TELEMVERSION;
+	h->schema = (foundLNAbiasSys ? TELEMSCHEMA_LNA : TELEMSCHEMA_DCM2);
+	h->seq = sp->seq;
+	h->ageMs = (age < 0xffff ? age : 0xffff);
+	h->ver = 0;
+	h->flags = (sp->lnaPwrState == 1 ? TELEMFLAG_LNAON : 0);
+	h->errs = (sp->rtnLNA ? 0x01 : 0) | (sp->rtnBC ? 0x02 : 0) | (sp->rtnTherm ? 0x04 : 0)
+			| (sp->rtnSbag ? 0x08 : 0) | (sp->rtnVane ? 0x10 : 0) | (sp->rtnDcm2 ? 0x20 : 0);
+	h->pktSeq = 0;
+
+	if (foundLNAbiasSys) {
+		BYTE sbFlags[NSBG];
+		BYTE vaneFlag = vanePar.vaneFlag;  // live, as for the jvane command
+
+		lnaOK = (sp->lnaPwrState == 1);
+		telemFloats(&t, TELEM_PWRCTRL, TELEMTYPE_I16, -2, sp->pwrCtrl, 1, 9, 0, 1);
+		telemFloats(&t, TELEM_LNAV, TELEMTYPE_I16, -3, &sp->rx[0].LNAmonPts[0], NRX, 4, sizeof(sp->rx[0]), lnaOK);
+		telemFloats(&t, TELEM_LNAID, TELEMTYPE_I16, -2, &sp->rx[0].LNAmonPts[4], NRX, 2, sizeof(sp->rx[0]), lnaOK);
+		telemFloats(&t, TELEM_LNASETS, TELEMTYPE_I16, -3, &sp->rx[0].LNAsets[0], NRX, 4, sizeof(sp->rx[0]), lnaOK);
+		telemFloats(&t, TELEM_BIASCARD, TELEMTYPE_I16, -3, &sp->bc[0].v[0], NBIASC, 8, sizeof(sp->bc[0]), 1);
+		telemFloats(&t, TELEM_CRYOTEMP, TELEMTYPE_I16, -2, sp->cryo.cryoTemps, 1, 6, 0, 1);
+		telemFloats(&t, TELEM_CRYOAUX, TELEMTYPE_I16, -3, sp->cryo.auxInputs, 1, 2, 0, 1);
+		telemFloats(&t, TELEM_SBADC, TELEMTYPE_I32, -3, &sp->sb[0].adcv[0], NSBG, 8, sizeof(sp->sb[0]), 1);
+		for (i = 0; i < NSBG; i++) sbFlags[i] = (sp->sb[i].pll == 1) | (sbPar[i].ampPwr == 1) << 1;
+		telemBytes(&t, TELEM_SBFLAGS, sbFlags, NSBG, !sp->rtnSbag);
+		telemFloats(&t, TELEM_VANEADC, TELEMTYPE_I16, -3, sp->vane.adcv, 1, 8, 0, 1);
+		telemFloats(&t, TELEM_VANEANGLE, TELEMTYPE_I16, -2, &sp->vane.vaneAngleDeg, 1, 1, 0, !sp->rtnVane);
+		telemBytes(&t, TELEM_VANEFLAG, &vaneFlag, 1, 1);
+	} else {
+		// one block per band; attenuations are the live command values, as for the jdcm2 command
+		telemFloats(&t, TELEM_DCM2MB, TELEMTYPE_I16, -2, sp->dcm2MB, 1, 9, 0, 1);
+		telemBytes(&t, TELEM_DCM2STATUS, sp->dcm2A.status, NRX, 1);
+		telemBytes(&t, TELEM_DCM2STATUS, sp->dcm2B.status, NRX, 1);
+		telemBytes(&t, TELEM_DCM2ATTEN, dcm2Apar.attenI, 2*NRX, 1);
+		telemBytes(&t, TELEM_DCM2ATTEN, dcm2Bpar.attenI, 2*NRX, 1);
+		telemFloats(&t, TELEM_DCM2POW, TELEMTYPE_I16, -2, sp->dcm2A.powDetI, 2, NRX, NRX*sizeof(float), 1);
+		telemFloats(&t, TELEM_DCM2POW, TELEMTYPE_I16, -2, sp->dcm2B.powDetI, 2, NRX, NRX*sizeof(float), 1);
+		telemFloats(&t, TELEM_DCM2TEMP, TELEMTYPE_I16, -2, sp->dcm2A.bTemp, 1, NRX, 0, 1);
+		telemFloats(&t, TELEM_DCM2TEMP, TELEMTYPE_I16, -2, sp->dcm2B.bTemp, 1, NRX, 0, 1);
+	}
+	argus_unlockSnapshot();
+
+	h->nblocks = t.nblocks;
+	h->nbytes = t.p - buf;
+	return (h->nbytes);
+}
+
+/****************************************************************************************/
+/**
+  \brief Find the values of a block.
+*/
+static BYTE *blockVals(struct telemBlock *b)
+{
+	return ((BYTE *)(b + 1) + pad4((b->n + 7)/8));
+}
+
+/**
+  \brief Read value i of a block.
+*/
+static long getRaw(struct telemBlock *b, int i)
+{
+	BYTE *val = blockVals(b);
+	if (b->type == TELEMTYPE_U8) return val[i];
+	if (b->type == TELEMTYPE_I16) return ((short *)val)[i];
+	return ((long *)val)[i];
+}
+
+/**
+  \brief Write value i of a block.
+*/
+static void setRaw(struct telemBlock *b, int i, long raw)
+{
+	BYTE *val = blockVals(b);
+	if (b->type == TELEMTYPE_U8) val[i] = raw;
+	else if (b->type == TELEMTYPE_I16) ((short *)val)[i] = raw;
+	else ((long *)val)[i] = raw;
+}
+
+/**
+  \brief Update the change table from a frame.
+
+  Call with deltaLock held.  A value replaces its table entry if its validity
+  changed or it moved by more than its deadband; a new schema resets the
+  table.  The version increments when any entry changes.
+
+  \param  buf  Frame from argus_telemFrame().
+*/
+static void tableUpdate(BYTE *buf)
+{
+	struct telemHeader *h = (struct telemHeader *)buf;
+	struct telemBlock *b = (struct telemBlock *)(h + 1);
+	struct telemPoint *pt;
+	int k, i, j = 0, valid, changed = 0;
+	long raw;
+
+	if (h->schema != pointsSchema) {
+		pointsSchema = h->schema;
+		nPoints = 0;
+		tableBase = tableVer + 1;
+	}
+	for (k = 0; k < h->nblocks; k++) {
+		for (i = 0; i < b->n && j < TELEMMAXPTS; i++, j++) {
+			valid = ((((BYTE *)(b + 1))[i >> 3] & (0x80 >> (i & 7))) != 0);
+			raw = getRaw(b, i);
+			pt = &points[j];
+			if (j >= nPoints || valid != pt->valid
+					|| (valid && labs(raw - pt->raw) > (b->id <= TELEM_NFIELD ? telemDeadband[b->id] : 0))) {
+				pt->raw = raw;
+				pt->valid = valid;
+				pt->ver = tableVer + 1;
+				pt->id = (k << 8) | i;
+				changed = 1;
+			}
+		}
+		b = (struct telemBlock *)(blockVals(b) + pad4(b->n*b->type));
+	}
+	nPoints = j;
+	if (changed) tableVer += 1;
+}
+
+/**
+  \brief Initialize the change table lock.
+
+  Call once at startup, before any task requests delta frames; see
+  argus_startSampler().
+*/
+void argus_telemInit(void)
+{
+	OSCritInit(&deltaLock);
+	deltaReady = 1;
+}
+
+/**
+  \brief Build a delta frame, or a keyframe, from the latest monitor snapshot.
+
+  The delta frame lists every point whose table entry changed after version
+  since.  A keyframe, laid out as for argus_telemFrame() but with the table
+  values, is returned instead when since is 0, predates the last table reset
+  or is newer than the table, or when the delta would not be smaller.  Either
+  carries the table version in its ver field, for the next request.  Before
+  argus_telemInit(), the plain frame of argus_telemFrame() is returned.
+
+  \param  buf       Output buffer, 4-byte aligned.
+  \param  maxbytes  Size of buf; TELEMMAXBYTES holds any frame.
+  \param  since     Table version held by the client, 0 for none.
+  \return Frame length [bytes], or 0 if buf is too small.
+*/
+int argus_telemDelta(BYTE *buf, unsigned maxbytes, unsigned long since)
+{
+	struct telemHeader *h = (struct telemHeader *)buf;
+	struct telemDelta *d = (struct telemDelta *)(h + 1);
+	struct telemDeltaPoint *dp = (struct telemDeltaPoint *)(d + 1);
+	struct telemBlock *b;
+	unsigned nbytes;
+	int j, k, i, n = 0;
+
+	if (!argus_telemFrame(buf, maxbytes)) return 0;
+	if (!deltaReady) return h->nbytes;
+
+	OSCritEnter(&deltaLock, 0);
+	tableUpdate(buf);
+	h->ver = tableVer;
+
+	if (since && since >= tableBase && since <= tableVer) {
+		for (j = 0; j < nPoints; j++) if (points[j].ver > since) n += 1;
+		nbytes = sizeof(*h) + sizeof(*d) + n*sizeof(*dp);
+		if (nbytes < h->nbytes && nbytes <= maxbytes) {
+			d->since = since;
+			d->n = n;
+			d->spare = 0;
+			for (j = 0; j < nPoints; j++) {
+				if (points[j].ver <= since) continue;
+				dp->point = points[j].id;
+				dp->valid = points[j].valid;
+				dp->spare = 0;
+				dp->raw = points[j].raw;
+				dp += 1;
+			}
+			OSCritLeave(&deltaLock);
+			h->flags |= TELEMFLAG_DELTA;
+			h->nblocks = 0;
+			h->nbytes = nbytes;
+			return nbytes;
+		}
+	}
+
+	// keyframe: table values in the frame layout
+	b = (struct telemBlock *)(h + 1);
+	for (k = 0, j = 0; k < h->nblocks; k++) {
+		memset(b + 1, 0, pad4((b->n + 7)/8));
+		for (i = 0; i < b->n && j < nPoints; i++, j++) {
+			setRaw(b, i, (points[j].valid ? points[j].raw : 0));
+			if (points[j].valid) ((BYTE *)(b + 1))[i >> 3] |= 0x80 >> (i & 7);
+		}
+		b = (struct telemBlock *)(blockVals(b) + pad4(b->n*b->type));
+	}
+	OSCritLeave(&deltaLock);
+	h->flags |= TELEMFLAG_KEY;
+	return (h->nbytes);
+}
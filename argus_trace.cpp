@@ -0,0 +1,308 @@
+/**
+  \file
+  \author Andy Harris
+  \brief  I2C transaction tracer for Argus and DCM2 hardware.
+
+  Every I2C transaction made through the I2CSEND and I2CREAD macros is
+  recorded in a fixed RAM ring: start time, duration, device address, byte
+  count, result, first data byte and the bus owner that made it (the caller
+  name passed to i2cBusLock()).  Recording costs two timer reads and a
+  16-byte store; summaries are computed only when asked for.
+
+  Reports work from a copy of the ring taken while holding the I2C bus, so
+  they are consistent and can take their time writing to the network.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ucos.h>
+#include <constants.h>
+
+#include "argus.h"
+#include "io.h"
+#include "zpec.h"
+
+extern BYTE address;   // I2C transaction globals, defined in argus_io.cpp
+extern BYTE buffer[];
+
+unsigned char i2cTraceOn = 1;       // record I2C transactions when = 1
+unsigned long i2cXferCtr = 0;       // I2C transactions since boot, traced or not
+
+// One I2C transaction
+struct i2cTraceRec {
+	unsigned long t;   // zpec_usclock() at start
+	const char *who;   // bus owner, 0 if none
+	WORD us;           // duration [us], saturates at 0xffff
+	BYTE addr;         // device address
+	signed char n;     // bytes sent, or minus bytes read
+	BYTE stat;         // I2C status, 0 when acknowledged
+	BYTE data;         // first buffer byte: register, command or data read
+};
+
+// Summary for one caller or device
+struct i2cTraceSum {
+	const char *who;        // caller, or 0 for a device entry
+	unsigned int n;         // transactions
+	unsigned int bytes;     // payload bytes
+	unsigned int nacks;     // transactions not acknowledged
+	unsigned long busUs;    // total duration [us]
+	unsigned int maxUs;     // longest transaction [us]
+};
+
+static struct i2cTraceRec ring[I2CTRACEN];
+static unsigned long traceSeq = 0;   // transactions recorded since clear
+static unsigned long traceT0;        // start time of the transaction in progress
+
+// report working copy, guarded by reportLock
+static struct i2cTraceRec copy[I2CTRACEN];
+static unsigned long copySeq;
+static int copyN;
+static struct i2cTraceSum total;
+static struct i2cTraceSum callerSum[I2CTRACENSUM];
+static struct i2cTraceSum devSum[128];
+static int worst;                    // index in copy[] of the longest transaction
+static OS_CRIT reportLock;
+
+/****************************************************************************************/
+/**
+  \brief Initialize the I2C tracer.  Call at boot, before the first report;
+  later calls do nothing.
+*/
+void i2cTraceInit(void)
+{
+	static char ready = 0;
+
+	if (ready) return;
+	OSCritInit(&reportLock);
+	ready = 1;
+}
+
+/**
+  \brief Mark the start of an I2C transaction; see I2CTRACED.
+*/
+void i2cTraceStart(void)
+{
+	traceT0 = zpec_usclock();
+}
+
+/**
+  \brief Record the I2C transaction started by i2cTraceStart().
+
+  Uses the global address and buffer of the transaction.
+
+  \param stat   Transaction status.
+  \param nbytes Bytes sent, or minus bytes read.
+  \return stat, so that the call can stand in for the transaction.
+*/
+int i2cTrace(int stat, int nbytes)
+{
+	struct i2cTraceRec *r;
+	unsigned long us;
+
+	i2cXferCtr += 1;
+	if (!i2cTraceOn) return stat;
+
+	us = ZPEC_USCLOCK_US(zpec_usclock() - traceT0);
+	r = &ring[traceSeq & (I2CTRACEN-1)];
+	r->t = traceT0;
+	r->who = i2cBusOwner();
+	r->us = (us < 0xffff ? us : 0xffff);
+	r->addr = address;
+	r->n = nbytes;
+	r->stat = stat;
+	r->data = buffer[0];
+	traceSeq += 1;
+
+	return stat;
+}
+
+/**
+  \brief Discard all recorded I2C transactions.
+*/
+void i2cTraceClear(void)
+{
+	traceSeq = 0;
+}
+
+/****************************************************************************************/
+/**
+  \brief Convert a zpec_usclock() count difference of any size to microseconds.
+*/
+static unsigned long countsToUs(unsigned long counts)
+{
+	return (counts >> 7)*125 + ZPEC_USCLOCK_US(counts & 0x7f);
+}
+
+/**
+  \brief Add one transaction to a summary entry.
+*/
+static void addSum(struct i2cTraceSum *s, const struct i2cTraceRec *r)
+{
+	s->n += 1;
+	s->bytes += (r->n < 0 ? -r->n : r->n);
+	if (r->stat) s->nacks += 1;
+	s->busUs += r->us;
+	if (r->us > s->maxUs) s->maxUs = r->us;
+}
+
+/**
+  \brief Copy the ring and summarize the copy.
+
+  Call with reportLock held.  Fills copy[], total, callerSum[] and devSum[].
+*/
+static void summarize(void)
+{
+	int i, k, locked;
+	struct i2cTraceRec *r;
+
+	// take the bus so that no transaction lands in the ring while copying
+	locked = (i2cBusLock(__FUNCTION__) == 0);
+	copySeq = traceSeq;
+	copyN = (copySeq < I2CTRACEN ? copySeq : I2CTRACEN);
+	for (i = 0; i < copyN; i++) copy[i] = ring[(copySeq - copyN + i) & (I2CTRACEN-1)];
+	if (locked) i2cBusUnlock();
+
+	memset(&total, 0, sizeof(total));
+	memset(callerSum, 0, sizeof(callerSum));
+	memset(devSum, 0, sizeof(devSum));
+	worst = -1;
+	for (i = 0; i < copyN; i++) {
+		r = &copy[i];
+		addSum(&total, r);
+		addSum(&devSum[r->addr & 0x7f], r);
+		if (worst < 0 || r->us > copy[worst].us) worst = i;
+
+		// callers are compared by pointer, as in argus_bus.cpp; the last entry collects the rest
+		if (!r->who) r->who = "(none)";
+		for (k = 0; k < I2CTRACENSUM-1 && callerSum[k].who && callerSum[k].who != r->who; k++);
+		if (!callerSum[k].who) callerSum[k].who = (k < I2CTRACENSUM-1 ? r->who : "(other)");
+		addSum(&callerSum[k], r);
+	}
+}
+
+/**
+  \brief Time spanned by the copied records [s].
+*/
+static float spanSec(void)
+{
+	if (copyN < 2) return 0.;
+	return (countsToUs(copy[copyN-1].t - copy[0].t) + copy[copyN-1].us)/1.e6;
+}
+
+/****************************************************************************************/
+/**
+  \brief Write a text summary of the I2C trace.
+
+  Output beyond maxbytes is flushed to fd, as for zpec_write_if_full().
+
+  \param fd       Open file descriptor for output that does not fit in str.
+  \param str      Output string.
+  \param maxbytes Threshold for flushing str.
+  \return Number of characters left in str.
+*/
+int i2cTraceReport(int fd, char *str, unsigned maxbytes)
+{
+	static const char *fn = "i2cTraceReport";
+	unsigned n;
+	int i;
+	float span;
+
+	OSCritEnter(&reportLock, 0);
+	summarize();
+	span = spanSec();
+
+	n = sprintf(str, "  tracing %s, %lu transactions recorded, last %d over %.3f s:\r\n"
+			"  %u bytes (%.0f bytes/s), %u NACKs, bus busy %.1f%%\r\n",
+			(i2cTraceOn ? "on" : "off"), copySeq, copyN, span,
+			total.bytes, (span > 0. ? total.bytes/span : 0.), total.nacks,
+			(span > 0. ? total.busUs/span/1.e4 : 0.));
+	if (worst >= 0) {
+		n += sprintf(&str[n], "  slowest: %u us, address 0x%02x, %s\r\n",
+				copy[worst].us, copy[worst].addr, copy[worst].who);
+	}
+
+	n += sprintf(&str[n], "  %-26s %6s %7s %5s %9s %6s\r\n", "caller", "xfers", "bytes", "NACKs", "bus [ms]", "max us");
+	for (i = 0; i < I2CTRACENSUM && callerSum[i].who; i++) {
+		zpec_write_if_full(fd, str, &n, maxbytes, fn);
+		n += sprintf(&str[n], "  %-26s %6u %7u %5u %9.1f %6u\r\n", callerSum[i].who, callerSum[i].n,
+				callerSum[i].bytes, callerSum[i].nacks, callerSum[i].busUs/1000., callerSum[i].maxUs);
+	}
+
+	n += sprintf(&str[n], "  %-7s %6s %7s %5s %8s %6s\r\n", "address", "xfers", "bytes", "NACKs", "NACK %", "max us");
+	for (i = 0; i < 128; i++) {
+		if (!devSum[i].n) continue;
+		zpec_write_if_full(fd, str, &n, maxbytes, fn);
+		n += sprintf(&str[n], "  0x%02x    %6u %7u %5u %8.1f %6u\r\n", i, devSum[i].n, devSum[i].bytes,
+				devSum[i].nacks, 100.*devSum[i].nacks/devSum[i].n, devSum[i].maxUs);
+	}
+	OSCritLeave(&reportLock);
+
+	return n;
+}
+
+/**
+  \brief Write the I2C trace summary and records as JSON.
+
+  Record fields are start time relative to the oldest record [us], device
+  address, bytes (negative for reads), status, duration [us], first data
+  byte and caller.  Output beyond maxbytes is flushed to fd.
+
+  \param fd       Open file descriptor for output that does not fit in str.
+  \param str      Output string.
+  \param maxbytes Threshold for flushing str.
+  \param nrec     Number of most recent records to list; 0 for none.
+  \return Number of characters left in str.
+*/
+int i2cTraceJSON(int fd, char *str, unsigned maxbytes, unsigned nrec)
+{
+	static const char *fn = "i2cTraceJSON";
+	struct i2cTraceRec *r;
+	unsigned n;
+	int i, first;
+	float span;
+
+	OSCritEnter(&reportLock, 0);
+	summarize();
+	span = spanSec();
+
+	n = sprintf(str, "{\"trace\": {\"cmdOK\":true, \"on\":%d, \"seq\":%lu, \"n\":%d, \"span\":%.3f, "
+			"\"bytes\":%u, \"bytesPerSec\":%.0f, \"nacks\":%u, \"busPct\":%.1f, ",
+			i2cTraceOn, copySeq, copyN, span, total.bytes, (span > 0. ? total.bytes/span : 0.),
+			total.nacks, (span > 0. ? total.busUs/span/1.e4 : 0.));
+	if (worst >= 0) {
+		n += sprintf(&str[n], "\"maxUs\":%u, \"maxAddr\":%u, \"maxWho\":\"%s\", ",
+				copy[worst].us, copy[worst].addr, copy[worst].who);
+	}
+
+	n += sprintf(&str[n], "\"callers\":[");
+	for (i = 0; i < I2CTRACENSUM && callerSum[i].who; i++) {
+		zpec_write_if_full(fd, str, &n, maxbytes, fn);
+		n += sprintf(&str[n], "%s{\"who\":\"%s\", \"n\":%u, \"bytes\":%u, \"nacks\":%u, \"busUs\":%lu, \"maxUs\":%u}",
+				(i ? ", " : ""), callerSum[i].who, callerSum[i].n, callerSum[i].bytes,
+				callerSum[i].nacks, callerSum[i].busUs, callerSum[i].maxUs);
+	}
+
+	n += sprintf(&str[n], "], \"devices\":[");
+	for (i = 0, first = 1; i < 128; i++) {
+		if (!devSum[i].n) continue;
+		zpec_write_if_full(fd, str, &n, maxbytes, fn);
+		n += sprintf(&str[n], "%s{\"addr\":%d, \"n\":%u, \"bytes\":%u, \"nacks\":%u, \"nackRate\":%.3f, \"maxUs\":%u}",
+				(first ? "" : ", "), i, devSum[i].n, devSum[i].bytes, devSum[i].nacks,
+				(float)devSum[i].nacks/devSum[i].n, devSum[i].maxUs);
+		first = 0;
+	}
+
+	n += sprintf(&str[n], "], \"recs\":[");
+	if (nrec > (unsigned)copyN) nrec = copyN;
+	for (i = copyN - nrec; i < copyN; i++) {
+		r = &copy[i];
+		zpec_write_if_full(fd, str, &n, maxbytes, fn);
+		n += sprintf(&str[n], "%s[%lu, %u, %d, %u, %u, %u, \"%s\"]", (i > copyN - (int)nrec ? ", " : ""),
+				countsToUs(r->t - copy[0].t), r->addr, r->n, r->stat, r->us, r->data, r->who);
+	}
+	n += sprintf(&str[n], "]}}\r\n");
+	OSCritLeave(&reportLock);
+
+	return n;
+}
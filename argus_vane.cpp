@@ -0,0 +1,341 @@
+/**
+  \file
+  \author Andy Harris
+  \brief  Vane motion task for Argus hardware.
+
+  vane_obscal() starts a move and returns at once.  A task drives the vane
+  relays, samples vane angle and motor current every VANESAMPLEMS into a
+  trajectory buffer, and stops the motor on arrival, stall or timeout,
+  setting vanePar.vaneFlag as before.  The I2C bus is held only for each
+  sample, so monitoring of the receivers carries on while the vane moves.
+
+  Motor current statistics for the latest move go to calSysPar.  A new
+  command stops a move in progress before starting its own.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <ucos.h>
+#include <constants.h>
+
+#include "argus.h"
+#include "zpec.h"
+
+struct calSysParams calSysPar = {{0}, 0., 0., 0., 0., 0., (char *)"idle"};
+unsigned char vaneMoving = 0;        // vane move in progress when = 1
+
+static struct vaneTrajPoint traj[VANETRAJN];   // latest move, guarded by trajLock
+static int trajN = 0;
+static char trajTarget[4] = "";
+static volatile unsigned int vaneReq = 0;  // move requests, one per vane_obscal(); set under trajLock
+static unsigned int vaneDone = 0;    // latest request handled by the task
+static char reqTarget[4];            // target of the latest request, guarded by trajLock
+static OS_SEM vaneSem;               // posted on each request
+static OS_CRIT trajLock;
+static char lockReady = 0;           // set once trajLock is initialized
+static char vaneReady = 0;           // set once the vane task is running
+static DWORD vaneStack[USER_TASK_STK_SIZE] __attribute__( ( aligned( 4 ) ) );
+
+/****************************************************************************************/
+/**
+  \brief Convert ms to ticks, rounding up.
+*/
+static DWORD msTicks(unsigned int ms)
+{
+	return ((ms*TICKS_PER_SECOND + 999)/1000);
+}
+
+/**
+  \brief Initialize the trajectory lock on first use.
+*/
+static void trajLockInit(void)
+{
+	if (!lockReady) {
+		OSCritInit(&trajLock);
+		lockReady = 1;
+	}
+}
+
+/**
+  \brief Set the vane relays, holding the I2C bus for this write only.
+
+  \param  inp  relay state, as for vane_relayCtrl().
+  \return Zero on success, else NB I2C error code or I2CBUSERRVAL.
+*/
+static int vaneRelay(char *inp)
+{
+	int I2CStatus = openI2Cssbus(SB_SBADDR, I2CSSB_I2CADDR, SB_SSBADDR, VANE_SWADDR);
+	if (I2CStatus) return (I2CStatus);
+	I2CStatus = vane_relayCtrl(inp);
+	closeI2Cssbus(SB_SBADDR, SB_SSBADDR);
+	return (I2CStatus);
+}
+
+/**
+  \brief Wait, returning early if a newer move has been requested.
+
+  \return 1 if superseded, else 0.
+*/
+static int vaneWait(DWORD ticks, unsigned int req)
+{
+	DWORD t0 = TimeTick;
+
+	while (TimeTick - t0 < ticks) {
+		if (vaneReq != req) return 1;
+		OSTimeDly(1);
+	}
+	return (vaneReq != req);
+}
+
+/**
+  \brief Run one vane move.
+
+  \param  req     request number, to notice a newer request.
+  \param  target  "obs" or "0", "cal" or "1"; anything else only stops the motor.
+*/
+static void vaneMove(unsigned int req, const char *target)
+{
+	int obs = (!strcasecmp(target, "obs") || !strcmp(target, "0"));
+	int cal = (!strcasecmp(target, "cal") || !strcmp(target, "1"));
+	float tol = (obs ? VANEOBSERRANGLE : VANECALERRANGLE);
+	float aim = (obs ? VANESWINGANGLE : 0.);
+	float sum = 0., sumsq = 0., v;
+	DWORD t0, tArrive = 0;
+	WORD ms;
+	int k, n = 0;
+
+	// ensure delay with motor stopped before further motion
+	vaneRelay("man");
+	calSysPar.state = (char *)"stopping";
+	if (vaneWait(msTicks(VANESTOPMS), req) || (!obs && !cal)) return;
+
+	OSCritEnter(&trajLock, 0);
+	trajN = 0;
+	strcpy(trajTarget, (obs ? "obs" : "cal"));
+	OSCritLeave(&trajLock);
+	calSysPar.meanCurr = calSysPar.maxCurr = calSysPar.varCurr = 0.;
+	calSysPar.minAngle = 1.e9;
+	calSysPar.maxAngle = -1.e9;
+
+	if (vaneRelay(obs ? (char *)"obs" : (char *)"cal")) {
+		vanePar.vaneFlag = 4;  // I2C bus error; actual position unknown
+		return;
+	}
+	calSysPar.state = (char *)"moving";
+	t0 = TimeTick;
+
+	while (vaneReq == req) {
+		// sample angle and motor current
+		if (!openI2Cssbus(SB_SBADDR, I2CSSB_I2CADDR, SB_SSBADDR, VANE_SWADDR)) {
+			vane_angle();
+			vane_current();
+			closeI2Cssbus(SB_SBADDR, SB_SSBADDR);
+
+			ms = (WORD)((TimeTick - t0)*1000/TICKS_PER_SECOND);
+			OSCritEnter(&trajLock, 0);
+			if (trajN < VANETRAJN) {
+				traj[trajN].ms = ms;
+				traj[trajN].angle = vanePar.vaneAngleDeg;
+				traj[trajN].curr = vanePar.adcv[VANECURRCHAN];
+				trajN += 1;
+			}
+			OSCritLeave(&trajLock);
+
+			v = vanePar.adcv[VANECURRCHAN];
+			n += 1;
+			sum += v;
+			sumsq += v*v;
+			calSysPar.meanCurr = sum/n;
+			calSysPar.varCurr = sumsq/n - calSysPar.meanCurr*calSysPar.meanCurr;
+			if (n == 1 || v > calSysPar.maxCurr) calSysPar.maxCurr = v;
+			v = vanePar.adcv[4];  // angle channel [V]
+			if (v < calSysPar.minAngle) calSysPar.minAngle = v;
+			if (v > calSysPar.maxAngle) calSysPar.maxAngle = v;
+
+			// check vane position, with a settling delay before the final check
+			if (tArrive) {
+				if (TimeTick - tArrive >= msTicks(VANESETTLEMS)) {
+					if (fabsf(vanePar.vaneAngleDeg - aim) < tol) vanePar.vaneFlag = (obs ? 0 : 1);
+					else vanePar.vaneFlag = (obs ? 6 : 7);  // near obs or cal
+					break;
+				}
+			} else if (fabsf(vanePar.vaneAngleDeg - aim) < tol) {
+				tArrive = TimeTick;
+			} else {
+				// stall: less than STALLERRANG since the sample VANESTALLTIME ago
+				OSCritEnter(&trajLock, 0);
+				for (k = trajN - 1; k >= 0 && ms - traj[k].ms < (WORD)(VANESTALLTIME*1000); k--);
+				v = (k >= 0 ? traj[k].angle : -1000.);
+				OSCritLeave(&trajLock);
+				if (fabsf(vanePar.vaneAngleDeg - v) <= STALLERRANG) {
+					vanePar.vaneFlag = 2;
+					break;
+				}
+			}
+		}
+		if (!tArrive && TimeTick - t0 >= msTicks((unsigned int)(VANETIMEOUT*1000))) {
+			vanePar.vaneFlag = 3;  // timeout; unknown position
+			break;
+		}
+		OSTimeDly(msTicks(VANESAMPLEMS));
+	}
+}
+
+/****************************************************************************************/
+/**
+  \brief Vane task.  Runs the latest requested move, then stops the motor.
+*/
+static void vaneTask(void *pd)
+{
+	unsigned int req;
+	char target[4];
+	int k;
+
+	while (1) {
+		if (vaneDone == vaneReq) {
+			OSSemPend(&vaneSem, 0);
+			continue;
+		}
+		OSCritEnter(&trajLock, 0);
+		req = vaneReq;
+		strcpy(target, reqTarget);
+		OSCritLeave(&trajLock);
+		vaneMove(req, target);
+		for (k = 0; k < 3 && vaneRelay("man"); k++);  // turn off motor
+		vaneDone = req;
+		if (vaneReq == req) {
+			vaneMoving = 0;
+			calSysPar.state = (char *)"stopped";
+		}
+	}
+}
+
+/**
+  \brief Start the vane task.
+
+  Call after init_vane().  Until then, and if the task can't be created,
+  moves run in the calling task.  Only the first call does anything, since
+  the task may be waiting on vaneSem when the init command re-runs
+  argus_init().
+*/
+void vane_startTask(void)
+{
+	static char started = 0;
+
+	if (started) return;
+	started = 1;
+
+	OSSemInit(&vaneSem, 0);
+	trajLockInit();
+
+	if (OSTaskCreate(vaneTask, (void *)0, (void *)&vaneStack[USER_TASK_STK_SIZE],
+			(void *)&vaneStack[0], VANEPRIO) == OS_NO_ERR) {
+		vaneReady = 1;
+	} else {
+		printf("vane_startTask: task priority %d unavailable\n", VANEPRIO);
+	}
+}
+
+/****************************************************************************************/
+/**
+  \brief Move vane in or out.
+
+  This function starts a move of the vane into or out of the beam (obs and
+  cal positions) and returns.  vanePar.vaneFlag reads MOVING (5) until the
+  move ends, then gives the final position or the reason for stopping.
+
+  \par inp  string: "obs" or "0" for vane out of beam, "cal" or "1" for vane
+            in beam, else stop the motor.
+
+  \return Zero when started.
+*/
+int vane_obscal(char *inp)
+{
+	unsigned int req;
+	char target[4];
+
+	if (!foundLNAbiasSys) return WRONGBOX;
+
+	if (freezeSys) {freezeErrCtr += 1; return FREEZEERRVAL;}                    // check for freeze
+
+	strncpy(target, inp, sizeof(target)-1);
+	target[sizeof(target)-1] = 0;
+	if (!strcasecmp(inp, "obs") || !strcmp(inp, "0") || !strcasecmp(inp, "cal") || !strcmp(inp, "1")) {
+		vanePar.vaneFlag = 5;
+	}
+	vaneMoving = 1;
+
+	// target and request number change together, for the task and other callers
+	trajLockInit();
+	OSCritEnter(&trajLock, 0);
+	strcpy(reqTarget, target);
+	req = ++vaneReq;
+	OSCritLeave(&trajLock);
+
+	if (vaneReady) {
+		OSSemPost(&vaneSem);
+	} else {
+		vaneMove(req, target);
+		vaneRelay("man");  // turn off motor
+		vaneMoving = 0;
+		calSysPar.state = (char *)"stopped";
+	}
+	return 0;
+}
+
+/****************************************************************************************/
+/**
+  \brief Write the latest vane trajectory as JSON.
+
+  Output beyond maxbytes is flushed to fd, as for zpec_write_if_full().  The
+  trajectory is copied under the lock into a buffer of the caller's own
+  (VANETRAJN points, 1.5 KB of stack), so that the vane task is not held up
+  while the output streams.
+
+  \param fd       Open file descriptor for output that does not fit in str.
+  \param str      Output string.
+  \param maxbytes Threshold for flushing str.
+  \return Number of characters left in str.
+*/
+int vane_trajJSON(int fd, char *str, unsigned maxbytes)
+{
+	static const char *fn = "vane_trajJSON";
+	struct vaneTrajPoint copy[VANETRAJN];
+	int i, n;
+	unsigned nb;
+	char target[4];
+
+	if (!foundLNAbiasSys) return (sprintf(str, "{\"vaneTraj\": {\"cmdOK\":false}}\r\n"));
+
+	trajLockInit();
+	OSCritEnter(&trajLock, 0);
+	n = trajN;
+	memcpy(copy, traj, n*sizeof(copy[0]));
+	strcpy(target, trajTarget);
+	OSCritLeave(&trajLock);
+
+	nb = sprintf(str, "{\"vaneTraj\": {\"cmdOK\":true, \"moving\":%d, \"position\":[%d.0], \"target\":\"%s\", "
+			"\"state\":\"%s\", \"n\":%d, \"meanCurr\":%.3f, \"maxCurr\":%.3f, \"varCurr\":%.4f, "
+			"\"minAngleV\":%.3f, \"maxAngleV\":%.3f, \"ms\":[",
+			vaneMoving, vanePar.vaneFlag, target, calSysPar.state, n, calSysPar.meanCurr,
+			calSysPar.maxCurr, calSysPar.varCurr, (n ? calSysPar.minAngle : 0.), (n ? calSysPar.maxAngle : 0.));
+	for (i = 0; i < n; i++) {
+		zpec_write_if_full(fd, str, &nb, maxbytes, fn);
+		nb += sprintf(&str[nb], "%s%u", (i ? "," : ""), copy[i].ms);
+	}
+	nb += sprintf(&str[nb], "], \"angle\":[");
+	for (i = 0; i < n; i++) {
+		zpec_write_if_full(fd, str, &nb, maxbytes, fn);
+		nb += sprintf(&str[nb], "%s%.1f", (i ? "," : ""), copy[i].angle);
+	}
+	nb += sprintf(&str[nb], "], \"curr\":[");
+	for (i = 0; i < n; i++) {
+		zpec_write_if_full(fd, str, &nb, maxbytes, fn);
+		nb += sprintf(&str[nb], "%s%.3f", (i ? "," : ""), copy[i].curr);
+	}
+	nb += sprintf(&str[nb], "]}}\r\n");
+
+	return nb;
+}
@@ -35,15 +35,22 @@ void Correlator::boot(Correlator::shell_type *shell, global_io_t *io)
   // Low-level initialization.
   io_ = io;
   initHardware();
+  if (hw_ == ZPEC_HW_GBT || hw_ == ZPEC_HW_RLT) { startAcquisition(); }
 
   // Start internet services.
+  // Data and monitor requests are short and their replies are queued, so one
+  // task serves all their clients; control commands may wait on client input,
+  // so keep a task each.
   zpec_info("Starting services..");
+  dataServer.setMultiplexed(true);
+  monitorServer.setMultiplexed(true);
   messageServer.start();
   dataServer.start();
   monitorServer.start();
+  if (hw_ == ZPEC_HW_ARG) { telemetryServer.start(); }
 
-  // Initialize help facility.
-  createHelpSummary(shell);
+  // Attach the command interpreter (help summary is created on demand).
+  shell_ = shell;
 
   // We are the control task; execute the control service directly.
   controlServer.startSameTask();  // Does not return.
@@ -89,9 +96,9 @@ void Correlator::initHardware()
     }
   }
 
-  // Create ADC ISR input buffers.
-  adcBuffer_.reserve(2*nBands()*nLags());
-  adcBuffer_.resize(2*nBands()*nLags());
+  // Create ADC ISR input buffers (frame ring of the maximum depth).
+  adcBuffer_.reserve(ZPEC_ADC_RING_MAX*nBands()*nLags());
+  adcBuffer_.resize(ZPEC_ADC_RING_MAX*nBands()*nLags());
 
   // Initialize peripheral mutex.
   OSCritInit(&io_->periph_lock);
@@ -99,9 +106,15 @@ void Correlator::initHardware()
   // Initialize ADC ISR and readout task semaphores.
   OSSemInit(&io_->AdcIsrSem, 0);
 
+  // Record ADC framing history when built in (see the mode command).
+  io_->adc_history = ZPEC_ADC_HISTORY;
+
   // Initialize watchdog task.
   zpec_setup_watchdog();
 
+  // Start microsecond clock (I2C trace and timing statistics).
+  zpec_setup_usclock();
+
   // Set monitor point channels.
   switch (hw_) {
     case ZPEC_HW_GBT:
@@ -140,6 +153,10 @@ void Correlator::initHardware()
       break;
 
     case ZPEC_HW_ARG:
+      // Bus arbiter, tracer and batch first; argus_init() is re-run by "init".
+      i2cBusInit();
+      i2cTraceInit();
+      argus_batchInit();
       argus_init(&flashData);
       break;
 
@@ -216,7 +216,9 @@ bool Correlator::isAccumulating() const
 }
 
 /**
-  Set state of data accumulating flag.
+  Set state of data accumulating flag. The command that sets it owns the ADC
+  readout until it clears it; taking ownership clears any earlier halt
+  request (cf. execHalt()).
 
   \param state New data accumulation state.
   \return Previous data accumulation state.
@@ -227,6 +229,7 @@ bool Correlator::setAccumulating(bool state)
   lock();
     rtn = accumulating_;
     accumulating_ = state;
+    if (state && !rtn) { acqJob_.interrupted = false; }
   unlock();
   return rtn;
 }
@@ -304,24 +307,35 @@ void Correlator::execBoss(return_type status, argument_type arg)
 void Correlator::execMode(return_type status, argument_type arg)
 {
   static const char *usage =
-  "[MODE]\r\n"
+  "[MODE [HISTORY]]\r\n"
   "  Get or set operating ('evaluation') mode (0-5).\r\n"
-  "  MODE  Operating mode (0: Normal, 1: Test Pattern, 2: DevKit,\r\n"
-  "                        3: + phase, 4: - phase; 5: Extreme Pattern\r\n"
-  "                        default: 0).\r\n";
+  "  MODE     Operating mode (0: Normal, 1: Test Pattern, 2: DevKit,\r\n"
+  "                           3: + phase, 4: - phase; 5: Extreme Pattern\r\n"
+  "                           default: 0).\r\n"
+  "  HISTORY  Record ISR framing history for integration status (0 or 1;\r\n"
+  "           default: unchanged). Applies from the next integration.\r\n";
 
   if (!arg.help) {
+    unsigned len = 0;
     if (arg.str) {
+      int history;
+      if (sscanf(arg.str, "%*d%d", &history) == 1) {
+	io_->adc_history = (ZPEC_ADC_HISTORY && history);
+      }
       zpec_mode_t m0 = setMode(static_cast<zpec_mode_t>(atoi(arg.str)));
       zpec_mode_t m1 = getMode();
-      siprintf(status, "%sNew operating mode is %d: %s (was %d: %s).\r\n",
-		       statusOK, static_cast<int>(m1), zpec_mode_name(m1),
-				 static_cast<int>(m0), zpec_mode_name(m0));
+      len += siprintf(status+len,
+		      "%sNew operating mode is %d: %s (was %d: %s).\r\n",
+		      statusOK, static_cast<int>(m1), zpec_mode_name(m1),
+				static_cast<int>(m0), zpec_mode_name(m0));
     } else {
       zpec_mode_t m = getMode();
-      siprintf(status, "%sCurrent operating mode is %d: %s.\r\n",
-		       statusOK, static_cast<int>(m), zpec_mode_name(m));
+      len += siprintf(status+len, "%sCurrent operating mode is %d: %s.\r\n",
+		      statusOK, static_cast<int>(m), zpec_mode_name(m));
     }
+    siprintf(status+len, "  Framing history: %s%s.\r\n",
+	     io_->adc_history ? "on" : "off",
+	     ZPEC_ADC_HISTORY ? "" : " (not built)");
   } else {
     longHelp(status, usage, &Correlator::execMode);
   }
@@ -477,7 +491,15 @@ void Correlator::execHalt(return_type status, argument_type arg)
   "  Halt accumulation of correlator ADC data.\r\n";
 
   if (!arg.help) {
-    if (setAccumulating(false)) {
+    // The integrating command keeps the accumulating flag until its
+    // integration has stopped; it only sees the request.
+    bool halted;
+    lock();
+      halted = accumulating_;
+      if (halted) { acqJob_.interrupted = true; }
+    unlock();
+
+    if (halted) {
       siprintf(status, "%sIntegration halted.\r\n", statusOK);
     } else {
       siprintf(status, "%sNo integration in progress.\r\n", statusWARN);
@@ -488,6 +510,41 @@ void Correlator::execHalt(return_type status, argument_type arg)
 }
 
 
+/**
+  \brief Gets or sets the ADC frame ring depth.
+
+  \param status Storage buffer for return status (should contain at least
+                ControlService::maxLine characters).
+  \param arg    Argument list: [DEPTH]
+*/
+void Correlator::execRing(return_type status, argument_type arg)
+{
+  static const char *usage =
+  "[DEPTH]\r\n"
+  "  Get or set the number of ADC frame buffers between the readout interrupt\r\n"
+  "  and the accumulator. Up to DEPTH-1 frames may wait for processing;\r\n"
+  "  frames arriving with the ring full are dropped and counted as overruns.\r\n"
+  "  DEPTH  Ring depth (2-8; default: display current).\r\n";
+
+  unsigned depth;
+
+  if (arg.help) {
+    longHelp(status, usage, &Correlator::execRing);
+  } else if (arg.str && (1 != sscanf(arg.str, "%u", &depth) ||
+			 depth < 2 || depth > ZPEC_ADC_RING_MAX)) {
+    longHelp(status, usage, &Correlator::execRing);
+    status[0] = *statusERR;
+  } else if (arg.str && isAccumulating()) {
+    siprintf(status, "%sIntegration in progress.\r\n", statusERR);
+  } else {
+    if (arg.str) { adcRing_ = depth; }
+    siprintf(status, "%sFrame ring depth is %u (high-water %u, %u overruns "
+	     "in last integration).\r\n", statusOK, adcRing_, io_->adc_hiwater,
+	     io_->adc_overrun);
+  }
+}
+
+
 /**
   \brief Initializes correlator ADCs.
 
@@ -923,11 +980,19 @@ void Correlator::execStatus(return_type status, argument_type arg)
       case ZPEC_HW_RLT:
       {
 	zpec_mode_t mode = getMode();
+	char progress[80] = "";
+	if (isAccumulating()) {
+	  siprintf(progress, "  Integration progress:  %u of %u frames, "
+		   "integration %u of %u\r\n", acqJob_.nAccum, acqJob_.nFrames,
+		   acqJob_.iRepeat+1, acqJob_.nRepeat);
+	}
 	len += siprintf(status+len,
 		 "  ADC hardware:          %u bands, %lu lags each\r\n"
 		 "  ADC initialization:    %d ADCs failed\r\n"
 		 "  Attenuator setting:    %hu\r\n"
 		 "  Integration status:    %s (err_first=%u, err_frame=%u)\r\n"
+		 "%s"
+		 "  Frame ring:            %u slots, high-water %u, %u overruns\r\n"
 		 "  Jumper settings:       S1:%s S2:%s S4:%s\r\n"
 		 "  Master/slave setting:  %s\r\n"
 		 "  Operating mode:        %d: %s\r\n"
@@ -936,13 +1001,15 @@ void Correlator::execStatus(return_type status, argument_type arg)
 		 error_.initADC,
 		 band_[0].control.getAttenuation(),
 		 isAccumulating() ? "collecting data" : "idle",
-		 io_->err_first, io_->err_frame,
+		 io_->err_first, io_->err_frame, progress,
+		 adcRing_, io_->adc_hiwater, io_->adc_overrun,
 		 cpld_get_bit(CPLD_JUMPER0) ? "open" : "closed",
 		   cpld_get_bit(CPLD_JUMPER1) ? "open" : "closed",
 		   cpld_get_bit(CPLD_JUMPER2) ? "open" : "closed",
 		 isMaster() ? "master" : "slave",
 		 static_cast<int>(mode), zpec_mode_name(mode)
 	       );
+	len += setTimingStatus(status+len);
       }
 	break;
       case ZPEC_HW_POW:
@@ -1063,6 +1130,63 @@ void Correlator::execjUpTime(return_type status, argument_type arg)
 }
 
 
+/**
+  \brief Returns ADC readout timing histograms, JSON format.
+
+  \param status Storage buffer for return status (should contain at least
+                ControlService::maxLine characters).
+  \param arg    Argument list (unused).
+*/
+void Correlator::execjTiming(return_type status, argument_type arg)
+{
+  static const char *usage =
+  "\r\n"
+  "  ADC readout timing of the current or latest integration, JSON format:\r\n"
+  "  bin upper edges [us], then for the ISR entry period, ISR duration and\r\n"
+  "  frame processing time, samples per bin and [samples, min, 50%, 99%,\r\n"
+  "  max us].\r\n";
+
+  if (!arg.help) {
+    static const char *name[] = { "isrPeriod", "isrBusy", "frameProc" };
+    const zpec_hist_t *hist[] = {
+      &io_->adc_isr_period, &io_->adc_isr_busy, &io_->adc_proc
+    };
+    char member[20];
+    zpec_json_t js;
+
+    zpec_json_open(&js, arg.fdWrite, status, ControlService::maxLine - 200,
+		   "timing", "execjTiming");
+    zpec_json_member(&js, "\"cmdOK\":true");
+    zpec_json_array(&js, "binUs");
+    for (unsigned k=0; k<ZPEC_HIST_BINS; k++) {
+      zpec_json_value(&js, "%.0f", ZPEC_USCLOCK_US(1UL << k));
+    }
+    zpec_json_end_array(&js);
+
+    for (unsigned i=0; i<sizeof(hist)/sizeof(hist[0]); i++) {
+      const zpec_hist_t *h = hist[i];
+      zpec_json_array(&js, name[i]);
+      for (unsigned k=0; k<ZPEC_HIST_BINS; k++) {
+	zpec_json_value(&js, "%.0f", h->bin[k]);
+      }
+      zpec_json_end_array(&js);
+
+      siprintf(member, "%sStats", name[i]);
+      zpec_json_array(&js, member);
+      zpec_json_value(&js, "%.0f", h->n);
+      zpec_json_value(&js, "%.0f", ZPEC_USCLOCK_US(h->n ? h->min : 0));
+      zpec_json_value(&js, "%.0f", ZPEC_USCLOCK_US(zpec_hist_quantile(h, 50)));
+      zpec_json_value(&js, "%.0f", ZPEC_USCLOCK_US(zpec_hist_quantile(h, 99)));
+      zpec_json_value(&js, "%.0f", ZPEC_USCLOCK_US(h->max));
+      zpec_json_end_array(&js);
+    }
+    zpec_json_close(&js, "\r\n");
+  } else {
+    longHelp(status, usage, &Correlator::execjTiming);
+  }
+}
+
+
 /**
   \brief Returns version string.
 
@@ -1106,40 +1230,43 @@ void Correlator::execHelp(return_type status, argument_type arg)
   "  COMMAND  Command name (case-insensitive) for extended help display.\r\n";
 
   if (!arg.help) {
+    Correlator::shell_type::const_iterator iCmd = 0;
+
+    if (!shell_) {
+      zpec_warn_fn("help summary not initialized.");
+      siprintf(status, "%sSorry, help has not been initialized.\r\n",
+	       statusERR);
+      return;
+    }
+
     if (arg.str) {
-      if (shell_) {
-	char key[32], *p;
-
-	// Remove trailing whitespace from argument.
-	for (p = arg.str; *p !='\0' && !isspace(*p); ++p) { ; }
-	*p = '\0';
-
-	strncpy(key, arg.str, sizeof(key)-1);
-	key[sizeof(key)-1] = '\0';
-
-	// Key is a case-insensitive command name, convert to lower case.
-	for (char *p = key; *p != '\0'; ++p) { *p = tolower(*p); }
-
-	Correlator::shell_type::const_iterator iCmd = shell_->find(key);
-	if (iCmd != shell_->end() &&
-	    (iCmd->second != &Correlator::execHelp || *arg.str != '\0')) {
-	  // Return detailed help on the command.
-	  (this->*(iCmd->second))(status, 0);
-	} else {
-	  // Command unknown: return summary list.
-	  zpec_write_strcpy(arg.fdWrite, status, helpSummary_.c_str(),
-	                    ControlService::maxLine, fn);
-	}
-      } else {
-	zpec_warn_fn("help summary not initialized.");
-	siprintf(status, "%sSorry, help has not been initialized.\r\n",
-	         statusERR);
+      char key[32], *p;
+
+      // Remove trailing whitespace from argument.
+      for (p = arg.str; *p !='\0' && !isspace(*p); ++p) { ; }
+      *p = '\0';
+
+      strncpy(key, arg.str, sizeof(key)-1);
+      key[sizeof(key)-1] = '\0';
+
+      // Key is a case-insensitive command name, convert to lower case.
+      for (char *p = key; *p != '\0'; ++p) { *p = tolower(*p); }
+
+      iCmd = shell_->find(key);
+      if (iCmd != shell_->end() &&
+	  (iCmd->member != &Correlator::execHelp || *arg.str != '\0')) {
+	// Return detailed help on the command.
+	(this->*(iCmd->member))(status, 0);
+	return;
       }
-    } else {
-      // No argument supplied: return summary list.
-      zpec_write_strcpy(arg.fdWrite, status, helpSummary_.c_str(),
-			ControlService::maxLine, fn);
     }
+
+    // No argument supplied, or command unknown: return summary list.
+    lock();
+      if (helpSummary_.empty()) { createHelpSummary(); }
+    unlock();
+    zpec_write_strcpy(arg.fdWrite, status, helpSummary_.c_str(),
+		      ControlService::maxLine, fn);
   } else {
     longHelp(status, usage, &Correlator::execHelp);
   }
@@ -1184,6 +1311,36 @@ void Correlator::execVerbose(return_type status, argument_type arg)
 }
 
 
+/**
+  \brief Lists the printable aliases of a command.
+
+  \param str    Output string, "{UNKNOWN}" if there are none.
+  \param member Shell-executable member function.
+  \return Number of characters written.
+*/
+unsigned Correlator::listAliases(char *str,
+  void (Correlator::*member)(return_type, argument_type)) const
+{
+  unsigned n = 0;
+
+  str[0] = '\0';
+  if (shell_) {
+    for (shell_type::const_iterator iCmd = shell_->begin();
+	 iCmd != shell_->end(); ++iCmd) {
+      const char *p;
+      for (p = iCmd->key; isgraph(*p); ++p) ;
+
+      if (iCmd->member == member && *iCmd->key != '\0' && *p == '\0') {
+	n += siprintf(str+n, "%s%s", (n ? ", " : ""), iCmd->key);
+      }
+    }
+  }
+  if (n == 0) { n = siprintf(str, "{UNKNOWN}"); }
+
+  return n;
+}
+
+
 /**
   \brief Generates extended help string for an executable command.
 
@@ -1197,14 +1354,10 @@ void Correlator::execVerbose(return_type status, argument_type arg)
 void Correlator::longHelp(return_type status, const char *help,
   void (Correlator::*member)(return_type, argument_type)) const
 {
-  alias_container_type::const_iterator iAlias;
+  unsigned n = siprintf(status, "%s", statusOK);
 
-  for (iAlias = aliasMap_.begin();
-       iAlias != aliasMap_.end() && iAlias->second != member; ++iAlias) ;
-
-  strcat(strcat(strcat(strcpy(status, statusOK),
-                iAlias != aliasMap_.end() ? iAlias->first.c_str()
-		                          : "{UNKNOWN}"), " "), help);
+  n += listAliases(status+n, member);
+  strcat(strcat(status+n, " "), help);
 }
 
 
@@ -1215,70 +1368,44 @@ void Correlator::longHelp(return_type status, const char *help,
   the CorrelatorShell command dictionary, extracts the first line (which
   should summarize the arguments it accepts), and, for commands with multiple
   aliases, combines synonymous entries into a single listing (one per line).
-  The format of the help string
   The format of the final output is:
   \verbatim
   alias1, alias2, ... aliasN ARGUMENTS
   \endverbatim
 
-  This method must be called after the command dictionary (CorrelatorShell)
-  has been initialized, and any time its contents are modified thereafter,
-  for the summary command usage information returned by execHelp() to be
-  accurate.
-
-  \warning This method is not thread-safe.
+  Commands are listed in the order of their first alias. This method is
+  called by execHelp() the first time the summary is needed; the caller must
+  hold the correlator lock.
 */
-void Correlator::createHelpSummary(Correlator::shell_type *shell)
+void Correlator::createHelpSummary()
 {
-  // Attach current shell.
-  shell_ = shell;
+  char helpstr[ControlService::maxLine];
 
-  // Create alias map.
-  aliasMap_.clear();
-  for (Correlator::shell_type::const_iterator iCmd = shell->begin();
-       iCmd != shell->end(); ++iCmd) {
+  helpSummary_.clear();
+  for (shell_type::const_iterator iCmd = shell_->begin();
+       iCmd != shell_->end(); ++iCmd) {
+    shell_type::const_iterator iPrev;
     const char *p;
-    for (p = iCmd->first.c_str(); isgraph(*p); ++p) ;
-
-    // Add only printable command names to alias list.
-    if (iCmd->first.size() > 0 && *p == '\0') {
-      alias_container_type::iterator iAlias;
-
-      for (iAlias  = aliasMap_.begin();
-	   iAlias != aliasMap_.end() && iAlias->second != iCmd->second;
-	   iAlias++) ;
+    for (p = iCmd->key; isgraph(*p); ++p) ;
 
-      if (iAlias == aliasMap_.end()) {
-	// Add new command.
-	aliasMap_[iCmd->first] = iCmd->second;
-      } else {
-	// Extend alias list.
-	std::string aliases = iAlias->first;
-	aliases += ", ";
-	aliases += iCmd->first;
-
-	// Replace old aliases with new.
-	aliasMap_[aliases] = iAlias->second;
-	aliasMap_.erase(iAlias);
+    // List each printable command once, at its first printable alias.
+    if (*iCmd->key == '\0' || *p != '\0') { continue; }
+    for (iPrev = shell_->begin(); iPrev != iCmd; ++iPrev) {
+      for (p = iPrev->key; isgraph(*p); ++p) ;
+      if (iPrev->member == iCmd->member && *iPrev->key != '\0' && *p == '\0') {
+	break;
       }
     }
-  }
-
-  // Form help string.
-  char helpstr[ControlService::maxLine];
-  //
-  helpSummary_.clear();
-  for (alias_container_type::const_iterator iAlias = aliasMap_.begin();
-       iAlias != aliasMap_.end(); ++iAlias) {
+    if (iPrev != iCmd) { continue; }
 
     // Get help string and truncate to first line.
     char *newline;
-    (this->*(iAlias->second))(helpstr, 0);
+    (this->*(iCmd->member))(helpstr, 0);
     newline = strchr(helpstr, '\n');
     if (newline) { *newline = '\0'; }
 
     // Enforce return status convention: no '#' at start of line 2 onward.
-    if (iAlias !=  aliasMap_.begin()) { helpstr[0] = '|'; }
+    if (!helpSummary_.empty()) { helpstr[0] = '|'; }
 
     // Append a line of summary help.
     helpSummary_ += helpstr;
@@ -1293,6 +1420,18 @@ void Correlator::createHelpSummary(Correlator::shell_type *shell)
 }
 
 
+/**
+  Zpectrometer command key ordering: byte-wise, as strcmp(). Command tables
+  must be sorted in this order.
+*/
+template <>
+int Correlator::shell_type::compare(const Correlator::key_type& a,
+    const Correlator::key_type& b)
+{
+  return strcmp(a, b);
+}
+
+
 /**
   Zpectrometer command parser.
   This method implements the Zpectrometer command parser. Input consists
@@ -1300,7 +1439,8 @@ void Correlator::createHelpSummary(Correlator::shell_type *shell)
   remainder (if any) representing command-specific options. Command names are
   case-insensitive.
 
-  \note The input command line will be modified during parsing.
+  \note The input command line will be modified during parsing; the key
+        points into it.
 */
 template <>
 void Correlator::shell_type::parse(Correlator::key_type& key,
@@ -1321,6 +1461,7 @@ void Correlator::shell_type::parse(Correlator::key_type& key,
   arg.help    = false;
   arg.fdRead  = cmd.fdRead;
   arg.fdWrite = cmd.fdWrite;
+  arg.client  = cmd.client;
   arg.str     = strchr(cmd.str, '\0') + 1;
 
   // Skip leading whitespace; if no arguments present, set to NULL.
@@ -1340,10 +1481,16 @@ void Correlator::shell_type::cmdNotFound(Correlator::return_type rtn,
     Correlator::key_type& key, Correlator::argument_type& arg,
     Correlator::command_type& cmd) const
 {
-  for (const char *ckey = key.c_str(); *ckey; ++ckey) {
+  char name[32];
+
+  // The key may point into the return buffer: copy it first.
+  strncpy(name, key, sizeof(name)-1);
+  name[sizeof(name)-1] = '\0';
+
+  for (const char *ckey = name; *ckey; ++ckey) {
     zpec_debug("shell input: 0x%02x\r\n", *ckey + 256*(*ckey < 0));
   }
 
   siprintf(rtn, "! Unrecognized command '%s'. To see the list, type: help\r\n",
-           key.c_str());
+           name);
 }
@@ -17,47 +17,80 @@
 /**
   \brief Executes single-argument class member functions for arbitrary types.
 
-  This class implements a simple command dispatcher. It is essentially an
-  associative array with enhanced functionality. Specific instantiations
-  need to implement the parse() and cmdNotFound() methods, which determine how
-  a command is parsed into a command name (key) and argument. The key is used
-  in exec() to look up the associated member function, which is called with
-  the command argument on the object supplied at construction.
+  This class implements a simple command dispatcher. It is essentially a
+  read-only associative array with enhanced functionality. Specific
+  instantiations need to implement the parse(), compare() and cmdNotFound()
+  methods, which determine how a command is parsed into a command name (key)
+  and argument, and how keys are ordered. The key is used in exec() to look up
+  the associated member function, which is called with the command argument
+  on the object supplied at construction.
+
+  The dictionary is a static array of entries sorted by key (cf. compare()),
+  attached with setTable(); it is built by the compiler, and lookup is a
+  binary search that allocates no memory.
 
   \param Obj_t Type of object whose member functions will be called.
   \param Cmd_t Raw command input type.
   \param Rtn_t Member function return type
                (normally a pointer or reference type).
   \param Arg_t Member function argument type.
-  \param Key_t Dictionary key type (must support operator< and operator>).
+  \param Key_t Dictionary key type.
 */
 template<typename Obj_t, typename Cmd_t,
          typename Rtn_t, typename Arg_t, typename Key_t>
 class CommandInterpreter
 {
 public:
-  /// Container type.
-  typedef std::map<Key_t, void (Obj_t::*)(Rtn_t, Arg_t)> container_type;
+  /// Member function type.
+  typedef void (Obj_t::*member_type)(Rtn_t, Arg_t);
+
+  /// Dictionary entry.
+  struct entry_type {
+    Key_t       key;     ///< Command name.
+    member_type member;  ///< Command member function.
+  };
 
   /// Constant iterator type.
-  typedef typename container_type::const_iterator const_iterator;
+  typedef const entry_type *const_iterator;
 
   /// Constructor.
-  CommandInterpreter(Obj_t* obj) : obj_(obj) { }
+  CommandInterpreter(Obj_t* obj) : obj_(obj), begin_(0), end_(0) { }
 
-  /// Indexing operator.
-  typename container_type::mapped_type& operator[](const Key_t& key) {
-    return cmdMap_[key];
+  /**
+    \brief Attaches the command dictionary.
+    \param table Entries sorted by key; must outlive the interpreter.
+    \param n     Number of entries.
+    \return Whether the entries are sorted (lookup fails otherwise).
+  */
+  bool setTable(const entry_type *table, unsigned n)
+  {
+    begin_ = table;
+    end_   = table + n;
+    for (const_iterator i = begin_; i+1 < end_; ++i) {
+      if (compare(i[0].key, i[1].key) >= 0) { return false; }
+    }
+    return true;
   }
 
   /// Start of array.
-  const_iterator begin() const { return cmdMap_.begin(); }
+  const_iterator begin() const { return begin_; }
 
   /// End of array.
-  const_iterator end() const { return cmdMap_.end(); }
+  const_iterator end() const { return end_; }
 
   /// Finds a command.
-  const_iterator find(const Key_t& key) const { return cmdMap_.find(key); }
+  const_iterator find(const Key_t& key) const
+  {
+    const_iterator lo = begin_, hi = end_;
+    while (lo < hi) {
+      const_iterator mid = lo + (hi - lo)/2;
+      int cmp = compare(mid->key, key);
+      if      (cmp < 0) { lo = mid + 1; }
+      else if (cmp > 0) { hi = mid; }
+      else              { return mid; }
+    }
+    return end_;
+  }
 
   /**
     \brief Executes a command.
@@ -69,9 +102,9 @@ public:
     Key_t key;
     Arg_t arg;
     parse(key, arg, cmd);
-    typename container_type::const_iterator iCmd = cmdMap_.find(key);
-    if (iCmd != cmdMap_.end()) { (obj_->*(iCmd->second))(rtn, arg); }
-    else                       { cmdNotFound(rtn, key, arg, cmd); }
+    const_iterator iCmd = find(key);
+    if (iCmd != end_) { (obj_->*(iCmd->member))(rtn, arg); }
+    else              { cmdNotFound(rtn, key, arg, cmd); }
   }
 
   /**
@@ -83,6 +116,13 @@ public:
   */
   void parse(Key_t& key, Arg_t& arg, Cmd_t& cmd) const;
 
+  /**
+    \brief Orders dictionary keys.
+    \return Negative, zero or positive as \a a sorts before, with or after
+            \a b.
+  */
+  static int compare(const Key_t& a, const Key_t& b);
+
   /**
     \brief Return value for unrecognized commands.
     \param rtn Return value.
@@ -97,7 +137,7 @@ private:
   Obj_t* obj_;
 
   /// Command dictionary.
-  container_type cmdMap_;
+  const_iterator begin_, end_;
 };
 
 
@@ -137,27 +177,29 @@ public:
   struct command_type {
     char *str;    ///< Command string (with arguments).
     int  fdRead,  ///< Open, readable client file descriptor (-1 if none).
-         fdWrite; ///< Open, writable client file descriptor (-1 if none).
+         fdWrite, ///< Open, writable client file descriptor (-1 if none).
+         client;  ///< Requesting control client id (-1 if none).
   };
 
   /// Control shell argument type.
   struct argument_type {
     char *str;    ///< Argument string.
     int  fdRead,  ///< Open, readable client file descriptor (-1 if none).
-         fdWrite; ///< Open, writable client file descriptor (-1 if none).
+         fdWrite, ///< Open, writable client file descriptor (-1 if none).
+         client;  ///< Requesting control client id (-1 if none).
     bool help;    ///< Whether to generate help message (only).
 
     /// Default constructor.
     argument_type(char *s = 0, int fdRead = -1, int fdWrite = -1,
 		  bool h = true) :
-	str(s), fdRead(fdRead), fdWrite(fdWrite), help(h) { }
+	str(s), fdRead(fdRead), fdWrite(fdWrite), client(-1), help(h) { }
   };
 
   /// Control shell return type.
   typedef char *return_type;
 
   /// Control shell key type.
-  typedef std::string key_type;
+  typedef const char *key_type;
 
   /// Control shell type.
   typedef CommandInterpreter<Correlator, command_type, return_type,
@@ -179,11 +221,13 @@ public:
   DataService    dataServer;     ///< Lag data server.
   MonitorService monitorServer;  ///< Monitor data server.
   MessageService messageServer;  ///< Log message server.
+  TelemetryService telemetryServer;  ///< Argus telemetry server.
 
   /// Constructor.
   Correlator(unsigned nBands, unsigned nBuffers, unsigned nLags) :
     accumulating_(false), band_(nBands), io_(0), master_(false), bootTicks_(0),
-    mode_(MODE_NORMAL), nBuffers_(nBuffers), shell_(0), verbose_(ZPEC_LOG_INFO)
+    mode_(MODE_NORMAL), nBuffers_(nBuffers), shell_(0), verbose_(ZPEC_LOG_INFO),
+    adcRing_(ZPEC_ADC_RING), acqReady_(false)
   {
     for (unsigned i=0; i<nBands; ++i) {
       band_[i].lags.setResolution(nLags, nBuffers);
@@ -247,6 +291,9 @@ public:
     return monPoints_;
   }
 
+  /// Hardware variant.
+  zpec_hw_t hardware() const { return hw_; }
+
   /// First hardware-specific monitor ADC (logical) channel.
   unsigned monitorBegin() { return hw_adc_begin_; }
 
@@ -260,6 +307,7 @@ public:
   void execDiodeObs(return_type status, argument_type arg);
   void execFlash(return_type status, argument_type arg);
   void execHalt(return_type status, argument_type arg);
+  void execRing(return_type status, argument_type arg);
   void execHelp(return_type status, argument_type arg);
   void execInitADCs(return_type status, argument_type arg);
   void execLevel(return_type status, argument_type arg);
@@ -277,6 +325,7 @@ public:
   void execSync(return_type status, argument_type arg);
   void execTime(return_type status, argument_type arg);
   void execjUpTime(return_type status, argument_type arg);
+  void execjTiming(return_type status, argument_type arg);
 
   void execTotalPower(return_type status, argument_type arg);
   void execVerbose(return_type status, argument_type arg);
@@ -308,12 +357,18 @@ public:
   void execCOMAPatten(return_type status, argument_type arg);
   void execJCOMAPatten(return_type status, argument_type arg);
   void execArgusVane(return_type status, argument_type arg);
+  void execVane(return_type status, argument_type arg);
+  void execJVane(return_type status, argument_type arg);
+  void execJVaneTraj(return_type status, argument_type arg);
+  void execTelem(return_type status, argument_type arg);
+  void execBatch(return_type status, argument_type arg);
   void execArgusRxHealth(return_type status, argument_type arg);
   void execArgusFreeze(return_type status, argument_type arg);
   void execJArgusFreeze(return_type status, argument_type arg);
   void execArgusThaw(return_type status, argument_type arg);
   void execJArgusThaw(return_type status, argument_type arg);
   void execArgusLock(return_type status, argument_type arg);
+  void execJArgusTrace(return_type status, argument_type arg);
   void execJCOMAPlna(return_type status, argument_type arg);
   void execJCOMAPlnaTestRet(return_type status, argument_type arg);
   void execJCOMAPsets(return_type status, argument_type arg);
@@ -326,16 +381,11 @@ public:
   void execJCOMAPlogp(return_type status, argument_type arg);
 
 private:
-  /// Alias map container type.
-  typedef std::map<std::string,
-                   void (Correlator::*)(return_type, argument_type)>
-          alias_container_type;
-
   mutable OS_CRIT lock_;    ///< Main correlator mutex.
   bool accumulating_;       ///< Whether some task is accumulating ADC data.
   container_type band_;     ///< Observing bands.
   error_type error_;        ///< Error indicators.
-  std::string helpSummary_; ///< Summary list of control commands.
+  std::string helpSummary_; ///< Summary list of control commands (on demand).
   global_io_t *io_;         ///< Low-level I/O pointers (C-callable).
   bool master_;             ///< Whether this correlator is the sync master.
   zpec_hw_t hw_;            ///< Hardware variant.
@@ -349,14 +399,45 @@ private:
   int verbose_;             ///< Log message verbosity level.
 
   std::vector<lag_count_t>
-              adcBuffer_;  ///< ADC_isr() input sample storage.
+              adcBuffer_;  ///< ADC_isr() input sample storage (frame ring).
   MonitorData monPoints_;  ///< Monitor point dictionary.
+  unsigned    adcRing_;    ///< ADC frame ring depth (slots).
+
+  /// ADC accumulation job, run by the acquisition task.
+  struct AcqJob {
+    Observation *obs;      ///< Observation processing frames.
+    BasicObservation *spare;  ///< Free accumulator, or the one published.
+    unsigned nFrames,      ///< Frames to accumulate per integration.
+             nRepeat,      ///< Number of integrations.
+             iRepeat,      ///< Current integration.
+             nAccum;       ///< Frames accumulated in current integration.
+    int fdRead,            ///< Interrupt input descriptor, or -1.
+        fdWrite;           ///< Intermediate status descriptor, or -1.
+    return_type status;    ///< Intermediate status buffer.
+    volatile bool interrupted;  ///< Stop at the next frame (halt, input).
+    bool phaseLost;        ///< Frames dropped from a phase-switched observation.
+  };
+
+  AcqJob acqJob_;          ///< Current acquisition job.
+  OS_SEM acqStart_,        ///< Posted to start acqJob_.
+         acqDone_,         ///< Posted when acqJob_ completes.
+         acqSwap_,         ///< Posted when acqJob_.spare awaits publication.
+         acqFree_;         ///< Posted when acqJob_.spare is free.
+  bool   acqReady_;        ///< Whether the acquisition task is running.
+
+  /// Second accumulator for repeated integrations.
+  BasicObservation acqSpare_;
+
+  /// Acquisition task stack space.
+  DWORD acqStack_[USER_TASK_STK_SIZE] __attribute__( ( aligned( 4 ) ) );
+
+  // OS task function; declared via typedef to force C linkage conventions.
+  static task_fn_t acqTask;
 
 
-  /// Command alias map (cf. createHelpSummary()).
-  alias_container_type aliasMap_;
+  void createHelpSummary();
 
-  void createHelpSummary(shell_type *shell);
+  unsigned listAliases(char *str, shell_type::member_type member) const;
 
   void longHelp(return_type status, const char *usage,
                 void (Correlator::*member)(return_type, argument_type)) const;
@@ -365,12 +446,16 @@ private:
   void setMonitorPoint(int channel, bool useLock);
 
   void collateData(const LagData &lags, unsigned nBuffers = 1);
+  void startAcquisition();
+  unsigned accumulate(AcqJob& job);
+  void publishIntegration(AcqJob& job);
   unsigned readADCs(Observation *obs, unsigned nFrames,
 		    argument_type& arg, return_type status,
 		    unsigned nRepeat = 1);
   unsigned setIntegStatus(return_type status,
                           unsigned nAccum, unsigned nFrames,
 			  bool checkFraming = true);
+  unsigned setTimingStatus(return_type status);
   lag_count_t findCounts(return_type status, unsigned *len,
                          BasicObservation *obs, int atten,
 			 unsigned channel, unsigned nFrames, int fdRead);
@@ -43,7 +43,21 @@
 */
 void LagData::write(int fd, unsigned iBuffer, unsigned nLags) const
 {
-  static const char *fn = "LagData::write";
+  std::string out;
+  write(out, iBuffer, nLags);
+  zpec_write_retry(fd, out.data(), out.size(), "LagData::write");
+}
+
+/**
+  Appends lag data to a string, formatted as for write(int, unsigned,
+  unsigned) const.
+
+  \param out     Output string.
+  \param iBuffer Lag buffer to output.
+  \param nLags   Number of lags to output (0 means "all in this buffer").
+*/
+void LagData::write(std::string& out, unsigned iBuffer, unsigned nLags) const
+{
   unsigned nChars, nWrite;
   char header[32];
 
@@ -53,11 +67,11 @@ void LagData::write(int fd, unsigned iBuffer, unsigned nLags) const
                     iBuffer, nWrite, frames_[iBuffer],
 		    time_[iBuffer]/TICKS_PER_SECOND,
 		    (time_[iBuffer] % TICKS_PER_SECOND)*(100/TICKS_PER_SECOND));
-  zpec_write_retry(fd, header, nChars, fn);
+  out.append(header, nChars);
 
   // Assumes native byte ordering matches standard network byte order.
-  zpec_write_retry(fd, &lags_[0],
-                   nWrite*sizeof(container_type::value_type), fn);
+  out.append((const char *)&lags_[0],
+             nWrite*sizeof(container_type::value_type));
 }
 
 
@@ -75,7 +89,20 @@ void LagData::write(int fd, unsigned iBuffer, unsigned nLags) const
 */
 void MonitorData::write(int fd, const char *point) const
 {
-  static const char *fn = "MonitorData::write";
+  std::string out;
+  write(out, point);
+  zpec_write_retry(fd, out.data(), out.size(), "MonitorData::write");
+}
+
+/**
+  Appends a monitor point, or all of them, to a string, formatted as for
+  write(int, const char *) const.
+
+  \param out   Output string.
+  \param point Monitor point name (can be NULL).
+*/
+void MonitorData::write(std::string& out, const char *point) const
+{
   container_type::const_iterator iUnit, iValue, endValue;
   
   if (point) {
@@ -97,7 +124,7 @@ void MonitorData::write(int fd, const char *point) const
               (int )maxPoint_, iValue->first.c_str(), (int )maxValue_,
 	      iValue->second.length() ? iValue->second.c_str() : "UNKNOWN",
 	      iUnit->second.c_str());
-    zpec_write_retry(fd, str, len, fn);
+    out.append(str, len);
   }
 }
 
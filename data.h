@@ -112,6 +112,7 @@ public:
   container_type::size_type size() const { return lags_.size(); }
 
   void write(int fd, unsigned iBuffer, unsigned nLags) const;
+  void write(std::string& out, unsigned iBuffer, unsigned nLags) const;
 
   /// C vector assignment operator.
   LagData& operator=(const container_type::value_type *lags) {
@@ -168,6 +169,7 @@ public:
   }
 
   void write(int fd, const char *point = 0) const;
+  void write(std::string& out, const char *point = 0) const;
 
 private:
   container_type valueMap_,  ///< Monitor point value dictionary.
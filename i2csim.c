@@ -0,0 +1,385 @@
+/**
+  \file
+  \brief  Simulated I2C bus for SIMULATE and host-side builds.
+
+  Devices are addressed through the same switch tree as the hardware:
+  the root PCA954x at 0x77 (backplane for the bias system, subbus for the DCM2),
+  optional second-level switches (0x74 on the bias system subbus card, one 0x73
+  per DCM2 group of four receivers), and leaf devices behind them.  A write
+  reaches every device that is selected by the present switch settings, so
+  broadcast selects behave as in hardware; a read from several devices
+  returns the wired-AND of their responses.
+
+  Each device instance is keyed by its route and address:
+  (first-level channel << 12) | (second-level channel << 8) | address,
+  with channel 0xf for "not behind a switch at this level".
+*/
+
+#include <string.h>
+
+#include "i2csim.h"
+
+#define SIM_NDEV 160        // device instance table size
+#define SIM_NONE 0xf        // route channel code for no switch at this level
+#define SIM_KEY(l1, l2, a)  ((unsigned short)(((l1) << 12) | ((l2) << 8) | (a)))
+
+// device kinds
+#define SIM_ABSENT -1
+#define SIM_SWITCH  0       // PCA954x/TCA9548A switch
+#define SIM_DAC     1       // bias card DAC: command byte, then 16-bit word
+#define SIM_ADC     2       // LTC2309-style ADC: command byte, then 2-byte read
+#define SIM_BEX     3       // TCA6408A bus expander
+#define SIM_TEMP    4       // LM75-style temperature sensor
+
+typedef struct simdev_struct {
+	unsigned short key;     // route and address
+	signed char kind;       // device kind
+	unsigned char ptr;      // register pointer or ADC conversion command
+	unsigned char reg[4];   // switch control byte, or BEX in/out/polarity/config registers
+	unsigned short dac[8];  // DAC words by channel
+} simdev_t;
+
+static simdev_t simDev[SIM_NDEV];
+static int simNdev = 0;
+static int simBias = 1;                 // topology: 1 for bias system, 0 for DCM2
+static unsigned char simInputs = 0x00;  // level read on BEX input pins
+
+static i2csim_latency_t simLat = {I2CSIM_CLK_HZ, I2CSIM_START_US, 9000000/I2CSIM_CLK_HZ};
+static i2csim_stats_t simStats;
+
+/*******************************************************************/
+/**
+  \brief Device kind at a route and address.
+
+  Encodes the chassis wiring; see i2cAdresses.txt and argusHardwareStructs.h.
+
+  \param  l1    first-level (0x77) channel, or SIM_NONE.
+  \param  l2    second-level channel, or SIM_NONE.
+  \param  addr  I2C address.
+  \return device kind, or SIM_ABSENT.
+*/
+static int simKind(int l1, int l2, unsigned char addr)
+{
+	if (l1 == SIM_NONE) {  // main bus
+		if (addr == 0x77) return SIM_SWITCH;
+		if (addr == 0x73 && simBias) return SIM_SWITCH;  // reserved, in hardware
+		return SIM_ABSENT;
+	}
+
+	if (simBias) {
+		switch (l1) {
+		case 0: case 1: case 2: case 3: case 7:  // bias cards 0x01, 0x02, 0x04, 0x08, 0x80
+			if (l2 != SIM_NONE) return SIM_ABSENT;
+			if (addr == 0x31 || addr == 0x32 || addr == 0x40 || addr == 0x41) return SIM_DAC;
+			if (addr == 0x08 || addr == 0x09 || addr == 0x0a || addr == 0x0b ||
+					addr == 0x18 || addr == 0x19) return SIM_ADC;
+			return SIM_ABSENT;
+		case 4:  // thermometry card 0x10
+			return (l2 == SIM_NONE && addr == 0x08 ? SIM_ADC : SIM_ABSENT);
+		case 5:  // subbus card 0x20: saddlebags 0..3 and vane on the 0x74 switch
+			if (l2 == SIM_NONE) return (addr == 0x74 ? SIM_SWITCH : SIM_ABSENT);
+			if (l2 > 4) return SIM_ABSENT;
+			if (addr == 0x08) return SIM_ADC;
+			if (addr == 0x21) return SIM_BEX;
+			return SIM_ABSENT;
+		case 6:  // power control card 0x40
+			if (l2 != SIM_NONE) return SIM_ABSENT;
+			if (addr == 0x08) return SIM_ADC;
+			if (addr == 0x21) return SIM_BEX;
+			if (addr == 0x4f) return SIM_TEMP;
+			return SIM_ABSENT;
+		}
+	} else {
+		if (l1 <= 4) {  // DCM2 module groups 0x01..0x10, one 0x73 switch each
+			if (l2 == SIM_NONE) return (addr == 0x73 ? SIM_SWITCH : SIM_ABSENT);
+			return (addr == 0x20 ? SIM_BEX : SIM_ABSENT);  // ssba 0x08..0x01, ssbb 0x80..0x10
+		}
+		if (l1 == 7 && l2 == SIM_NONE) {  // DCM2 main board peripherals 0x80
+			if (addr == 0x08) return SIM_ADC;
+			if (addr == 0x21) return SIM_BEX;
+		}
+	}
+	return SIM_ABSENT;
+}
+
+/*******************************************************************/
+/**
+  \brief Second-level switch address on a first-level channel.
+
+  \param  l1  first-level channel.
+  \return switch address, or zero if there is none.
+*/
+static unsigned char simSubSwitch(int l1)
+{
+	if (simBias) return (l1 == 5 ? 0x74 : 0);
+	return (l1 <= 4 ? 0x73 : 0);
+}
+
+/*******************************************************************/
+/**
+  \brief Find or create a device instance.
+
+  \param  key   route and address key.
+  \param  kind  device kind, used when creating.
+  \return pointer to device state, or 0 if the table is full.
+*/
+static simdev_t *simFind(unsigned short key, int kind)
+{
+	int i;
+
+	for (i=0; i<simNdev; i++) {
+		if (simDev[i].key == key) return &simDev[i];
+	}
+	if (simNdev >= SIM_NDEV) return 0;
+
+	simdev_t *d = &simDev[simNdev++];
+	memset(d, 0, sizeof(*d));
+	d->key = key;
+	d->kind = (signed char)kind;
+	if (kind == SIM_BEX) {
+		d->reg[1] = 0xff;  // TCA6408A power-on output register
+		d->reg[3] = 0xff;  // TCA6408A power-on configuration: all inputs
+	}
+	return d;
+}
+
+/*******************************************************************/
+/**
+  \brief Control byte of a switch instance.
+*/
+static unsigned char simSwitchState(int l1, unsigned char addr)
+{
+	simdev_t *d = simFind(SIM_KEY(l1, SIM_NONE, addr), SIM_SWITCH);
+	return (d ? d->reg[0] : 0);
+}
+
+/*******************************************************************/
+/**
+  \brief List device instances selected by the present switch settings.
+
+  \param  addr  I2C address.
+  \param  devs  output list of device pointers (at least 1 + 8 + 64 entries).
+  \return number of devices that will respond.
+*/
+static int simRoute(unsigned char addr, simdev_t **devs)
+{
+	int i, j, kind, n = 0;
+	unsigned char sw1, sw2, sub;
+	simdev_t *d;
+
+	kind = simKind(SIM_NONE, SIM_NONE, addr);
+	if (kind != SIM_ABSENT && (d = simFind(SIM_KEY(SIM_NONE, SIM_NONE, addr), kind))) devs[n++] = d;
+
+	sw1 = simSwitchState(SIM_NONE, 0x77);
+	for (i=0; i<8; i++) {
+		if (!(sw1 & (1 << i))) continue;
+		kind = simKind(i, SIM_NONE, addr);
+		if (kind != SIM_ABSENT && (d = simFind(SIM_KEY(i, SIM_NONE, addr), kind))) devs[n++] = d;
+		sub = simSubSwitch(i);
+		if (!sub) continue;
+		sw2 = simSwitchState(i, sub);
+		for (j=0; j<8; j++) {
+			if (!(sw2 & (1 << j))) continue;
+			kind = simKind(i, j, addr);
+			if (kind != SIM_ABSENT && (d = simFind(SIM_KEY(i, j, addr), kind))) devs[n++] = d;
+		}
+	}
+	return n;
+}
+
+/*******************************************************************/
+/**
+  \brief Synthetic ADC conversion result.
+
+  Power control card channels read nominal supply rails so that the LNA power
+  sequencing checks pass; thermometry channels read a cold diode; everything
+  else reads a fixed word that depends on the channel.
+*/
+static unsigned short simAdcWord(const simdev_t *d)
+{
+	int l1 = d->key >> 12;
+
+	if (simBias && l1 == 6) {  // power control card: vds, -15, +15, vcc
+		switch (d->ptr) {
+		case 0x88: return 40000;  // 5.0 V
+		case 0xc8: return 52805;  // -15.0 V
+		case 0x98: return 50772;  // +15.0 V
+		case 0xd8: return 40000;  // 5.0 V
+		}
+	}
+	if (simBias && l1 == 4) return 36043;  // 1.0 V at thermometry input
+	return (unsigned short)(0x2000 + ((d->ptr & 0x70) << 4));
+}
+
+/*******************************************************************/
+/**
+  \brief Add one transaction to the latency model.
+*/
+static void simTally(int n, int acked)
+{
+	simStats.busUs += simLat.startUs + (acked ? n + 1 : 1)*simLat.byteUs;
+	if (!acked) simStats.nacks += 1;
+	else simStats.bytes += n;
+}
+
+/*******************************************************************/
+/**
+  \brief Simulated I2CSendBuf().
+
+  \param  addr  I2C device address.
+  \param  buf   bytes to write.
+  \param  n     number of bytes.
+  \return I2CSIM_OK, or I2CSIM_NACK if no device is selected at addr.
+*/
+int i2csim_send(unsigned char addr, const unsigned char *buf, int n)
+{
+	simdev_t *devs[1 + 8 + 8*8];
+	int i, ndev;
+
+	simStats.sends += 1;
+	ndev = simRoute(addr, devs);
+	simTally(n, ndev > 0);
+	if (!ndev) return I2CSIM_NACK;
+
+	for (i=0; i<ndev; i++) {
+		simdev_t *d = devs[i];
+		if (n < 1) continue;
+		switch (d->kind) {
+		case SIM_SWITCH:
+			d->reg[0] = buf[n-1];
+			simStats.selects += 1;
+			break;
+		case SIM_DAC:
+			d->ptr = buf[0];
+			if (n >= 3) d->dac[buf[0] & 0x07] = (unsigned short)((buf[1] << 8) | buf[2]);
+			break;
+		case SIM_BEX:
+			d->ptr = buf[0] & 0x03;
+			// further data bytes rewrite the same register; the input register is read-only
+			if (n >= 2 && d->ptr) d->reg[d->ptr] = buf[n-1];
+			break;
+		default:
+			d->ptr = buf[0];
+			break;
+		}
+	}
+	return I2CSIM_OK;
+}
+
+/*******************************************************************/
+/**
+  \brief Simulated I2CReadBuf().
+
+  \param  addr  I2C device address.
+  \param  buf   buffer for bytes read.
+  \param  n     number of bytes.
+  \return I2CSIM_OK, or I2CSIM_NACK if no device is selected at addr.
+*/
+int i2csim_read(unsigned char addr, unsigned char *buf, int n)
+{
+	simdev_t *devs[1 + 8 + 8*8];
+	unsigned char b[2];
+	int i, k, ndev;
+
+	simStats.reads += 1;
+	ndev = simRoute(addr, devs);
+	simTally(n, ndev > 0);
+	if (!ndev) return I2CSIM_NACK;
+
+	for (k=0; k<n; k++) buf[k] = 0xff;  // open-drain bus idles high
+	for (i=0; i<ndev; i++) {
+		simdev_t *d = devs[i];
+		unsigned short w;
+		switch (d->kind) {
+		case SIM_SWITCH:
+			b[0] = b[1] = d->reg[0];
+			break;
+		case SIM_ADC:
+			w = simAdcWord(d);
+			b[0] = (unsigned char)(w >> 8);
+			b[1] = (unsigned char)w;
+			break;
+		case SIM_BEX:
+			if (d->ptr == 0) b[0] = (d->reg[1] & ~d->reg[3]) | (simInputs & d->reg[3]);
+			else b[0] = d->reg[d->ptr];
+			b[1] = b[0];
+			break;
+		case SIM_TEMP:
+			b[0] = 25;  // 25 C, LM75 format
+			b[1] = 0;
+			break;
+		default:
+			b[0] = b[1] = 0;
+			break;
+		}
+		for (k=0; k<n; k++) buf[k] &= b[k < 2 ? k : 1];
+	}
+	return I2CSIM_OK;
+}
+
+/*******************************************************************/
+/**
+  \brief Reset the simulated bus.
+
+  Clears all device state and selects the chassis topology.
+
+  \param  biasSys  1 for the LNA bias system, 0 for the DCM2 system.
+*/
+void i2csim_reset(int biasSys)
+{
+	simBias = biasSys;
+	simNdev = 0;
+	memset(simDev, 0, sizeof(simDev));
+}
+
+/*******************************************************************/
+/**
+  \brief Simulate the J2[28] switch reset line: open every switch.
+*/
+void i2csim_switchReset(void)
+{
+	int i;
+	for (i=0; i<simNdev; i++) {
+		if (simDev[i].kind == SIM_SWITCH) simDev[i].reg[0] = 0x00;
+	}
+}
+
+/*******************************************************************/
+/**
+  \brief Set the modeled bus clock.
+
+  \param  clkHz  I2C clock frequency [Hz]; zero restores the default.
+*/
+void i2csim_setClock(unsigned int clkHz)
+{
+	if (!clkHz) clkHz = I2CSIM_CLK_HZ;
+	simLat.clkHz = clkHz;
+	simLat.byteUs = 9000000/clkHz;
+}
+
+/*******************************************************************/
+/**
+  \brief Get the latency model parameters.
+*/
+void i2csim_getLatency(i2csim_latency_t *lat)
+{
+	*lat = simLat;
+}
+
+/*******************************************************************/
+/**
+  \brief Clear the bus traffic counters.
+*/
+void i2csim_resetStats(void)
+{
+	memset(&simStats, 0, sizeof(simStats));
+}
+
+/*******************************************************************/
+/**
+  \brief Get the bus traffic counters.
+*/
+void i2csim_getStats(i2csim_stats_t *stats)
+{
+	*stats = simStats;
+}
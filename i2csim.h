@@ -0,0 +1,57 @@
+#ifndef I2CSIM_H
+#define I2CSIM_H
+/**
+  \file
+  \brief  Simulated I2C bus declarations.
+
+  Stand-in for the NetBurner I2CSendBuf() and I2CReadBuf() calls behind the
+  I2CSEND and I2CREAD macros when SIMULATE is defined in argusHardwareStructs.h.
+  The model covers the PCA954x switch tree, bias card DACs and ADCs, the
+  thermometry and power control cards, the saddlebag and vane interface cards,
+  and the DCM2 TCA6408A bus expanders, with a per-transaction latency model
+  for estimating bus time.
+
+  Uses no NetBurner headers so that it also builds on a workstation.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2CSIM_OK   0         // transaction acknowledged (NB I2C_OK)
+#define I2CSIM_NACK 9         // no device acknowledged (NB I2C_NO_LINK_RX_ACK)
+
+#define I2CSIM_CLK_HZ 48800   // default bus clock [Hz], matches I2CInit(0xaa, 0x1a)
+#define I2CSIM_START_US 20    // default start/stop overhead per transaction [us]
+
+/** Latency model: a transaction costs startUs + (nbytes + 1)*byteUs. */
+typedef struct i2csim_latency_struct {
+	unsigned int clkHz;     // bus clock [Hz]
+	unsigned int startUs;   // start and stop condition overhead [us]
+	unsigned int byteUs;    // one byte plus acknowledge, nine bit times [us]
+} i2csim_latency_t;
+
+/** Bus traffic counters, accumulated since the last i2csim_resetStats(). */
+typedef struct i2csim_stats_struct {
+	unsigned int sends;     // write transactions
+	unsigned int reads;     // read transactions
+	unsigned int bytes;     // payload bytes, not counting address bytes
+	unsigned int nacks;     // transactions that no device acknowledged
+	unsigned int selects;   // writes to PCA954x switches
+	unsigned long busUs;    // modeled bus time [us]
+} i2csim_stats_t;
+
+extern int  i2csim_send(unsigned char addr, const unsigned char *buf, int n);
+extern int  i2csim_read(unsigned char addr, unsigned char *buf, int n);
+extern void i2csim_reset(int biasSys);
+extern void i2csim_switchReset(void);
+extern void i2csim_setClock(unsigned int clkHz);
+extern void i2csim_getLatency(i2csim_latency_t *lat);
+extern void i2csim_resetStats(void);
+extern void i2csim_getStats(i2csim_stats_t *stats);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  /* I2CSIM_H */
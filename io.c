@@ -44,17 +44,76 @@ cpld_mem_t cpld_cache[2];
 
 
 /**
-   ADC interrupt procedure.
-\verbatim
-   name: ADC_isr
-   masking level: The value of the ColdFire SR during the interrupt:
+  Empties a timing histogram.
 
-   use 0x2700 to mask all interrupts.
-       0x2500 to mask levels 1-5 etc...
-       0x2100 to mask level 1
-\endverbatim
+  \param h Histogram.
 */
-ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
+void zpec_hist_clear(zpec_hist_t *h)
+{
+  unsigned k;
+
+  h->n   = 0;
+  h->min = ~0UL;
+  h->max = 0;
+  for (k=0; k<ZPEC_HIST_BINS; ++k) { h->bin[k] = 0; }
+}
+
+
+/**
+  Adds a sample to a timing histogram. Callable from an ISR.
+
+  \param h      Histogram.
+  \param counts Sample (zpec_usclock() count difference).
+*/
+void zpec_hist_add(zpec_hist_t *h, unsigned long counts)
+{
+  unsigned long c = counts;
+  unsigned k = 0;
+
+  while (c && k < ZPEC_HIST_BINS-1) { c >>= 1; ++k; }
+  ++h->bin[k];
+  if (counts < h->min) { h->min = counts; }
+  if (counts > h->max) { h->max = counts; }
+  ++h->n;
+}
+
+
+/**
+  Estimates a timing histogram quantile.
+
+  \param h       Histogram.
+  \param percent Quantile (percent of samples).
+
+  \return Upper edge (counts) of the bin holding the quantile, at most the
+          longest sample; zero for an empty histogram.
+*/
+unsigned long zpec_hist_quantile(const zpec_hist_t *h, unsigned percent)
+{
+  unsigned long n = h->n, want = (n*percent + 99)/100, sum = 0;
+  unsigned k;
+
+  if (n == 0) { return 0; }
+  for (k=0; k<ZPEC_HIST_BINS-1; ++k) {
+    sum += h->bin[k];
+    if (sum >= want) { return ((1UL << k) < h->max ? (1UL << k) : h->max); }
+  }
+  return h->max;
+}
+
+
+/**
+   ADC interrupt procedure body.
+
+   Each ISR below inlines this body with a constant operating mode and
+   history setting, so the compiler folds the mode tests away; ADC_isr()
+   itself tests gio.mode and gio.adc_history on each interrupt.
+
+   \param mode    Operating mode.
+   \param history Whether to record the framing signal history (first[] and
+                  frame[]).
+*/
+static inline __attribute__((always_inline))
+void adc_isr_body(const zpec_mode_t mode, const int history)
 {
   /*
      WARNING WARNING WARNING
@@ -81,9 +140,18 @@ ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
   lag_count_t adc[2][2];
   cpld_mem_t reg0;
   int irq;
+#if ZPEC_ADC_TIMING
+  const unsigned long t0 = zpec_usclock();
+
+  /* Entry period; its spread bounds the variation in entry latency. */
+  if (gio.adc_calls) {
+    zpec_hist_add(&gio.adc_isr_period, t0 - gio.adc_isr_t0);
+  }
+  gio.adc_isr_t0 = t0;
+#endif
 
   /* Clear the interrupt edge. */
-  irq = (gio.mode == MODE_DEVKIT ? 1 : ZPEC_ADC_IRQ);
+  irq = (mode == MODE_DEVKIT ? 1 : ZPEC_ADC_IRQ);
   sim.eport.epfr = (1U << irq);
 
   /* Cache framing and sample data. */
@@ -99,12 +167,12 @@ ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
 
   /* For first sample, ignore interrupts until frame start. */
   if (gio.adc_count == 0) {
-    if (first==0 && gio.mode!=MODE_DEVKIT) { return; }
+    if (first==0 && mode!=MODE_DEVKIT) { return; }
     else { gio.adc_p = gio.adc_part_begin; }
   }
 
   /* Save framing bits to support debugging. */
-  {
+  if (ZPEC_ADC_HISTORY && history) {
     unsigned word = (gio.adc_count >> 5) &
                     (sizeof(gio.first)/sizeof(gio.first[0])-1),
 	     bit  = (gio.adc_count & 31);
@@ -127,7 +195,7 @@ ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
     gio.err_first += (first != (chan==0 ? frame : 0));
   }
 
-  switch (gio.mode) {
+  switch (mode) {
     case MODE_PATTERN:
       /* Assign known pattern. */
       adc[0][0] = 1*gio.adc_field+(chan+0)+1;
@@ -139,7 +207,7 @@ ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
     case MODE_PPHASE:
     case MODE_NPHASE:
       if ((gio.adc_field&1) == 0) {
-	if (gio.mode == MODE_NPHASE) {
+	if (mode == MODE_NPHASE) {
 	  /* Ignore positive phase switch. */
 	  gio.adc_p[0]       = 0;
 	  gio.adc_p[1]       = 0;
@@ -152,7 +220,7 @@ ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
 	  gio.adc_p[nLags+0] = adc[1][0];
 	  gio.adc_p[nLags+1] = adc[1][1];
         }
-      } else if (gio.mode != MODE_PPHASE) {
+      } else if (mode != MODE_PPHASE) {
 	/* Subtract samples during second field (unless ignored). */
 	gio.adc_p[0]       -= adc[0][0];
 	gio.adc_p[1]       -= adc[0][1];
@@ -189,18 +257,98 @@ ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
 
   if (gio.adc_p == gio.adc_part_end) {
     if ((gio.adc_field&1) == 1) {  /* Frame is complete. */
-      /* Swap ADC input buffers. */
-      ZPEC_SWAP(lag_count_t*, gio.adc_full_begin, gio.adc_part_begin);
-      ZPEC_SWAP(lag_count_t*, gio.adc_full_end,   gio.adc_part_end);
-
-      /* Inform accumulation task that new data is available (@ full_begin). */
-      OSSemPost(&gio.AdcIsrSem);
+      unsigned nReady = gio.adc_head - gio.adc_tail + 1;
+
+      if (nReady < gio.adc_ring_len) {
+	/* Pass the frame on, and fill the next slot. */
+	if (nReady > gio.adc_hiwater) { gio.adc_hiwater = nReady; }
+	++gio.adc_head;
+	gio.adc_part_begin += gio.adc_slot;
+	if (gio.adc_part_begin == gio.adc_ring_end) {
+	  gio.adc_part_begin = gio.adc_ring_begin;
+	}
+	gio.adc_part_end = gio.adc_part_begin + nLags;
+
+	/* Inform accumulation task that new data is available (@ adc_tail). */
+	OSSemPost(&gio.AdcIsrSem);
+      } else {
+	/* Ring full: drop the frame and refill its slot. */
+	++gio.adc_overrun;
+      }
     }
 
     /* Reset the input pointer and field count. */
     gio.adc_p = gio.adc_part_begin;
     ++gio.adc_field;
   }
+
+#if ZPEC_ADC_TIMING
+  zpec_hist_add(&gio.adc_isr_busy, zpec_usclock() - t0);
+#endif
+}
+
+
+/**
+   ADC interrupt procedure, for any operating mode.
+\verbatim
+   name: ADC_isr
+   masking level: The value of the ColdFire SR during the interrupt:
+
+   use 0x2700 to mask all interrupts.
+       0x2500 to mask levels 1-5 etc...
+       0x2100 to mask level 1
+\endverbatim
+*/
+ZPEC_INTERRUPT(ADC_isr, ZPEC_ADC_IRQ_MASK)
+{
+  adc_isr_body(gio.mode, gio.adc_history);
+}
+
+/** Defines an ADC ISR specialized for one mode and history setting. */
+#define ZPEC_ADC_ISR(name, mode, history) \
+  ZPEC_INTERRUPT(name, ZPEC_ADC_IRQ_MASK) { adc_isr_body(mode, history); }
+
+ZPEC_ADC_ISR(ADC_isr_normal,  MODE_NORMAL,  0)
+ZPEC_ADC_ISR(ADC_isr_pattern, MODE_PATTERN, 0)
+ZPEC_ADC_ISR(ADC_isr_devkit,  MODE_DEVKIT,  0)
+ZPEC_ADC_ISR(ADC_isr_pphase,  MODE_PPHASE,  0)
+ZPEC_ADC_ISR(ADC_isr_nphase,  MODE_NPHASE,  0)
+ZPEC_ADC_ISR(ADC_isr_extreme, MODE_EXTREME, 0)
+
+#if ZPEC_ADC_HISTORY
+ZPEC_ADC_ISR(ADC_isr_normal_h,  MODE_NORMAL,  1)
+ZPEC_ADC_ISR(ADC_isr_pattern_h, MODE_PATTERN, 1)
+ZPEC_ADC_ISR(ADC_isr_devkit_h,  MODE_DEVKIT,  1)
+ZPEC_ADC_ISR(ADC_isr_pphase_h,  MODE_PPHASE,  1)
+ZPEC_ADC_ISR(ADC_isr_nphase_h,  MODE_NPHASE,  1)
+ZPEC_ADC_ISR(ADC_isr_extreme_h, MODE_EXTREME, 1)
+#define ADC_ISR_H(name) name##_h
+#else
+#define ADC_ISR_H(name) name
+#endif
+
+/**
+  Selects the ADC ISR for an operating mode.
+
+  \param mode    Operating mode.
+  \param history Whether to record the framing signal history; ignored
+                 unless ZPEC_ADC_HISTORY is set.
+
+  \return The specialized ISR, or ADC_isr() for an invalid mode.
+*/
+zpec_isr_t *zpec_adc_isr(zpec_mode_t mode, int history)
+{
+  static zpec_isr_t *const isr[MODE_NMODES][2] = {
+    {ADC_isr_normal,  ADC_ISR_H(ADC_isr_normal)},
+    {ADC_isr_pattern, ADC_ISR_H(ADC_isr_pattern)},
+    {ADC_isr_devkit,  ADC_ISR_H(ADC_isr_devkit)},
+    {ADC_isr_pphase,  ADC_ISR_H(ADC_isr_pphase)},
+    {ADC_isr_nphase,  ADC_ISR_H(ADC_isr_nphase)},
+    {ADC_isr_extreme, ADC_ISR_H(ADC_isr_extreme)},
+  };
+
+  if (mode < 0 || mode >= MODE_NMODES) { return ADC_isr; }
+  return isr[mode][history != 0];
 }
 
 
@@ -294,6 +442,38 @@ void zpec_setup_mmap()
 }
 
 
+/**
+  Starts the free-running microsecond clock read by zpec_usclock().
+
+  DMA timer 3 counts the 73.728 MHz internal bus clock divided by 72, that is
+  at #ZPEC_USCLOCK_HZ, and wraps after about 70 minutes; differences of
+  zpec_usclock() values are valid across the wrap.
+*/
+void zpec_setup_usclock()
+{
+  /*
+     tmr is the timer mode register:
+       prescale 72, internal bus clock / 1, free run, enable
+     trr is the timer reference register
+  */
+  sim.timer[3].tmr = 0;
+  sim.timer[3].trr = 0xFFFFFFFF;
+  sim.timer[3].tcn = 0;
+  sim.timer[3].tmr = (71 << 8) | (1 << 1) | 1;
+}
+
+
+/**
+  Reads the microsecond clock started by zpec_setup_usclock().
+
+  \return Timer count, in units of 1/#ZPEC_USCLOCK_HZ s.
+*/
+unsigned long zpec_usclock()
+{
+  return sim.timer[3].tcn;
+}
+
+
 /**
   Initializes watchdog timer.
   \warn Currently non-functional (write to WCR ignored).
@@ -18,7 +18,19 @@ extern "C" {
 
 #define ZPEC_ADC_IRQ  5          ///< ADC readout IRQ level.
 #define ZPEC_ADC_IRQ_MASK 0x2700 ///< ADC readout IRQ mask (inside ISR).
-#define ZPEC_ADC_PRIO 30         ///< ADC readout task priority.
+#define ZPEC_ADC_RING 4          ///< Default ADC frame ring depth (slots).
+#define ZPEC_ADC_RING_MAX 8      ///< Maximum ADC frame ring depth (slots).
+#ifndef ZPEC_ADC_HISTORY
+#define ZPEC_ADC_HISTORY 1       ///< Build ADC ISRs recording framing history.
+#endif
+
+#define ZPEC_USCLOCK_HZ 1024000  ///< zpec_usclock() count rate (DMA timer 3).
+/** Converts a zpec_usclock() count difference (below 2^25) to microseconds. */
+#define ZPEC_USCLOCK_US(n) ((((unsigned long )(n))*125) >> 7)
+#ifndef ZPEC_ADC_TIMING
+#define ZPEC_ADC_TIMING 1        ///< Build ADC ISRs recording timing histograms.
+#endif
+#define ZPEC_HIST_BINS 16        ///< Timing histogram bins (powers of two).
 
 /** Operating mode. */
 typedef enum mode_type_enum {
@@ -177,13 +189,32 @@ typedef enum adc_channel_enum {
 /** Lag count type. */
 typedef long lag_count_t;
 
+/**
+  Timing histogram of zpec_usclock() count differences.
+
+  Bin 0 counts zero differences, bin k differences from 2^(k-1) up to 2^k
+  counts, and the last bin all longer ones. Each histogram has a single
+  writer (an ISR or one task) and is read without locking; a reader may see
+  a sample counted in n but not yet in its bin.
+*/
+typedef struct zpec_hist_struct {
+  volatile unsigned long
+    n,                    /**< Number of samples. */
+    min,                  /**< Shortest sample (counts). */
+    max,                  /**< Longest  sample (counts). */
+    bin[ZPEC_HIST_BINS];  /**< Samples per bin. */
+} zpec_hist_t;
+
 /**
   Low-level I/O buffer pointers.
 
-  The ISR and frame readout buffers are swapped by ADC_isr() when a
-  complete frame (consisting of two fields of opposite phase) has been filled,
-  at which time AdcIsrSem is posted. This gives the waiting task a full frame
-  cycle for processing before the readout frame begins to get overwritten.
+  ADC_isr() fills frames (each consisting of two fields of opposite phase)
+  into a ring of adc_ring_len slots. When a frame is complete, the ISR
+  advances the producer index adc_head, posts AdcIsrSem, and fills the next
+  slot; the accumulating task processes slot adc_tail, then advances
+  adc_tail. Up to adc_ring_len-1 complete frames may wait, so the task may
+  stall for that many frame times. If the ring is full, the ISR drops the
+  completed frame instead, refilling its slot, and counts an overrun.
 */
 typedef struct global_io_struct {
   volatile int
@@ -200,16 +231,38 @@ typedef struct global_io_struct {
     first[4*512], /**< First-in-frame signal history bitset (recent frames). */
     frame[4*512]; /**< Frame signal history bitset (recent frames). */
 
+  int
+    adc_history;  /**< Whether ADC_isr() records first[] and frame[]. */
+
   volatile zpec_mode_t
     mode;       /**< Operating mode. */
 
   lag_count_t
-    *adc_full_begin, /**< Start of latest full ADC readout buffer. */
-    *adc_full_end,   /**< End   of latest full ADC readout buffer (last+1). */
+    *adc_ring_begin, /**< Start of frame ring. */
+    *adc_ring_end,   /**< End   of frame ring (last+1). */
     *adc_part_begin, /**< Start of current partial ADC_isr() buffer. */
-    *adc_part_end,   /**< End   of current partial ADC_isr() buffer (last+1).*/
+    *adc_part_end,   /**< End   of current partial ADC_isr() buffer, first
+			  band (last+1). */
     *adc_p;          /**< Write location of next ADC_isr() input sample. */
 
+  unsigned
+    adc_slot,        /**< Frame ring slot size (samples, all bands). */
+    adc_ring_len;    /**< Frame ring depth (slots). */
+
+  volatile unsigned
+    adc_head,        /**< Frames passed on by ADC_isr() (producer index). */
+    adc_tail,        /**< Frames processed by the accumulator (consumer). */
+    adc_overrun,     /**< Frames dropped with the ring full. */
+    adc_hiwater;     /**< Most complete frames waiting in the ring. */
+
+  unsigned long
+    adc_isr_t0;      /**< zpec_usclock() at the latest ADC_isr() entry. */
+
+  zpec_hist_t
+    adc_isr_period,  /**< Time between ADC_isr() entries. */
+    adc_isr_busy,    /**< Time spent in ADC_isr(). */
+    adc_proc;        /**< Time per Observation::processFrame() call. */
+
   OS_SEM
     AdcIsrSem;       /**< ADC_isr() completed frame notification channel. */
 
@@ -236,6 +289,13 @@ extern int cpld_init_corl_adc(unsigned short K, unsigned short M,
 
 extern void zpec_setup_mmap();
 extern void zpec_setup_watchdog();
+extern void zpec_setup_usclock();
+extern unsigned long zpec_usclock();
+
+extern void zpec_hist_clear(zpec_hist_t *h);
+extern void zpec_hist_add(zpec_hist_t *h, unsigned long counts);
+extern unsigned long zpec_hist_quantile(const zpec_hist_t *h,
+					unsigned percent);
 extern void zpec_setup_irq(unsigned irq, ep_trigger_t trigger,
 			   ep_direction_t direction, void (*isr)(void));
 extern void zpec_disable_irq(unsigned irq);
@@ -246,6 +306,10 @@ extern const char *zpec_mode_name(zpec_mode_t mode);
 /** ADC data interrupt service routine. */
 extern void ADC_isr(void);
 
+/** Interrupt service routine type. */
+typedef void zpec_isr_t(void);
+extern zpec_isr_t *zpec_adc_isr(zpec_mode_t mode, int history);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
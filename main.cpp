@@ -59,133 +59,229 @@ void startNetwork()
   StartHTTP();
 }
 
-/// Adds control functions to the command dictionary.
+/*
+  Command dictionaries, one per hardware variant, so that only those commands
+  meaningful for the particular variant are available. Each lists every
+  alias, including the commands common to all variants, and must be sorted in
+  strcmp() order (upper case before lower, telnet EOF strings last); see
+  CommandInterpreter::setTable().
+*/
+#define NCMDS(table) (sizeof(table)/sizeof(table[0]))
+
+/// GBT and RLT (Zpectrometer) commands.
+static const Correlator::shell_type::entry_type gbtCommands[] = {
+  {"",           &Correlator::execHelp},
+  {"\x04",       &Correlator::execQuit},  // ^D
+  {"?",          &Correlator::execHelp},
+  {"b",          &Correlator::execBoss},
+  {"boss",       &Correlator::execBoss},
+  {"d",          &Correlator::execDiodeObs},
+  {"dobs",       &Correlator::execDiodeObs},
+  {"e",          &Correlator::execMode},
+  {"eval",       &Correlator::execMode},
+  {"flash",      &Correlator::execFlash},
+  {"h",          &Correlator::execHelp},
+  {"halt",       &Correlator::execHalt},
+  {"help",       &Correlator::execHelp},
+  {"i",          &Correlator::execInitADCs},
+  {"initADCs",   &Correlator::execInitADCs},
+  {"jtiming",    &Correlator::execjTiming},
+  {"l",          &Correlator::execLevel},
+  {"level",      &Correlator::execLevel},
+  {"m",          &Correlator::execStatsObs},
+  {"master",     &Correlator::execBoss},
+  {"meanvar",    &Correlator::execStatsObs},
+  {"mode",       &Correlator::execMode},
+  {"o",          &Correlator::execScopeObs},
+  {"peek",       &Correlator::execPeek},
+  {"poke",       &Correlator::execPoke},
+  {"q",          &Correlator::execQuery},
+  {"query",      &Correlator::execQuery},
+  {"quit",       &Correlator::execQuit},
+  {"reboot",     &Correlator::execReboot},
+  {"ring",       &Correlator::execRing},
+  {"s",          &Correlator::execSend},
+  {"scope",      &Correlator::execScopeObs},
+  {"send",       &Correlator::execSend},
+  {"status",     &Correlator::execStatus},
+  {"sync",       &Correlator::execSync},
+  {"t",          &Correlator::execTotalPower},
+  {"time",       &Correlator::execTime},
+  {"totpwr",     &Correlator::execTotalPower},
+  {"v",          &Correlator::execVersion},
+  {"verbose",    &Correlator::execVerbose},
+  {"version",    &Correlator::execVersion},
+  {"z",          &Correlator::execZero},
+  {"zero",       &Correlator::execZero},
+  {"\xFF\x0C",   &Correlator::execQuit},  // Telnet ^D [#1]
+  {"\xFF\xEC",   &Correlator::execQuit},  // Telnet ^D [#2]
+};
+
+/// Power monitor commands.
+static const Correlator::shell_type::entry_type powCommands[] = {
+  {"",           &Correlator::execHelp},
+  {"\x04",       &Correlator::execQuit},  // ^D
+  {"?",          &Correlator::execHelp},
+  {"flash",      &Correlator::execFlash},
+  {"h",          &Correlator::execHelp},
+  {"help",       &Correlator::execHelp},
+  {"peek",       &Correlator::execPeek},
+  {"poke",       &Correlator::execPoke},
+  {"power",      &Correlator::execPower},
+  {"q",          &Correlator::execQuery},
+  {"query",      &Correlator::execQuery},
+  {"quit",       &Correlator::execQuit},
+  {"reboot",     &Correlator::execReboot},
+  {"status",     &Correlator::execStatus},
+  {"time",       &Correlator::execTime},
+  {"v",          &Correlator::execVersion},
+  {"verbose",    &Correlator::execVerbose},
+  {"version",    &Correlator::execVersion},
+  {"\xFF\x0C",   &Correlator::execQuit},  // Telnet ^D [#1]
+  {"\xFF\xEC",   &Correlator::execQuit},  // Telnet ^D [#2]
+};
+
+/// Argus (COMAP) commands; edited for comap, AH 2017-08-12, dcm2 2017-12-30, JSON 1018-02.
+static const Correlator::shell_type::entry_type argCommands[] = {
+  {"",           &Correlator::execHelp},
+  {"\x04",       &Correlator::execQuit},  // ^D
+  {"?",          &Correlator::execHelp},
+  {"a",          &Correlator::execCOMAPatten},
+  {"all",        &Correlator::execArgusSetAll},
+  {"batch",      &Correlator::execBatch},
+  {"c",          &Correlator::execArgusCryo},
+  {"cryo",       &Correlator::execArgusCryo},
+  {"d",          &Correlator::execArgusDrain},
+  {"dcm2",       &Correlator::execDCM2},
+  {"engr",       &Correlator::execArgusEngr},
+  {"flash",      &Correlator::execFlash},
+  {"freeze",     &Correlator::execArgusFreeze},
+  {"g",          &Correlator::execArgusGate},
+  {"h",          &Correlator::execHelp},
+  {"help",       &Correlator::execHelp},
+  {"ja",         &Correlator::execJCOMAPatten},
+  {"jall",       &Correlator::execJArgusSetAll},
+  {"jcryo",      &Correlator::execJCOMAPcryo},
+  {"jd",         &Correlator::execJArgusDrain},
+  {"jdcm2",      &Correlator::execJDCM2},
+  {"jfreeze",    &Correlator::execJArgusFreeze},
+  {"jg",         &Correlator::execJArgusGate},
+  {"jlimits",    &Correlator::execJArgusLimits},
+  {"jlna",       &Correlator::execJCOMAPlna},
+  {"jlnatest",   &Correlator::execJCOMAPlnaTestRet},
+  {"jlogp",      &Correlator::execJCOMAPlogp},
+  {"jp",         &Correlator::execJCOMAPpow},
+  {"jpresets",   &Correlator::execJCOMAPpresets},
+  {"jsbag",      &Correlator::execJSaddlebag},
+  {"jsets",      &Correlator::execJCOMAPsets},
+  {"jthaw",      &Correlator::execJArgusThaw},
+  {"jtime",      &Correlator::execjUpTime},
+  {"jtrace",     &Correlator::execJArgusTrace},
+  {"jvane",      &Correlator::execJVane},
+  {"jvanetraj",  &Correlator::execJVaneTraj},
+  {"limits",     &Correlator::execArgusLimits},
+  {"lna",        &Correlator::execArgusPwrCtrl},
+  {"mon",        &Correlator::execArgusMonPts},
+  {"p",          &Correlator::execCOMAPpow},
+  {"presets",    &Correlator::execCOMAPpresets},
+  {"quit",       &Correlator::execQuit},
+  {"reboot",     &Correlator::execReboot},
+  {"sbag",       &Correlator::execSaddlebag},
+  {"telem",      &Correlator::execTelem},
+  {"thaw",       &Correlator::execArgusThaw},
+  {"time",       &Correlator::execTime},
+  {"vane",       &Correlator::execVane},
+  {"verbose",    &Correlator::execVerbose},
+  {"\xFF\x0C",   &Correlator::execQuit},  // Telnet ^D [#1]
+  {"\xFF\xEC",   &Correlator::execQuit},  // Telnet ^D [#2]
+};
+
+/// Commands for unrecognized hardware variants.
+static const Correlator::shell_type::entry_type basicCommands[] = {
+  {"",           &Correlator::execHelp},
+  {"\x04",       &Correlator::execQuit},  // ^D
+  {"?",          &Correlator::execHelp},
+  {"flash",      &Correlator::execFlash},
+  {"h",          &Correlator::execHelp},
+  {"help",       &Correlator::execHelp},
+  {"peek",       &Correlator::execPeek},
+  {"poke",       &Correlator::execPoke},
+  {"q",          &Correlator::execQuery},
+  {"query",      &Correlator::execQuery},
+  {"quit",       &Correlator::execQuit},
+  {"reboot",     &Correlator::execReboot},
+  {"status",     &Correlator::execStatus},
+  {"time",       &Correlator::execTime},
+  {"v",          &Correlator::execVersion},
+  {"verbose",    &Correlator::execVerbose},
+  {"version",    &Correlator::execVersion},
+  {"\xFF\x0C",   &Correlator::execQuit},  // Telnet ^D [#1]
+  {"\xFF\xEC",   &Correlator::execQuit},  // Telnet ^D [#2]
+};
+
+
+/// Attaches the command dictionary for the hardware variant.
 void initCommandShell()
 {
-  /*
-     The hardware type is used to initialize only those commands which
-     are meaningful for the particular hardware variant.
-  */
   flash_t flashData;
   zpec_readFlash(&flashData);
   zpec_hw_t hw = (flashData.valid ? flashData.hw : ZPEC_HW_GBT);
+  bool sorted;
+
+  // Read-only queries (and halt, quit) that need not wait for queued
+  // requests.
+  ::zpectrometer.controlServer.setImmediate("halt");
+  ::zpectrometer.controlServer.setImmediate("jtime");
+  ::zpectrometer.controlServer.setImmediate("quit");
+  ::zpectrometer.controlServer.setImmediate("status");
+  ::zpectrometer.controlServer.setImmediate("time");
+  ::zpectrometer.controlServer.setImmediate("version");
 
   switch (hw) {
     case ZPEC_HW_GBT:
     case ZPEC_HW_RLT:
-      ::zpecShell["b"]         = &Correlator::execBoss;
-      ::zpecShell["boss"]      = &Correlator::execBoss;
-      ::zpecShell["master"]    = &Correlator::execBoss;
-
-      ::zpecShell["d"]         = &Correlator::execDiodeObs;
-      ::zpecShell["dobs"]      = &Correlator::execDiodeObs;
-
-      ::zpecShell["e"]         = &Correlator::execMode;
-      ::zpecShell["eval"]      = &Correlator::execMode;
-      ::zpecShell["mode"]      = &Correlator::execMode;
-
-      ::zpecShell["halt"]      = &Correlator::execHalt;
-
-      ::zpecShell["i"]         = &Correlator::execInitADCs;
-      ::zpecShell["initADCs"]  = &Correlator::execInitADCs;
-
-      ::zpecShell["l"]         = &Correlator::execLevel;
-      ::zpecShell["level"]     = &Correlator::execLevel;
-
-      ::zpecShell["m"]         = &Correlator::execStatsObs;
-      ::zpecShell["meanvar"]   = &Correlator::execStatsObs;
-
-      ::zpecShell["o"]         = &Correlator::execScopeObs;
-      ::zpecShell["scope"]     = &Correlator::execScopeObs;
-
-      ::zpecShell["s"]         = &Correlator::execSend;
-      ::zpecShell["send"]      = &Correlator::execSend;
+      sorted = ::zpecShell.setTable(gbtCommands, NCMDS(gbtCommands));
 
-      ::zpecShell["sync"]      = &Correlator::execSync;
-
-      ::zpecShell["t"]         = &Correlator::execTotalPower;
-      ::zpecShell["totpwr"]    = &Correlator::execTotalPower;
-
-      ::zpecShell["z"]         = &Correlator::execZero;
-      ::zpecShell["zero"]      = &Correlator::execZero;
+      // Long-running commands (and aliases), queued when given arguments.
+      ::zpectrometer.controlServer.setQueued("level");
+      ::zpectrometer.controlServer.setQueued("dobs");
+      ::zpectrometer.controlServer.setQueued("totpwr");
+      ::zpectrometer.controlServer.setQueued("zero");
       break;
 
     case ZPEC_HW_POW:
-      ::zpecShell["power"]     = &Correlator::execPower;
+      sorted = ::zpecShell.setTable(powCommands, NCMDS(powCommands));
       break;
 
-    case ZPEC_HW_ARG:    // edited for comap, AH 2017-08-12, dcm2 2017-12-30, JSON 1018-02
-      //::zpecShell["test"]      = &Correlator::execArgusTest;
-      //::zpecShell["init"]      = &Correlator::execArgusInit;
-      ::zpecShell["limits"]    = &Correlator::execArgusLimits;
-      ::zpecShell["jlimits"]   = &Correlator::execJArgusLimits;
-      ::zpecShell["all"]       = &Correlator::execArgusSetAll;
-      ::zpecShell["jall"]      = &Correlator::execJArgusSetAll;
-      ::zpecShell["g"]         = &Correlator::execArgusGate;
-      ::zpecShell["jg"]        = &Correlator::execJArgusGate;
-      ::zpecShell["d"]         = &Correlator::execArgusDrain;
-      ::zpecShell["jd"]        = &Correlator::execJArgusDrain;
-      ::zpecShell["a"]         = &Correlator::execCOMAPatten;
-      ::zpecShell["ja"]        = &Correlator::execJCOMAPatten;
-      ::zpecShell["lna"]       = &Correlator::execArgusPwrCtrl;
-      ::zpecShell["cryo"]      = &Correlator::execArgusCryo;
-      ::zpecShell["c"]         = &Correlator::execArgusCryo;
-      ::zpecShell["mon"]       = &Correlator::execArgusMonPts;
-      ::zpecShell["presets"]   = &Correlator::execCOMAPpresets;
-      ::zpecShell["jpresets"]  = &Correlator::execJCOMAPpresets;
-      ::zpecShell["engr"]      = &Correlator::execArgusEngr;
-      ::zpecShell["freeze"]    = &Correlator::execArgusFreeze;
-      ::zpecShell["jfreeze"]   = &Correlator::execJArgusFreeze;
-      ::zpecShell["thaw"]      = &Correlator::execArgusThaw;
-      ::zpecShell["jthaw"]     = &Correlator::execJArgusThaw;
-      ::zpecShell["jlna"]      = &Correlator::execJCOMAPlna;
-      ::zpecShell["jlnatest"]  = &Correlator::execJCOMAPlnaTestRet;
-      ::zpecShell["jsets"]     = &Correlator::execJCOMAPsets;
-      ::zpecShell["jcryo"]     = &Correlator::execJCOMAPcryo;
-      ::zpecShell["dcm2"]      = &Correlator::execDCM2;
-      ::zpecShell["jdcm2"]     = &Correlator::execJDCM2;
-      ::zpecShell["sbag"]      = &Correlator::execSaddlebag;
-      ::zpecShell["jsbag"]     = &Correlator::execJSaddlebag;
-      ::zpecShell["jtime"]     = &Correlator::execjUpTime;
-      ::zpecShell["p"]         = &Correlator::execCOMAPpow;
-      ::zpecShell["jp"]        = &Correlator::execJCOMAPpow;
-      ::zpecShell["jlogp"]     = &Correlator::execJCOMAPlogp;
+    case ZPEC_HW_ARG:
+      sorted = ::zpecShell.setTable(argCommands, NCMDS(argCommands));
+
+      // Long-running commands (and aliases), queued when given arguments.
+      ::zpectrometer.controlServer.setQueued("lna");
+      ::zpectrometer.controlServer.setQueued("all");
+      ::zpectrometer.controlServer.setQueued("jall");
+      ::zpectrometer.controlServer.setQueued("presets");
+      ::zpectrometer.controlServer.setQueued("jpresets");
+      ::zpectrometer.controlServer.setQueued("dcm2");
+
+      // Monitor queries; the snapshot-backed JSON ones stream their output.
+      ::zpectrometer.controlServer.setImmediate("jcryo", true);
+      ::zpectrometer.controlServer.setImmediate("jdcm2", true);
+      ::zpectrometer.controlServer.setImmediate("jlna", true);
+      ::zpectrometer.controlServer.setImmediate("jsbag", true);
+      ::zpectrometer.controlServer.setImmediate("jsets", true);
+      ::zpectrometer.controlServer.setImmediate("mon");
       break;
 
     default:
+      sorted = ::zpecShell.setTable(basicCommands, NCMDS(basicCommands));
       break;
   }
 
-  // The following commands are available on all hardware variants.
-  ::zpecShell["flash"]     = &Correlator::execFlash;
-
-  ::zpecShell[""]          = &Correlator::execHelp;
-  ::zpecShell["?"]         = &Correlator::execHelp;
-  ::zpecShell["h"]         = &Correlator::execHelp;
-  ::zpecShell["help"]      = &Correlator::execHelp;
-
-  if (hw != ZPEC_HW_ARG) {
-    ::zpecShell["peek"]      = &Correlator::execPeek;
-    ::zpecShell["poke"]      = &Correlator::execPoke;
-
-    ::zpecShell["q"]         = &Correlator::execQuery;
-    ::zpecShell["query"]     = &Correlator::execQuery;
-
-    ::zpecShell["status"]    = &Correlator::execStatus;
-
-    ::zpecShell["v"]         = &Correlator::execVersion;
-    ::zpecShell["version"]   = &Correlator::execVersion;
+  if (!sorted) {
+    zpec_error("initCommandShell: command table for hardware %d is not sorted",
+	       hw);
   }
-
-  ::zpecShell["\x04"]      = &Correlator::execQuit;  // ^D
-  ::zpecShell["\xFF\x0C"]  = &Correlator::execQuit;  // Telnet ^D [#1]
-  ::zpecShell["\xFF\xEC"]  = &Correlator::execQuit;  // Telnet ^D [#2]
-  ::zpecShell["quit"]      = &Correlator::execQuit;
-
-  ::zpecShell["reboot"]    = &Correlator::execReboot;
-
-  ::zpecShell["time"]      = &Correlator::execTime;
-  ::zpecShell["verbose"]   = &Correlator::execVerbose;
 }
 
 extern "C" {
@@ -18,17 +18,69 @@
 #include "control.h"
 
 
+/**
+  Starts the acquisition task, which accumulates ADC data for readADCs() at
+  ZPEC_ADC_PRIO. Until then, and if the task cannot be created, integrations
+  run in the calling task, raised to that priority.
+*/
+void Correlator::startAcquisition()
+{
+  static const char *fn = "startAcquisition";
+
+  OSSemInit(&acqStart_, 0);
+  OSSemInit(&acqDone_, 0);
+
+  if (OSTaskCreate(acqTask, (void *)this,
+		   (void *)&acqStack_[USER_TASK_STK_SIZE],
+		   (void *)&acqStack_[0], ZPEC_ADC_PRIO) == OS_NO_ERR) {
+    acqReady_ = true;
+    zpec_info("Acquisition task initialized, priority = %d", ZPEC_ADC_PRIO);
+  } else {
+    zpec_error_fn("Acquisition task priority (%d) unavailable", ZPEC_ADC_PRIO);
+  }
+}
+
+/**
+  Acquisition task. Runs each job posted by readADCs(), then signals its
+  completion.
+
+  \param vcorr Correlator instance cast to a void pointer.
+*/
+void Correlator::acqTask(void *vcorr)
+{
+  Correlator *corr = (Correlator *)vcorr;
+
+  while (1) {
+    OSSemPend(&corr->acqStart_, 0);
+    corr->accumulate(corr->acqJob_);
+    OSSemPost(&corr->acqDone_);
+  }
+}
+
 /**
   Accumulates ADC data.
 
-  This method enables ADC data interrupts and processes frames until the
-  desired number of frames is collected, or any new user input (such as ^C)
-  is detected. Data interrupts are then disabled.  Frames consist of two
-  halves (fields), with phase switched between them. The second field is
-  subtracted from the first to generate the net lag counts.
+  This method has the acquisition task enable ADC data interrupts and process
+  frames until the desired number of frames is collected, the integration is
+  halted, or any new user input (such as ^C) is detected. Data interrupts are
+  then disabled. Frames consist of two halves (fields), with phase switched
+  between them. The second field is subtracted from the first to generate the
+  net lag counts.
+
+  The caller waits for the integration to complete; other tasks may follow
+  its progress (cf. execStatus()) and halt it (cf. execHalt()). Only one
+  integration runs at a time; callers obtain exclusive access with
+  setAccumulating().
+
+  Repeated integrations run back to back, alternating between \a obs and a
+  second accumulator: while one accumulates, the calling task collates the
+  other and writes its status (cf. publishIntegration()). On return, \a obs
+  holds the last integration.
 
   \warning
-  Only observations compatible with BasicObservation are repeatable.
+  Only observations compatible with BasicObservation are repeatable, and
+  \a nFrames must be a multiple of its number of buffers, so that each
+  integration starts on the same switch phase.
 
   \param obs     Observation object for processing frames.
   \param nFrames Number of ADC frames to accumulate.
@@ -42,17 +94,109 @@ unsigned Correlator::readADCs(Observation *obs, unsigned nFrames,
   argument_type& arg, return_type status, unsigned nRepeat)
 {
   static const char *fn = "readADCs";
-  unsigned iRepeat, irq, nAccum, nTicks;
+
+  acqJob_.obs         = obs;
+  acqJob_.nFrames     = nFrames;
+  acqJob_.nRepeat     = nRepeat;
+  acqJob_.iRepeat     = 0;
+  acqJob_.nAccum      = 0;
+  acqJob_.fdRead      = arg.fdRead;
+  acqJob_.fdWrite     = arg.fdWrite;
+  acqJob_.status      = status;
+  acqJob_.spare       = 0;
+  acqJob_.phaseLost   = false;
+
+  OSSemInit(&acqSwap_, 0);
+  OSSemInit(&acqFree_, 1);
+  if (nRepeat > 1) {
+    BasicObservation *bobs = static_cast<BasicObservation *>(obs);
+    acqSpare_.init(bobs->getMode(), bobs->nLags(), bobs->nBuffers());
+    acqJob_.spare = &acqSpare_;
+  }
+
+  if (!acqReady_) {
+    // The caller may be the control task, one of its servers, or the
+    // command queue worker; restore its own priority afterwards.
+    BYTE prio = ((OS_TCB *)OSTCBCur)->OSTCBPrio;
+    if (zpec_change_prio(ZPEC_ADC_PRIO) != OS_NO_ERR) {
+      zpec_warn_fn("Could not raise task priority");
+    }
+    unsigned nAccum = accumulate(acqJob_);
+    zpec_change_prio(prio);
+    return nAccum;
+  }
+
+  // Publish completed integrations and watch for user input while the
+  // acquisition task integrates.
+  acqJob_.fdRead = -1;
+  OSSemPost(&acqStart_);
+  while (OSSemPendNoWait(&acqDone_) != OS_NO_ERR) {
+    if (OSSemPend(&acqSwap_, 1) == OS_NO_ERR) {
+      publishIntegration(acqJob_);
+    }
+    if (!acqJob_.interrupted && zpec_interrupt(arg.fdRead)) {
+      acqJob_.interrupted = true;
+    }
+  }
+
+  return acqJob_.nAccum;
+}
+
+/**
+  Publishes an intermediate integration of a repeated observation.
+
+  Collates the completed accumulator (job.spare) and writes its status to
+  the client, then clears it for reuse by accumulate(), which meanwhile
+  accumulates the next integration.
+
+  \param job Accumulation job.
+*/
+void Correlator::publishIntegration(AcqJob& job)
+{
+  static const char *fn = "publishIntegration";
+  BasicObservation *bobs = job.spare;
+
+  collateData(bobs->lagData(), bobs->nBuffers());
+
+  // Without a client descriptor, the data server only.
+  if (job.fdWrite >= 0) {
+    unsigned len = setIntegStatus(job.status, job.nFrames, job.nFrames, false);
+    len += siprintf(job.status+len, "%s", ControlService::prompt);
+    zpec_write_retry(job.fdWrite, job.status, len, fn);
+  }
+
+  bobs->init(bobs->getMode(), bobs->nLags(), bobs->nBuffers());
+  OSSemPost(&acqFree_);
+}
+
+/**
+  Runs an ADC accumulation job; see readADCs().
+
+  \param job Accumulation job.
+
+  \return Number of frames accumulated (processed) in the last integration.
+*/
+unsigned Correlator::accumulate(AcqJob& job)
+{
+  static const char *fn = "accumulate";
+  Observation *obs = job.obs;
+  unsigned nFrames = job.nFrames, nRepeat = job.nRepeat, iRepeat, irq, nTicks;
+  unsigned nTotal = 0;
 
   // Buffers initialized only once per call.
   adcBuffer_.assign(adcBuffer_.size(), 0);
   memset(io_->first, 0, sizeof(io_->first));
   memset(io_->frame, 0, sizeof(io_->frame));
-  nAccum = 0;
-
-  if (zpec_change_prio(ZPEC_ADC_PRIO) != OS_NO_ERR) {
-    zpec_warn_fn("Could not raise task priority");
-  }
+  job.nAccum = 0;
+  io_->adc_slot       = nBands()*nLags();
+  io_->adc_ring_len   = adcRing_;
+  io_->adc_ring_begin = &adcBuffer_[0];
+  io_->adc_ring_end   = io_->adc_ring_begin + adcRing_*io_->adc_slot;
+  io_->adc_overrun    = 0;
+  io_->adc_hiwater    = 0;
+  zpec_hist_clear(&io_->adc_isr_period);
+  zpec_hist_clear(&io_->adc_isr_busy);
+  zpec_hist_clear(&io_->adc_proc);
 
   while (OSSemPendNoWait(&io_->AdcIsrSem) == OS_NO_ERR) {
     zpec_info_fn("Cleared one pending ADC semaphore");
@@ -70,73 +214,106 @@ unsigned Correlator::readADCs(Observation *obs, unsigned nFrames,
             irq, nTicks/TICKS_PER_SECOND,
 	    (nTicks % TICKS_PER_SECOND)*(100/TICKS_PER_SECOND));
 
-  for (iRepeat = 0; iRepeat < nRepeat && isAccumulating(); iRepeat++) {
-    io_->adc_part_begin = &adcBuffer_[0];
-    io_->adc_part_end   = io_->adc_part_begin + nLags();
-    io_->adc_full_begin = io_->adc_part_end;
-    io_->adc_full_end   = io_->adc_full_begin + nLags();
-    io_->adc_calls      = 0;
-    io_->adc_count      = 0;
-    io_->adc_field      = 0;
-    io_->err_first      = 0;
-    io_->err_frame      = 0;
-    io_->err_mode       = 0;
-    io_->mode           = obs->getMode();
-
-    if (iRepeat == 0) { nTicks = ::TimeTick; }
-    zpec_setup_irq(irq, EP_FALLING_EDGE, EP_INPUT_PIN, ADC_isr);
-    cpld_set_bit(CPLD_BLANK, 0);
-    zpec_enable_irq(irq);
-      for (nAccum=0; nAccum < nFrames && isAccumulating(); ) {
+  io_->adc_part_begin = io_->adc_ring_begin;
+  io_->adc_part_end   = io_->adc_part_begin + nLags();
+  io_->adc_head       = 0;
+  io_->adc_tail       = 0;
+  io_->adc_calls      = 0;
+  io_->adc_count      = 0;
+  io_->adc_field      = 0;
+  io_->err_first      = 0;
+  io_->err_frame      = 0;
+  io_->err_mode       = 0;
+  io_->mode           = obs->getMode();
+
+  // Repeated integrations run back to back: the IRQ stays enabled, and the
+  // frame after the last one of an integration starts the next.
+  zpec_setup_irq(irq, EP_FALLING_EDGE, EP_INPUT_PIN,
+		 zpec_adc_isr(io_->mode, io_->adc_history));
+  cpld_set_bit(CPLD_BLANK, 0);
+  zpec_enable_irq(irq);
+    for (iRepeat = 0; iRepeat < nRepeat && !job.interrupted; ) {
+      job.iRepeat = iRepeat;
+      for (job.nAccum=0; job.nAccum < nFrames && !job.interrupted; ) {
 	if (OSSemPend(&io_->AdcIsrSem, 1) == OS_NO_ERR) {
-	  obs->processFrame(io_->adc_full_begin, io_->adc_full_end);
-	  ++nAccum;
-	} else if (zpec_interrupt(arg.fdRead)) {
-	  iRepeat = nRepeat - 1;
+	  const lag_count_t *slot = io_->adc_ring_begin +
+	    (io_->adc_tail % adcRing_)*io_->adc_slot;
+	  unsigned long t0 = zpec_usclock();
+	  job.obs->processFrame(slot, slot + io_->adc_slot);
+	  zpec_hist_add(&io_->adc_proc, zpec_usclock() - t0);
+	  ++io_->adc_tail;
+	  ++job.nAccum;
+	  ++nTotal;
+	} else if (job.interrupted || zpec_interrupt(job.fdRead)) {
 	  break;
 	}
       }
-    zpec_disable_irq(irq);
-    cpld_set_bit(CPLD_BLANK, 1);
-    if (iRepeat == nRepeat-1) { nTicks = ::TimeTick - nTicks; }
-
-    if (nAccum < nFrames) {
-      zpec_warn_fn("Integration terminated early (accumulated %u of %u frames)",
-		   nAccum, nFrames);
-    }
-    if (OSSemPendNoWait(&io_->AdcIsrSem) == OS_NO_ERR) {
-      zpec_error_fn("Data integrity failure: readout frame already pending");
-    }
-    if (io_->err_first) {
-      zpec_error_fn("Data integrity failure: ISR first-in-frame error");
-    }
-    if (io_->err_frame) {
-      zpec_error_fn("Data integrity failure: ISR framing error");
-    }
-    if (io_->err_mode) {
-      zpec_error_fn("Data integrity failure: ISR operating mode error");
+      if (job.nAccum < nFrames) { break; }
+
+      // Swap accumulators; the completed one is published while the next
+      // integration accumulates (cf. publishIntegration()).
+      if (++iRepeat < nRepeat && !job.interrupted) {
+	OSSemPend(&acqFree_, 0);
+	BasicObservation *done = static_cast<BasicObservation *>(job.obs);
+	job.obs   = job.spare;
+	job.spare = done;
+	if (acqReady_) {
+	  OSSemPost(&acqSwap_);
+	} else {
+	  publishIntegration(job);
+	}
+      }
     }
-
-    nFrames = io_->adc_field >> 1;
-    if (nAccum != nFrames) {
-      zpec_error_fn("Data integrity failure: readout frame count mismatch "
-		    "(%u processed, %u posted)", nAccum, nFrames);
+  zpec_disable_irq(irq);
+  cpld_set_bit(CPLD_BLANK, 1);
+  nTicks = ::TimeTick - nTicks;
+
+  // Return the last integration in the caller's observation.
+  if (job.spare) {
+    OSSemPend(&acqFree_, 0);  // Last publication complete.
+    if (job.obs != obs) {
+      *static_cast<BasicObservation *>(obs) =
+	*static_cast<BasicObservation *>(job.obs);
+      job.spare = static_cast<BasicObservation *>(job.obs);
+      job.obs   = obs;
     }
+  }
 
-    // Process and publish intermediate integrations ASAP.
-    if (iRepeat != nRepeat-1 && isAccumulating()) {
-      // Repeating observations must be compatible with BasicObservation.
-      BasicObservation *bobs = static_cast<BasicObservation *>(obs);
-      collateData(bobs->lagData(), bobs->nBuffers());
-      bobs->init(bobs->getMode(), bobs->nLags(), bobs->nBuffers());
+  if (job.nAccum < nFrames) {
+    zpec_warn_fn("Integration terminated early (accumulated %u of %u frames)",
+		 job.nAccum, nFrames);
+  }
+  if (OSSemPendNoWait(&io_->AdcIsrSem) == OS_NO_ERR) {
+    zpec_error_fn("Data integrity failure: readout frame already pending");
+    while (OSSemPendNoWait(&io_->AdcIsrSem) == OS_NO_ERR) ;  // Stale slots.
+  }
+  if (io_->err_first) {
+    zpec_error_fn("Data integrity failure: ISR first-in-frame error");
+  }
+  if (io_->err_frame) {
+    zpec_error_fn("Data integrity failure: ISR framing error");
+  }
+  if (io_->err_mode) {
+    zpec_error_fn("Data integrity failure: ISR operating mode error");
+  }
 
-      unsigned len = setIntegStatus(status, nAccum, nFrames, false);
-      len += siprintf(status+len, "%s", ControlService::prompt);
-      zpec_write_retry(arg.fdWrite, status, len, fn);
-    }
+  // A dropped frame shifts the switch phase of every frame that follows.
+  if (io_->adc_overrun && obs->nPhases() > 1) {
+    job.phaseLost = true;
+    zpec_error_fn("Data integrity failure: frame ring overrun, %u frames "
+		  "dropped (%u slots); switch phases lost",
+		  io_->adc_overrun, adcRing_);
+  } else if (io_->adc_overrun) {
+    zpec_warn_fn("Frame ring overrun: %u frames dropped (%u slots)",
+		 io_->adc_overrun, adcRing_);
   }
 
-  zpec_change_prio(ZPEC_CONTROL_PRIO);
+  // Frames dropped while the ring was full were never posted.
+  unsigned nPosted = io_->adc_head;
+  if (nTotal != nPosted) {
+    zpec_error_fn("Data integrity failure: readout frame count mismatch "
+		  "(%u processed, %u posted)", nTotal, nPosted);
+  }
 
   zpec_info("IRQ%d disabled at boot time %u.%02u s (used %u of %u interrupts)"
             "\r\nElapsed time: %u.%02u s for %u frames",
@@ -145,9 +322,9 @@ unsigned Correlator::readADCs(Observation *obs, unsigned nFrames,
 	     io_->adc_count, io_->adc_calls,
              nTicks/TICKS_PER_SECOND,
 	     (nTicks % TICKS_PER_SECOND)*(100/TICKS_PER_SECOND),
-	     nAccum*nRepeat);
+	     nTotal);
 
-  return nAccum;
+  return job.nAccum;
 }
 
 
@@ -204,8 +381,13 @@ unsigned Correlator::setIntegStatus(return_type status, unsigned nAccum,
 {
   unsigned len = 0;
 
-  if (io_->err_first || io_->err_frame || io_->err_mode) {
+  if (io_->err_first || io_->err_frame || io_->err_mode || acqJob_.phaseLost) {
     len += siprintf(status+len, "%s", statusERR);
+    if (acqJob_.phaseLost) {
+      len += siprintf(status+len,
+		      "Frame ring overrun: %u frames dropped, switch phases "
+		      "lost\r\n  ", io_->adc_overrun);
+    }
     if (io_->err_mode) {
       len += siprintf(status+len, "ISR: operating mode error (mode = %d)\r\n  ",
                       static_cast<int>(getMode()));
@@ -229,7 +411,7 @@ unsigned Correlator::setIntegStatus(return_type status, unsigned nAccum,
 		  nAccum < nFrames ? "halted" : "complete",
 		  timestamp(), nAccum);
 
-  if (checkFraming && getMode() != MODE_DEVKIT) {
+  if (checkFraming && io_->adc_history && getMode() != MODE_DEVKIT) {
     /*
        Diagnose framing errors by displaying anomalous frames.
        Expected pattern for 128 channels per field (2 fields per frame),
@@ -266,6 +448,43 @@ unsigned Correlator::setIntegStatus(return_type status, unsigned nAccum,
 }
 
 
+/**
+  \brief Sets ADC readout timing status.
+
+  Summarizes the ISR and frame processing timing histograms of the current
+  or latest integration.
+
+  \param status Storage buffer for return status.
+
+  \return The number of characters written to status.
+*/
+unsigned Correlator::setTimingStatus(return_type status)
+{
+  static const char *name[] = {
+    "ISR entry period:", "ISR duration:", "Frame processing:"
+  };
+  const zpec_hist_t *hist[] = {
+    &io_->adc_isr_period, &io_->adc_isr_busy, &io_->adc_proc
+  };
+  unsigned len = 0;
+
+  for (unsigned i=0; i<sizeof(hist)/sizeof(hist[0]); i++) {
+    const zpec_hist_t *h = hist[i];
+    if (h->n == 0) {
+      len += siprintf(status+len, "  %-22s no samples\r\n", name[i]);
+    } else {
+      len += siprintf(status+len, "  %-22s %lu samples, min %lu us, "
+		      "99%% <= %lu us, max %lu us\r\n", name[i], h->n,
+		      ZPEC_USCLOCK_US(h->min),
+		      ZPEC_USCLOCK_US(zpec_hist_quantile(h, 99)),
+		      ZPEC_USCLOCK_US(h->max));
+    }
+  }
+
+  return len;
+}
+
+
 /**
   \brief Performs a total power integration.
 
@@ -758,7 +977,8 @@ void Correlator::execDiodeObs(return_type status, argument_type arg)
   "NFRAMES [REPEAT]\r\n"
   "  Perform a switching noise diode integration.\r\n"
   "  NFRAMES Number of ADC readout frames to accumulate (*total*).\r\n"
-  "  REPEAT  Number of integrations to perform (default: 1).\r\n";
+  "  REPEAT  Number of integrations to perform (default: 1); to repeat,\r\n"
+  "          NFRAMES must be even.\r\n";
 
   const unsigned nStates = 2;
   unsigned nFrames, nRepeat;
@@ -775,6 +995,12 @@ void Correlator::execDiodeObs(return_type status, argument_type arg)
   }
   nRepeat = 1;
   sscanf(arg.str, "%*u%u", &nRepeat);
+  if (nRepeat > 1 && nFrames % nStates) {
+    setAccumulating(false);
+    siprintf(status, "%sNFRAMES must be a multiple of %u to repeat.\r\n",
+	     statusERR, nStates);
+    return;
+  }
 
   // At this point, we have exclusive ADC readout access.
   static BasicObservation obs;
@@ -35,6 +35,9 @@ public:
   virtual void processFrame(const lag_count_t *begin,
                             const lag_count_t *end) = 0;
 
+  /// Number of switch phases frames alternate between, by frame count.
+  virtual unsigned nPhases() const { return 1; }
+
 private:
   zpec_mode_t mode_;  ///< Hardware operating mode.
 };
@@ -87,6 +90,8 @@ public:
   virtual void processFrame(const lag_count_t *begin,
                             const lag_count_t *end);
 
+  virtual unsigned nPhases() const { return nBuffers_; }
+
 private:
   LagData lagBuffer_;   ///< The lag accumulation buffer.
   unsigned nBuffers_,   ///< Number of accumulation buffers.
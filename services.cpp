@@ -16,13 +16,19 @@
 */
 #include <predef.h> 
 
+#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <iosys.h>
 #include <startnet.h>
 #include <tcp.h>
 #include <udp.h>
 
+#include <new>
+#include <string>
+
+#include "argus.h"
 #include "control.h"
 #include "services.h"
 #include "zpec.h"
@@ -32,19 +38,23 @@ const char *ControlService::prompt  = "uC> ";
 const char *DataService::dataName   = "Data";
 const char *MonitorService::monName = "Monitor";
 const char *MessageService::msgName = "Message";
+const char *TelemetryService::telemName = "Telemetry";
 
 
 /**
-  Reads a line of input one character at a time. Erase processing is performed.
+  Reads a line of input one character at a time from the client's input
+  buffer. Erase processing is performed. Remaining input stays buffered for
+  the next call (cf. TcpClient::buffered()).
 
   \param line    Input buffer.
   \param size    Buffer length.
-  \param fd      Input file descriptor.
+  \param client  Input client.
   \param noBlank Whether to return blank lines.
 
   \return The number of characters read, else a system error code.
 */
-int Service::readLine(char *line, unsigned size, int fd, bool noBlank)
+int Service::readLine(char *line, unsigned size, TcpClient *client,
+                      bool noBlank)
 {
   unsigned nTot;
   int nRead;
@@ -52,31 +62,50 @@ int Service::readLine(char *line, unsigned size, int fd, bool noBlank)
 
   nTot = 0;
   do {
-    nRead = read(fd, &input, 1);
-    if (nRead == 1) {
-      if (input == '\b') {  // Erase processing.
-        if (nTot > 0) { --nTot; }
-      } else if (input == ';') { input = '\n'; }
-      line[nTot++] = input;
-      line[nTot] = '\0';  // Terminate now for strcmp() calls below.
-
-      // End of line or end of input reached?
-      // Recognized EOF strings are: "\x04", "\xFF\x0C", "\xFF\xEC".
-      if (nTot == size-1 || strchr("\n\x04", input) ||
-          (nTot >= 2 && (!strcmp(line+nTot-2, "\xFF\x0C") ||
-	                 !strcmp(line+nTot-2, "\xFF\xEC")))) {
-	if (strspn(line, " \t") == nTot && noBlank) {
-	  nTot = 0;  // Ignore blank lines.
-	} else {
-	  return (int )nTot;  // Return line.
-	}
-      }
+    nRead = client->getChar(&input);
+    if (nRead == 1 && addChar(line, size, nTot, input, noBlank)) {
+      return (int )nTot;  // Return line.
     }
   } while (nRead == 1);
 
   return nRead;
 }
 
+/**
+  Appends one input character to a line. Erase processing is performed, and
+  blank lines are discarded if requested.
+
+  \param line    Input buffer.
+  \param size    Buffer length.
+  \param nTot    Number of characters in the line (updated).
+  \param input   Input character.
+  \param noBlank Whether to discard blank lines.
+
+  \return Whether the line is complete.
+*/
+bool Service::addChar(char *line, unsigned size, unsigned& nTot, char input,
+                      bool noBlank)
+{
+  if (input == '\b') {  // Erase processing.
+    if (nTot > 0) { --nTot; }
+  } else if (input == ';') { input = '\n'; }
+  line[nTot++] = input;
+  line[nTot] = '\0';  // Terminate now for strcmp() calls below.
+
+  // End of line or end of input reached?
+  // Recognized EOF strings are: "\x04", "\xFF\x0C", "\xFF\xEC".
+  if (nTot == size-1 || strchr("\n\x04", input) ||
+      (nTot >= 2 && (!strcmp(line+nTot-2, "\xFF\x0C") ||
+		     !strcmp(line+nTot-2, "\xFF\xEC")))) {
+    if (strspn(line, " \t") == nTot && noBlank) {
+      nTot = 0;  // Ignore blank lines.
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
 
 /**
   \param client Pointer to client to activate.
@@ -89,7 +118,7 @@ int Service::openClient(Client *client)
   int status = OS_NO_ERR;
 
   lock();
-    if (nClients_ == maxClients) {
+    if (nClients_ == clientLimit_) {
       zpec_warn_fn("%s: client limit exceeded", tag_);
       status = -1;
     } else {
@@ -98,7 +127,7 @@ int Service::openClient(Client *client)
       // Find first free index number.
       for (unsigned aset=isActive_; aset&1; aset>>=1, ++id) ;
 
-      if (id >= maxClients) {
+      if (id >= clientLimit_) {
 	zpec_error_fn("%s: inconsistent member data", tag_);
 	status = -1;
       } else {
@@ -119,7 +148,18 @@ int Service::openClient(Client *client)
 */
 void Service::closeClient(Client *client)
 {
-  static const char *fn = "Service::closeClient";
+  if (releaseClient(client)) { delete client; }
+}
+
+/**
+  \param client Pointer to client to deactivate.
+
+  \return Whether the client was active.
+*/
+bool Service::releaseClient(Client *client)
+{
+  static const char *fn = "Service::releaseClient";
+  bool active = false;
  
   lock();
     if (nClients_ == 0) {
@@ -129,9 +169,11 @@ void Service::closeClient(Client *client)
       --nClients_;
       isActive_ &= ~(1U << client->myId());  // Mark index as free.
       client->myService() = 0;
-      delete client;
+      active = true;
     }
   unlock();
+
+  return active;
 }
 
 /**
@@ -179,7 +221,10 @@ void Service::serviceTask(void *vsvc)
 /**
   Spawns a server task (at the next lowest available priority below the
   service task) to handle a new client. No server task with priority higher
-  than the ADC readout task will be created.
+  than ZPEC_SERVER_PRIO_MIN will be created, leaving the reserved band and
+  the ADC readout and I2C bus priorities to their tasks (see zpec.h). Stack space for each client slot
+  is allocated when the slot is first used, and kept for reuse. On failure,
+  the client is detached again (but not deleted).
 
   \param client Client the new server will handle.
 
@@ -188,11 +233,23 @@ void Service::serviceTask(void *vsvc)
 */
 int Service::createServer(Client *client)
 {
+  static const char *fn = "Service::createServer";
+
   if (openClient(client) == OS_NO_ERR) {
     int iClient = client->myId();
     BYTE prio = prio_, status = OS_PRIO_EXIST;
 
-    for (prio = prio_-1; prio>ZPEC_ADC_PRIO && status==OS_PRIO_EXIST; --prio) {
+    if (!serverStack_[iClient]) {
+      serverStack_[iClient] = new (std::nothrow) DWORD[serverStackSize];
+    }
+    if (!serverStack_[iClient]) {
+      zpec_error_fn("%s: no memory for client %d stack", tag_, iClient);
+      releaseClient(client);
+      return -1;
+    }
+
+    for (prio = prio_-1; prio>=ZPEC_SERVER_PRIO_MIN && status==OS_PRIO_EXIST;
+	 --prio) {
       status = OSTaskCreate(serverTask, (void *)client,
 			    (void *)&serverStack_[iClient][serverStackSize],
 			    (void *)&serverStack_[iClient][0], prio);
@@ -200,6 +257,7 @@ int Service::createServer(Client *client)
 	zpec_info("%s: client %d priority is %d", tag_, iClient, prio);
       }
     }
+    if (status != OS_NO_ERR) { releaseClient(client); }
     return status;
   } else {
     return -1;
@@ -229,7 +287,8 @@ void Service::serverTask(void *vclient)
 /**
   Main TCP service routine. Listens for new incoming connections and
   connection. The connection is rejected if the client limit has been reached,
-  or if no server task could be created.
+  or if no server task could be created. Multiplexed services serve their
+  clients from here; see offerMultiplexed().
 */
 void TcpService::offerService()
 {
@@ -241,6 +300,7 @@ void TcpService::offerService()
 
   if (fdListen_ >= 0) {
     zpec_info("%s: listening..", getTag(), getPort());
+    if (mux_) { offerMultiplexed(); }
 
     while (1) {
       TcpClient *client = new TcpClient;
@@ -277,6 +337,144 @@ void TcpService::offerService()
 }
 
 
+/**
+  Multiplexed TCP service routine. Waits in select() for connection requests
+  and client input, giving newly read input to handleInput(), and calls
+  pollClient() for each client before each wait. A client with queued
+  output is instead waited on to become writable, and sent what its socket
+  accepts. Clients are disconnected on socket error, end of input, or output
+  queue overflow, or at the request of handleInput(). Never returns.
+*/
+void TcpService::offerMultiplexed()
+{
+  static const char *fn = "TcpService::offerMultiplexed";
+  TcpClient *clients[maxMuxClients];  // Active clients, by id.
+  char ipstr[16];
+
+  for (unsigned i=0; i<maxMuxClients; ++i) { clients[i] = 0; }
+
+  while (1) {
+    fd_set readSet, writeSet, errorSet;
+    DWORD wait = 0;  // Ticks until the next poll; 0 waits for input.
+
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    FD_ZERO(&errorSet);
+    FD_SET(fdListen_, &readSet);
+    for (unsigned i=0; i<maxMuxClients; ++i) {
+      if (clients[i]) {
+	if (!clients[i]->queued()) {
+	  DWORD ticks = pollClient(clients[i]);
+	  if (ticks && (wait == 0 || ticks < wait)) { wait = ticks; }
+	}
+	if (clients[i]->queued()) { FD_SET(clients[i]->fd, &writeSet); }
+	else                      { FD_SET(clients[i]->fd, &readSet); }
+	FD_SET(clients[i]->fd, &errorSet);
+      }
+    }
+
+    if (select(FD_SETSIZE, &readSet, &writeSet, &errorSet, wait) <= 0) {
+      continue;
+    }
+
+    // Service clients first, so that a closing client frees its slot.
+    for (unsigned i=0; i<maxMuxClients; ++i) {
+      TcpClient *client = clients[i];
+      if (!client) { continue; }
+
+      int nRead = 1;
+      if (FD_ISSET(client->fd, &errorSet)) {
+	nRead = -1;
+      } else if (FD_ISSET(client->fd, &writeSet)) {
+	nRead = client->flush();
+      } else if (FD_ISSET(client->fd, &readSet)) {
+	nRead = client->fill();
+	if (nRead > 0 && !handleInput(client)) { nRead = 0; }
+      }
+      if (client->overflowed()) {
+	zpec_warn_fn("%s: client %d output queue overflow", getTag(),
+		     client->myId());
+	nRead = -1;
+      }
+
+      if (nRead <= 0) {
+	zpec_info("%s: client %d input returned %d, closing connection",
+		  getTag(), client->myId(), nRead);
+	closeConnection(client);
+	close(client->fd);
+	clients[i] = 0;
+	closeClient(client);
+      }
+    }
+
+    if (FD_ISSET(fdListen_, &readSet)) {
+      TcpClient *client = new TcpClient;
+
+      client->fd = accept(fdListen_, &client->ip, &client->port, 1);
+      (void )zpec_iptostr(ipstr, client->ip);
+      zpec_info("%s: connection request from %s", getTag(), ipstr);
+
+      if (client->fd < 0) {
+	zpec_warn_fn("%s: accept() returned %d", getTag(), client->fd);
+	delete client;
+      } else if (openClient(client) == OS_NO_ERR) {
+	zpec_info("%s: accepting connection from %s", getTag(), ipstr);
+	client->line = new char[lineSize()];
+	client->line[0] = '\0';
+	clients[client->myId()] = client;
+	openConnection(client);
+      } else {
+	zpec_warn_fn("%s: rejecting connection from %s", getTag(), ipstr);
+	close(client->fd);
+	delete client;
+      }
+    }
+  }
+}
+
+/**
+  Takes a line from a multiplexed client's buffered input, as for
+  readLine(), but without reading the socket. An incomplete line is kept in
+  the client for the next call.
+
+  \param client  Input client.
+  \param noBlank Whether to return blank lines.
+
+  \return The number of characters in the line, which is client->line, or 0
+	  if no complete line is buffered.
+*/
+int TcpService::takeLine(TcpClient *client, bool noBlank)
+{
+  char input;
+
+  while (client->nextChar(&input)) {
+    if (addChar(client->line, lineSize(), client->lineLen, input, noBlank)) {
+      int nTot = (int )client->lineLen;
+      client->lineLen = 0;
+      return nTot;
+    }
+  }
+  return 0;
+}
+
+/**
+  Sends a reply to a client. The reply is queued for a multiplexed client,
+  and written at once otherwise.
+
+  \param client Requesting client.
+  \param buf    Reply data.
+  \param nBytes Number of bytes in \a buf.
+*/
+void TcpService::reply(TcpClient *client, const void *buf, unsigned nBytes)
+{
+  if (mux_) {
+    client->queue(buf, nBytes);
+  } else {
+    zpec_write_retry(client->fd, buf, nBytes, "TcpService::reply");
+  }
+}
+
+
 /**
   Main UDP service routine. Listens for subscribe/unsubscribe requests and 
   maintains the subscription list.
@@ -378,7 +576,7 @@ void SimpleTcpService::handleClient(Client *client)
   // Call handleRequest for each line of input.
   char request[1+maxRequest];
   int nRead;
-  while ((nRead = readLine(request, sizeof(request), tcpClient->fd, true))
+  while ((nRead = readLine(request, sizeof(request), tcpClient, true))
          > 0) {
     handleRequest(tcpClient, request); 
   }
@@ -388,6 +586,304 @@ void SimpleTcpService::handleClient(Client *client)
   close(tcpClient->fd);
 }
 
+/**
+  Handles each complete request line of a multiplexed client.
+*/
+bool SimpleTcpService::handleInput(TcpClient *client)
+{
+  while (takeLine(client, true) > 0) {
+    handleRequest(client, client->line);
+  }
+  return true;
+}
+
+/**
+  Starts the command queue worker task, then the control service itself.
+*/
+void ControlService::startSameTask()
+{
+  static const char *fn = "ControlService::startSameTask";
+
+  OSCritInit(&queueLock_);
+  OSSemInit(&queueSem_, 0);
+  for (unsigned i=0; i<maxMuxClients; ++i) {
+    OSCritInit(&outLock_[i]);
+    OSSemInit(&idle_[i], 0);
+    pending_[i] = 0;
+  }
+
+  if (OSTaskCreate(workerTask, (void *)this,
+		   (void *)&workerStack_[USER_TASK_STK_SIZE],
+		   (void *)&workerStack_[0], ZPEC_CMDQ_PRIO) == OS_NO_ERR) {
+    workerReady_ = true;
+  } else {
+    zpec_error_fn("%s: command queue task priority (%d) unavailable",
+		  getTag(), ZPEC_CMDQ_PRIO);
+  }
+
+  TcpService::startSameTask();
+}
+
+/**
+  Extracts the (lower case) command name from a command line.
+
+  \param cmdLine Command line; advanced to the arguments, if any.
+  \param name    Command name buffer.
+  \param size    Size of \a name.
+
+  \return False if the name does not fit the buffer, else true.
+*/
+static bool cmdName(const char *&cmdLine, char *name, size_t size)
+{
+  unsigned n = 0;
+
+  while (isspace(*cmdLine)) { ++cmdLine; }
+  for ( ; *cmdLine && !isspace(*cmdLine); ++cmdLine) {
+    if (n == size-1) { return false; }
+    name[n++] = tolower(*cmdLine);
+  }
+  name[n] = '\0';
+  while (isspace(*cmdLine)) { ++cmdLine; }
+  return true;
+}
+
+/**
+  Determines whether a command line is to be queued. The worker task must
+  be running and the line must fit a queue entry. While the client has
+  requests pending, every command but the immediate ones is queued, so that
+  the client's commands take effect in order; otherwise only commands named
+  with setQueued(), under any of their aliases, and given arguments are.
+
+  \param client  Requesting client.
+  \param cmdLine Command line.
+*/
+bool ControlService::isQueued(TcpClient *client, const char *cmdLine) const
+{
+  char name[16];
+
+  if (!workerReady_ || strlen(cmdLine) >= maxQueued) { return false; }
+  if (pending_[client->myId()]) { return !isImmediate(cmdLine); }
+
+  return (cmdName(cmdLine, name, sizeof(name)) && *cmdLine != '\0' &&
+	  isNamed(queued_, name));
+}
+
+/**
+  Determines whether a command line may run while the client has requests
+  pending: the command must be named with setImmediate(), under any of its
+  aliases, and have no arguments.
+
+  \param cmdLine Command line.
+*/
+bool ControlService::isImmediate(const char *cmdLine) const
+{
+  char name[16];
+
+  return (cmdName(cmdLine, name, sizeof(name)) && *cmdLine == '\0' &&
+	  isNamed(immediate_, name));
+}
+
+/**
+  Determines whether a command line writes its output to the client
+  descriptor: any but the immediate commands not named as streaming with
+  setImmediate().
+
+  \param cmdLine Command line.
+*/
+bool ControlService::isStreamed(const char *cmdLine) const
+{
+  char name[16];
+
+  return (!isImmediate(cmdLine) ||
+	  (cmdName(cmdLine, name, sizeof(name)) && isNamed(streamed_, name)));
+}
+
+/**
+  Determines whether a command is one of a set, by the member function its
+  name maps to, so that every alias of a named command matches.
+
+  \param names Command names.
+  \param name  Command name (lower case).
+*/
+bool ControlService::isNamed(const std::set<std::string>& names,
+			     const char *name) const
+{
+  Correlator::shell_type::const_iterator iCmd = ::zpecShell.find(name);
+  if (iCmd == ::zpecShell.end()) { return false; }
+
+  for (std::set<std::string>::const_iterator i = names.begin();
+       i != names.end(); ++i) {
+    Correlator::shell_type::const_iterator iName = ::zpecShell.find(i->c_str());
+    if (iName != ::zpecShell.end() && iName->member == iCmd->member) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+  Queues a command for the worker task.
+
+  \param client  Requesting client.
+  \param cmdLine Command line.
+
+  \return The request id, or 0 if the queue is full.
+*/
+unsigned ControlService::enqueue(TcpClient *client, const char *cmdLine)
+{
+  unsigned id = 0;
+
+  OSCritEnter(&queueLock_, 0);
+    if (nJobs_ < queueLen) {
+      Job& job = queue_[(head_ + nJobs_++) % queueLen];
+      if (++nextId_ == 0) { ++nextId_; }
+      id = job.id = nextId_;
+      job.client = client;
+      strncpy(job.cmd, cmdLine, maxQueued-1);
+      job.cmd[maxQueued-1] = '\0';
+      if (pending_[client->myId()]++ == 0) {
+	OSSemInit(&idle_[client->myId()], 0);  // Posted when none remain.
+      }
+    }
+  OSCritLeave(&queueLock_);
+
+  if (id) { OSSemPost(&queueSem_); }
+  return id;
+}
+
+/**
+  Waits for the queued and running commands of a client to complete.
+
+  \param client Requesting client.
+*/
+void ControlService::waitIdle(Client *client)
+{
+  if (pending_[client->myId()]) { OSSemPend(&idle_[client->myId()], 0); }
+}
+
+/**
+  Drops the queued commands of a client, then waits for its command in
+  progress (if any) to complete. Any set point batch it left open is
+  discarded.
+
+  \param client Departing client.
+*/
+void ControlService::cancel(Client *client)
+{
+  OSCritEnter(&queueLock_, 0);
+    unsigned n = 0;
+    for (unsigned i=0; i<nJobs_; ++i) {
+      const Job& job = queue_[(head_ + i) % queueLen];
+      if (job.client != client) { queue_[(head_ + n++) % queueLen] = job; }
+      else                      { --pending_[job.client->myId()]; }
+    }
+    nJobs_ = n;
+  OSCritLeave(&queueLock_);
+
+  waitIdle(client);
+  argus_batchRelease(client->myId());
+}
+
+/**
+  Command queue worker. Executes queued commands in order, sending each
+  response to the requesting client. The client's output is locked for the
+  whole command, so that output it streams is not interleaved with other
+  responses; the request id is sent first, prefixing the first line.
+*/
+void ControlService::runJobs()
+{
+  static const char *fn = "ControlService::runJobs";
+  Job job;
+
+  while (1) {
+    OSSemPend(&queueSem_, 0);
+
+    OSCritEnter(&queueLock_, 0);
+      if (nJobs_ == 0) {  // Dropped by cancel().
+	OSCritLeave(&queueLock_);
+	continue;
+      }
+      job = queue_[head_];
+      head_ = (head_ + 1) % queueLen;
+      --nJobs_;
+    OSCritLeave(&queueLock_);
+
+    // Input stays with the client's server task; output goes to the client.
+    int id = job.client->myId(), fd = job.client->fd;
+    OSCritEnter(&outLock_[id], 0);
+      unsigned n = siprintf(jobStatus_, "&%u ", job.id);
+      zpec_write_retry(fd, jobStatus_, n, fn);
+
+      Correlator::command_type cmd = {job.cmd, -1, fd, id};
+      ::zpecShell.exec(jobStatus_, cmd);
+      zpec_write_retry(fd, jobStatus_, strlen(jobStatus_), fn);
+    OSCritLeave(&outLock_[id]);
+
+    OSCritEnter(&queueLock_, 0);
+      bool idle = (--pending_[id] == 0);
+    OSCritLeave(&queueLock_);
+    if (idle) { OSSemPost(&idle_[id]); }
+  }
+}
+
+/**
+  \param vsvc Control service instance cast to a void pointer.
+*/
+void ControlService::workerTask(void *vsvc)
+{
+  ((ControlService *)vsvc)->runJobs();
+}
+
+/**
+  Executes or queues one command line, and sends the response and prompt.
+
+  \param client  Requesting client.
+  \param cmdLine Command line, replaced by the response (at least maxLine
+		 characters).
+
+  \return False at end of input, else true.
+*/
+bool ControlService::execLine(TcpClient *client, char *cmdLine)
+{
+  static const char *fn = "ControlService::execLine";
+  OS_CRIT *outLock = &outLock_[client->myId()];
+
+  if (isQueued(client, cmdLine)) {
+    unsigned id = enqueue(client, cmdLine);
+    if (id) {
+      siprintf(cmdLine, "%sQueued as request %u.\r\n",
+	       Correlator::statusOK, id);
+    } else {
+      siprintf(cmdLine, "%sCommand queue full (%u requests).\r\n",
+	       Correlator::statusERR, queueLen);
+    }
+  } else if (pending_[client->myId()] && !isImmediate(cmdLine)) {
+    // Too long to queue behind the client's pending requests.
+    siprintf(cmdLine, "%sCommand too long to queue (%u characters maximum); "
+	     "retry when pending requests complete.\r\n",
+	     Correlator::statusERR, maxQueued-1);
+  } else {
+    // Output streamed to the client follows any response being sent.
+    bool streamed = isStreamed(cmdLine);
+    Correlator::command_type cmd = {cmdLine, client->fd, client->fd,
+				    client->myId()};
+    if (streamed) { OSCritEnter(outLock, 0); }
+    ::zpecShell.exec(cmdLine, cmd);
+    if (streamed) { OSCritLeave(outLock); }
+  }
+  if (strcmp(cmdLine, Correlator::statusEOF)) {
+    strcat(cmdLine, prompt);
+    OSCritEnter(outLock, 0);
+      zpec_write_retry(client->fd, cmdLine, strlen(cmdLine), fn);
+    OSCritLeave(outLock);
+    return true;
+  } else {
+    // Let pending requests complete and send their responses first.
+    waitIdle(client);
+    return false;
+  }
+}
+
 void ControlService::handleClient(Client *client)
 {
   static const char *fn = "ControlService::handleClient";
@@ -400,19 +896,11 @@ void ControlService::handleClient(Client *client)
   ReadWithTimeout(tcpClient->fd, cmdLine, sizeof(cmdLine)-1, TICKS_PER_SECOND);
   zpec_write_retry(tcpClient->fd, prompt, strlen(prompt), fn);
 
-  // Read and process commands.
+  // Read and process commands; queue long-running ones.
   int nRead;
-  while ((nRead = readLine(cmdLine, sizeof(cmdLine), tcpClient->fd, false))
-         >= 0) {
-    Correlator::command_type cmd = {cmdLine, tcpClient->fd, tcpClient->fd};
-    ::zpecShell.exec(cmdLine, cmd);
-    if (strcmp(cmdLine, Correlator::statusEOF)) {
-      strcat(cmdLine, prompt);
-      zpec_write_retry(tcpClient->fd, cmdLine, strlen(cmdLine), fn);
-    } else {
-      break;
-    }
-  }
+  while ((nRead = readLine(cmdLine, sizeof(cmdLine), tcpClient, false))
+         >= 0 && execLine(tcpClient, cmdLine)) ;
+  cancel(client);
 
   if (nRead <= 0) {
     zpec_info("%s: client %d readLine() returned %d, closing connection",
@@ -425,18 +913,73 @@ void ControlService::handleClient(Client *client)
 }
 
 
+/**
+  Sends the initial prompt to a multiplexed client. Input during the first
+  second, the telnet initialization string, is discarded.
+*/
+void ControlService::openConnection(TcpClient *client)
+{
+  flushUntil_[client->myId()] = TimeTick + TICKS_PER_SECOND;
+  zpec_write_retry(client->fd, prompt, strlen(prompt),
+		   "ControlService::openConnection");
+}
+
+/**
+  Executes each complete command line of a multiplexed client.
+*/
+bool ControlService::handleInput(TcpClient *client)
+{
+  if ((long )(flushUntil_[client->myId()] - TimeTick) > 0) {
+    client->discard();
+    return true;
+  }
+  while (takeLine(client, false) > 0) {
+    if (!execLine(client, client->line)) { return false; }
+  }
+  return true;
+}
+
+/**
+  Drops the queued commands of a departing multiplexed client.
+*/
+void ControlService::closeConnection(TcpClient *client)
+{
+  cancel(client);
+}
+
+
 void DataService::handleRequest(TcpClient *client, char *request)
 {
   char obs = 't';
   unsigned band = 0, nSend = 0;
-  sscanf(request, "%c%u%u", &obs, &band, &nSend);
+  int nField = sscanf(request, "%c%u%u", &obs, &band, &nSend);
+
+  if (obs == 'a') {
+    if (::zpectrometer.hardware() != ZPEC_HW_ARG || !argus_samplerReady()) {
+      char msg[64];
+      unsigned n = siprintf(msg, "%sNo Argus telemetry.\r\n",
+			    Correlator::statusERR);
+      reply(client, msg, n);
+      return;
+    }
+
+    // Telemetry frame, or changes since table version BAND.
+    DWORD frame[TELEMMAXBYTES/4];
+    int n = (nField >= 2 ?
+	     argus_telemDelta((BYTE *)frame, sizeof(frame), band) :
+	     argus_telemFrame((BYTE *)frame, sizeof(frame)));
+    reply(client, frame, n);
+    return;
+  }
 
   unsigned nBuffers = (obs=='d' ? 2 : 1);
   if (nSend == 0) { nSend = ::zpectrometer.nLags()*nBuffers; }
 
+  std::string out;
   ::zpectrometer.lock();
-    ::zpectrometer.Band(band).lags.write(client->fd, 0, nSend);
+    ::zpectrometer.Band(band).lags.write(out, 0, nSend);
   ::zpectrometer.unlock();
+  reply(client, out.data(), out.size());
 }
 
 
@@ -445,19 +988,86 @@ void MonitorService::handleRequest(TcpClient *client, char *request)
   int interval = 0, count = 0;
   sscanf(request, "%i%i", &interval, &count);
 
-  for (int iter=0; iter==0 || (interval>0 && iter!=count &&
-			       !zpec_interrupt(client->fd)); ++iter) {
-    ::zpectrometer.periph_lock();
-      ::zpectrometer.monitorPoints(false).write(client->fd); 
-    ::zpectrometer.periph_unlock();
+  if (isMultiplexed()) {
+    // Send the first set now; pollClient() sends any others.
+    Repeat& rep = repeat_[client->myId()];
+    rep.active   = true;
+    rep.interval = interval;
+    rep.count    = count;
+    rep.iter     = 0;
+    rep.next     = TimeTick;
+    (void )pollClient(client);
+    return;
+  }
 
-    if (interval>0) {
-      write(client->fd, "\r\n", 2);
-      if (1+iter != count) { OSTimeDly((interval*TICKS_PER_SECOND)/10); }
+  // Repeat until count, or until further input arrives (which is then
+  // processed as the next request if already buffered).
+  for (int iter=0; iter==0 || (interval>0 && iter!=count && !client->buffered()
+			       && !zpec_interrupt(client->fd)); ++iter) {
+    writeSet(client, interval>0);
+    if (interval>0 && 1+iter != count) {
+      OSTimeDly((interval*TICKS_PER_SECOND)/10);
     }
   }
 }
 
+/**
+  Sends one set of monitor readings.
+
+  \param client Requesting client.
+  \param repeat Whether the set is one of a series (followed by a blank line).
+*/
+void MonitorService::writeSet(TcpClient *client, bool repeat)
+{
+  std::string out;
+  ::zpectrometer.periph_lock();
+    ::zpectrometer.monitorPoints(false).write(out); 
+  ::zpectrometer.periph_unlock();
+
+  if (repeat) { out += "\r\n"; }
+  reply(client, out.data(), out.size());
+}
+
+/**
+  Clears the repeated request of a new multiplexed client.
+*/
+void MonitorService::openConnection(TcpClient *client)
+{
+  repeat_[client->myId()].active = false;
+}
+
+/**
+  Stops any repeated request, then handles new requests.
+*/
+bool MonitorService::handleInput(TcpClient *client)
+{
+  repeat_[client->myId()].active = false;
+  return SimpleTcpService::handleInput(client);
+}
+
+/**
+  Sends the next set of a repeated request when due.
+
+  \return Ticks until the next set, or 0 if none is scheduled.
+*/
+DWORD MonitorService::pollClient(TcpClient *client)
+{
+  Repeat& rep = repeat_[client->myId()];
+
+  if (!rep.active) { return 0; }
+  long due = (long )(rep.next - TimeTick);
+  if (due > 0) { return (DWORD )due; }
+
+  writeSet(client, rep.interval>0);
+  if (rep.interval<=0 || ++rep.iter == rep.count) {
+    rep.active = false;
+    return 0;
+  }
+  rep.next += (rep.interval*TICKS_PER_SECOND)/10;
+  due = (long )(rep.next - TimeTick);
+  return (due > 0 ? (DWORD )due : 1);
+}
+
 
 void MessageService::handleClient(Client *client)
 {
@@ -531,6 +1141,56 @@ int MessageService::post(const char *msg)
 }
 
 
+/**
+  Publishes telemetry frames to subscribers. Runs as the single server task
+  of the service; never returns.
+*/
+void TelemetryService::handleClient(Client *client)
+{
+  DWORD frame[TELEMMAXBYTES/4];
+  struct telemHeader *h = (struct telemHeader *)frame;
+  unsigned long lastSeq = 0, lastVer = 0;
+  DWORD lastSend = TimeTick;
+  WORD pktSeq = 0;
+  unsigned nFrames = 0;
+  int nBytes = 0;
+
+  container_type clients;
+  while (1) {
+    OSTimeDly((period_*TICKS_PER_SECOND + 999)/1000);
+
+    lock();
+      clients = clientMap_;
+    unlock();
+    if (clients.empty()) { continue; }
+
+    // Frame a new sweep; the snapshot is only read while the sampler runs,
+    // since otherwise argus_lockSnapshot() would sweep the hardware itself.
+    if (samplerPeriod && samplerSeq && samplerSeq != lastSeq) {
+      if (keyEvery_ == 0) {
+	nBytes = argus_telemFrame((BYTE *)frame, sizeof(frame));
+      } else {
+	nBytes = argus_telemDelta((BYTE *)frame, sizeof(frame),
+				  (nFrames % keyEvery_ ? lastVer : 0));
+	lastVer = h->ver;
+      }
+      lastSeq = h->seq;
+      ++nFrames;
+    } else if (!nBytes || TimeTick - lastSend < keepAlive*TICKS_PER_SECOND) {
+      continue;
+    }
+
+    if (++pktSeq == 0) { pktSeq = 1; }
+    h->pktSeq = pktSeq;
+    for (container_type::const_iterator client = clients.begin();
+	  client != clients.end(); ++client) {
+      send(frame, nBytes, client->first, client->second);
+    }
+    lastSend = TimeTick;
+  }
+}
+
+
 extern "C" {
 
 /**
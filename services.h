@@ -13,15 +13,13 @@
 #include <ucos.h>
 
 #include <map>
+#include <set>
 #include <stack>
+#include <string>
 
 #include "zpec.h"
 
-// Note: priorities staggered to create holes for associated server tasks.
-#define ZPEC_MESSAGE_PRIO (OS_LO_PRIO - 9)  ///< Message service task priority.
-#define ZPEC_CONTROL_PRIO (OS_LO_PRIO - 6)  ///< Control service task priority.
-#define ZPEC_DATA_PRIO    (OS_LO_PRIO - 4)  ///< Data    service task priority.
-#define ZPEC_MONITOR_PRIO (OS_LO_PRIO - 2)  ///< Monitor service task priority.
+// Task priorities: see zpec.h.
 
 extern "C" {
   /// C linkage uC/OS task function.
@@ -67,16 +65,119 @@ public:
       Client(svc, id), ip(addr), port(num) { }
 };
 
-/// TCP/IP client.
+/**
+  TCP/IP client. Input is buffered: each read() takes whatever is available
+  on the socket, up to inSize bytes, so that pipelined requests are parsed
+  from memory. Clients of multiplexed services also keep their partial
+  input line, since no server task holds it between reads, and queue their
+  output, which is sent as the socket accepts it (see flush()).
+*/
 class TcpClient: public IpClient
 {
 public:
-  int    fd;  ///< Client socket file descriptor.
+  static const unsigned inSize  = 512,    ///< Input buffer size.
+                        outSize = 16384;  ///< Output queue limit.
+
+  int      fd;       ///< Client socket file descriptor.
+  char    *line;     ///< Partial input line (multiplexed services only).
+  unsigned lineLen;  ///< Length of partial input line.
 
   /// Constructor.
   TcpClient(Service *svc = 0, int id = 0, IPADDR addr = 0, WORD port = 0,
            int sock = -1) :
-      IpClient(svc, id, addr, port), fd(sock) { }
+      IpClient(svc, id, addr, port), fd(sock), line(0), lineLen(0),
+      inHead_(0), inCount_(0), overflow_(false) { }
+
+  /// Destructor.
+  ~TcpClient() { delete [] line; }
+
+  /// Number of input bytes received but not yet consumed.
+  unsigned buffered() const { return inCount_; }
+
+  /**
+    Reads the socket if the input buffer is empty.
+
+    \return The number of buffered bytes, else the read() return value.
+  */
+  int fill() {
+    if (inCount_ == 0) {
+      int nRead = read(fd, inBuf_, inSize);
+      if (nRead <= 0) { return nRead; }
+      inHead_  = 0;
+      inCount_ = nRead;
+    }
+    return (int )inCount_;
+  }
+
+  /**
+    Returns the next input character, reading the socket only when the
+    buffer is empty.
+
+    \param c Output character.
+
+    \return 1 on success, else the read() return value.
+  */
+  int getChar(char *c) {
+    int nRead = fill();
+    if (nRead <= 0) { return nRead; }
+    *c = inBuf_[inHead_++];
+    --inCount_;
+    return 1;
+  }
+
+  /**
+    Returns the next buffered input character; never reads the socket.
+
+    \param c Output character.
+
+    \return Whether a character was available.
+  */
+  bool nextChar(char *c) {
+    if (inCount_ == 0) { return false; }
+    *c = inBuf_[inHead_++];
+    --inCount_;
+    return true;
+  }
+
+  /// Discards buffered input.
+  void discard() { inCount_ = 0; }
+
+  /// Number of output bytes queued but not yet sent.
+  unsigned queued() const { return out_.size(); }
+
+  /// Whether queued output exceeded outSize (and was dropped).
+  bool overflowed() const { return overflow_; }
+
+  /**
+    Queues output. Output that would take the queue past outSize is dropped
+    instead, and the client marked as overflowed.
+
+    \param buf    Output data.
+    \param nBytes Number of bytes in \a buf.
+  */
+  void queue(const void *buf, unsigned nBytes) {
+    if (out_.size() + nBytes > outSize) { overflow_ = true; }
+    else { out_.append((const char *)buf, nBytes); }
+  }
+
+  /**
+    Sends as much queued output as the socket accepts; call when select()
+    reports the socket writable, so that write() does not block.
+
+    \return The number of bytes sent, else the write() return value.
+  */
+  int flush() {
+    int nWrite = write(fd, out_.data(), out_.size());
+    if (nWrite > 0) { out_.erase(0, nWrite); }
+    return nWrite;
+  }
+
+private:
+  char inBuf_[inSize];  ///< Input buffer.
+  unsigned inHead_,     ///< Index of next unconsumed input byte.
+           inCount_;    ///< Number of unconsumed input bytes.
+  std::string out_;     ///< Output queue (multiplexed services only).
+  bool overflow_;       ///< Whether queued output was dropped.
 };
 
 
@@ -85,7 +186,8 @@ public:
   service scripts. A service is an entity that can be started and stopped.
   Services have a name, an associated priority---in this case, corresponding
   to the OS priority of the service task---and zero or more active clients.
-  Each client communicates with an independent server task.
+  Each client communicates with an independent server task, unless the
+  service multiplexes its clients (see TcpService).
 
   Concrete services need to implement two methods, offerService(), which
   enables the service, obtains clients, and passes each off to a server via
@@ -99,7 +201,9 @@ public:
 class Service
 {
 public:
-  static const unsigned maxClients = 4;  ///< Maximum number of active clients.
+  static const unsigned
+    maxClients    = 4,   ///< Maximum number of active clients (server tasks).
+    maxMuxClients = 32;  ///< Maximum number of active multiplexed clients.
 
   /**
     Constructor.
@@ -111,7 +215,11 @@ public:
           initialization order issues.
   */
   Service(const char *name, BYTE prio) :
-      prio_(prio), name_(name), nClients_(0), isActive_(0) { setTag(); }
+      prio_(prio), name_(name), nClients_(0), isActive_(0),
+      clientLimit_(maxClients) {
+    for (unsigned i=0; i<maxClients; ++i) { serverStack_[i] = 0; }
+    setTag();
+  }
 
   /// Destructor.
   virtual ~Service() { stop(); }
@@ -153,7 +261,23 @@ protected:
   int createServer(Client *);
 
   /// Read input using erase processing.
-  int readLine(char *line, unsigned size, int fd, bool noBlank);
+  int readLine(char *line, unsigned size, TcpClient *client, bool noBlank);
+
+  /// Append a character to a line using erase processing.
+  static bool addChar(char *line, unsigned size, unsigned& nTot, char input,
+                      bool noBlank);
+
+  /// Set the maximum number of active clients (at most maxMuxClients).
+  void setClientLimit(unsigned n) { clientLimit_ = n; }
+
+  /// Reserve record storage for new client and attach it to service.
+  int openClient(Client *);
+
+  /// Release records for a terminated client, then delete it.
+  void closeClient(Client *);
+
+  /// Release records for a client without deleting it.
+  bool releaseClient(Client *);
 
   /// Lock the mutex.
   void lock()   { OSCritEnter(&lock_, 0); }
@@ -169,24 +293,18 @@ private:
   /// Service task stack space.
   DWORD serviceStack_[serviceStackSize] __attribute__( ( aligned( 4 ) ) );
 
-  /// Server tasks stack space.
-  DWORD serverStack_[maxClients][serverStackSize]
-            __attribute__( ( aligned( 4 ) ) );
+  /// Server task stacks, by client id; allocated on first use and kept.
+  DWORD *serverStack_[maxClients];
 
-  OS_CRIT lock_;       ///< Service data mutex.
-  BYTE prio_;          ///< OS priority of service task.
-  const char *name_;   ///< Service name.
-  unsigned nClients_;  ///< Number of active clients.
-  unsigned isActive_;  ///< Active client bit set.
+  OS_CRIT lock_;          ///< Service data mutex.
+  BYTE prio_;             ///< OS priority of service task.
+  const char *name_;      ///< Service name.
+  unsigned nClients_;     ///< Number of active clients.
+  unsigned isActive_;     ///< Active client bit set.
+  unsigned clientLimit_;  ///< Maximum number of active clients.
 
   // OS task functions; declared via typedef to force C linkage conventions.
   static task_fn_t serviceTask, serverTask;
-
-  /// Reserve record storage for new client and attach it to service.
-  int openClient(Client *);
-
-  /// Release records for a terminated client, then delete it.
-  void closeClient(Client *);
 };
 
 
@@ -234,18 +352,72 @@ private:
   socket file descriptor when enabled. The descriptor is used to listen for
   client connection requests. Concrete instances must implement the
   handleClient() method to process client communications.
+
+  A multiplexed service (see setMultiplexed()) instead serves up to
+  maxMuxClients clients from the service task itself, waiting in select() for
+  input on any of them. No server tasks are created; concrete services keep
+  any per-connection state between calls, and implement handleInput() and,
+  as needed, openConnection(), pollClient(), and closeConnection(). Since all
+  clients share one task, requests must not block for long, and replies must
+  be sent with reply(), which queues them in the client; queued output is
+  sent as select() finds the socket writable. Input and polling of a client
+  wait until its queued output is sent, and a client that lets more than
+  TcpClient::outSize bytes queue up is disconnected, so a client that stops
+  reading does not hold up the others.
 */
 class TcpService: public IpService
 {
 public:
   /// Constructor.
   TcpService(const char *name, BYTE prio, WORD port) :
-      IpService(name, prio, port), fdListen_(-1) { }
+      IpService(name, prio, port), fdListen_(-1), mux_(false) { }
 
   virtual void offerService();
 
+  /// Serve all clients from the service task; call before starting.
+  void setMultiplexed(bool mux) {
+    mux_ = mux;  setClientLimit(mux ? maxMuxClients : maxClients);
+  }
+
+  /// Whether clients are served from the service task.
+  bool isMultiplexed() const { return mux_; }
+
+protected:
+  /// Input line buffer size of a multiplexed client.
+  virtual unsigned lineSize() const { return 256; }
+
+  /// Prepare a new multiplexed client.
+  virtual void openConnection(TcpClient *) { }
+
+  /**
+    Process newly buffered input from a multiplexed client.
+
+    \return Whether to keep the connection open.
+  */
+  virtual bool handleInput(TcpClient *) { return false; }
+
+  /**
+    Perform any scheduled work for a multiplexed client; called before each
+    wait for input.
+
+    \return Ticks until the next call is wanted, or 0 to wait for input.
+  */
+  virtual DWORD pollClient(TcpClient *) { return 0; }
+
+  /// Release a multiplexed client's resources before disconnecting.
+  virtual void closeConnection(TcpClient *) { }
+
+  /// Take a complete line from a multiplexed client's buffered input.
+  int takeLine(TcpClient *client, bool noBlank);
+
+  /// Send a reply, queued for a multiplexed client (see TcpClient::queue()).
+  void reply(TcpClient *client, const void *buf, unsigned nBytes);
+
 private:
   int fdListen_;  ///< Listening socket file descriptor.
+  bool mux_;      ///< Whether clients are multiplexed.
+
+  void offerMultiplexed();
 };
 
 /**
@@ -268,12 +440,17 @@ public:
   void handleClient(Client *client);
 
   /**
-    Process a single request from a simple TCP client.
+    Process a single request from a simple TCP client. Multiplexed services
+    must not block here.
 
     \param client  Attached (active) client.
     \param request Client request string.
   */
   virtual void handleRequest(TcpClient *client, char *request) = 0;
+
+protected:
+  unsigned lineSize() const { return 1+maxRequest; }
+  bool handleInput(TcpClient *client);
 };
 
 
@@ -329,6 +506,32 @@ private:
   of any line beyond the initial status line, allowing multiple, concatenated
   responses to be distinguished by clients.
 
+  Long-running commands, those named with setQueued() (under any alias),
+  are not executed by the client's server task when given arguments. They
+  are instead queued for a single worker task, and the server immediately
+  acknowledges with
+\verbatim
+  # Queued as request ID.
+\endverbatim
+  The worker executes queued commands in order, and sends each response on
+  the same connection, with its first line prefixed by '&' and the request
+  id (e.g., "&12 # ..."). Queued commands cannot read client input, but may
+  stream output to the client; the connection's output is theirs until the
+  command completes. While a client has requests queued or running, its
+  other commands are queued too, so that they take effect in order; only
+  the argument-free forms of commands named with setImmediate() (read-only
+  queries such as status, halt, and quit) run at once. Of these, the ones
+  that stream output (JSON queries) wait for the response in progress; the
+  others must not write to the client descriptor. A line too long to queue
+  is refused while requests are pending. Otherwise, commands not queued run
+  on the client's server task. At end of input, pending requests complete
+  before the connection closes; requests still queued when the client
+  disconnects are dropped.
+
+  When multiplexed, all clients share the control task, so a command that
+  is neither queued nor quick, or a wait for a departing client's request
+  in progress, delays the other clients until it completes.
+
   \todo Merge line erase processing with that used by the
         SimpleTcpService class.
 
@@ -343,11 +546,75 @@ public:
 		    *prompt;          ///< Command line prompt (separator).
   static const WORD  ctlPort = 23;    ///< Control service port number.
   static const size_t maxLine = 2048; ///< Maximum input line length.
+  static const unsigned queueLen = 8; ///< Command queue length.
+  static const size_t maxQueued = 128;///< Maximum queued command length.
 
   /// Constructor.
-  ControlService() : TcpService(ctlName, ctlPrio, ctlPort) { }
+  ControlService() : TcpService(ctlName, ctlPrio, ctlPort),
+      head_(0), nJobs_(0), nextId_(0), workerReady_(false) { }
+
+  virtual void startSameTask();
 
   void handleClient(Client *client);
+
+  /// Queue command \a name (and its aliases) for the worker task when given
+  /// arguments.
+  void setQueued(const char *name) { queued_.insert(name); }
+
+  /// Run read-only command \a name (and its aliases), given no arguments,
+  /// even while the client has requests pending; one that \a streams its
+  /// output to the client waits for the response in progress.
+  void setImmediate(const char *name, bool streams = false) {
+    immediate_.insert(name);
+    if (streams) { streamed_.insert(name); }
+  }
+
+protected:
+  unsigned lineSize() const { return maxLine; }
+  void openConnection(TcpClient *client);
+  bool handleInput(TcpClient *client);
+  void closeConnection(TcpClient *client);
+
+private:
+  /// Queued command.
+  struct Job {
+    unsigned   id;              ///< Request id.
+    TcpClient *client;          ///< Requesting client.
+    char       cmd[maxQueued];  ///< Command line.
+  };
+
+  std::set<std::string> queued_;  ///< Names of queued commands.
+  std::set<std::string> immediate_; ///< Names of immediate commands.
+  std::set<std::string> streamed_; ///< Names of streaming immediate commands.
+  Job queue_[queueLen];           ///< Command queue (circular).
+  unsigned head_,                 ///< Index of oldest queued command.
+	   nJobs_,                ///< Number of queued commands.
+	   nextId_;               ///< Last request id.
+  bool workerReady_;              ///< Whether the worker task is running.
+  OS_CRIT queueLock_;             ///< Command queue mutex.
+  OS_SEM  queueSem_;              ///< Posted for each queued command.
+  OS_CRIT outLock_[maxMuxClients]; ///< Per-client output mutexes.
+  volatile unsigned pending_[maxMuxClients]; ///< Requests queued or running,
+					     ///< by client.
+  OS_SEM  idle_[maxMuxClients];   ///< Posted when a client's requests complete.
+  DWORD flushUntil_[maxMuxClients]; ///< End of telnet negotiation, by client.
+  char jobStatus_[maxLine];       ///< Worker return status.
+
+  /// Worker task stack space.
+  DWORD workerStack_[USER_TASK_STK_SIZE] __attribute__( ( aligned( 4 ) ) );
+
+  // OS task function; declared via typedef to force C linkage conventions.
+  static task_fn_t workerTask;
+
+  bool isQueued(TcpClient *client, const char *cmdLine) const;
+  bool isImmediate(const char *cmdLine) const;
+  bool isStreamed(const char *cmdLine) const;
+  bool isNamed(const std::set<std::string>& names, const char *name) const;
+  unsigned enqueue(TcpClient *client, const char *cmdLine);
+  void waitIdle(Client *client);
+  void cancel(Client *client);
+  void runJobs();
+  bool execLine(TcpClient *client, char *cmdLine);
 };
 
 
@@ -367,6 +634,13 @@ public:
 
   The server then sends a binary lag data block by calling
   LagData::write(). If a non-existent band is requested, band \#0 is used.
+
+  On Argus hardware, \c BUFFER 'a' (with no further fields) instead returns
+  a binary telemetry frame of the latest monitor data; see
+  argus_telemFrame(). With a version number in place of \c BAND, it returns
+  the changes since that change table version, or a keyframe; see
+  argus_telemDelta(). On other hardware, or before the monitor sampler has
+  started, 'a' returns an error line (starting with '!') instead.
   %Service continues until the connection is closed by the client.
 
   \todo Implement 'm' and 'o' buffers.
@@ -406,6 +680,8 @@ private:
   a blank line. If COUNT is zero, the cycle repeats indefinitely until another
   line of input is received (and is discarded). At this point, a new request
   can be made. This behavior is equivalent to the \c query control command.
+  When multiplexed, repeats are scheduled rather than waited for, and any
+  input stops them.
 
   %Service continues until the connection is closed by the client.
 */
@@ -421,6 +697,25 @@ public:
   MonitorService() : SimpleTcpService(monName, monPrio, monPort) { }
 
   void handleRequest(TcpClient *client, char *request);
+
+protected:
+  void openConnection(TcpClient *client);
+  bool handleInput(TcpClient *client);
+  DWORD pollClient(TcpClient *client);
+
+private:
+  /// Repeated request of a multiplexed client.
+  struct Repeat {
+    bool  active;    ///< Whether sets remain to be sent.
+    int   interval,  ///< Sampling interval [dsec].
+          count,     ///< Number of sets, 0 for unlimited.
+          iter;      ///< Number of sets sent.
+    DWORD next;      ///< Time of the next set [ticks].
+  };
+
+  Repeat repeat_[maxMuxClients];  ///< Repeated requests, by client id.
+
+  void writeSet(TcpClient *client, bool repeat);
 };
 
 
@@ -464,4 +759,57 @@ private:
    std::stack<char *> msgStack_;
 };
 
+
+/**
+  Argus telemetry service. The telemetry service publishes binary telemetry
+  frames (see argus_telemFrame()) to UDP subscribers; see UdpService for the
+  subscription procedure. Each period, if the monitor sampler has published
+  a new sweep, one frame is built from the cached snapshot and sent to every
+  subscriber, so publishing makes no I2C transactions. The header's \c pktSeq
+  field counts frames sent, allowing receivers to detect loss; \c seq is the
+  sweep number. Nothing new is sent while the sampler is stopped, apart from
+  the latest frame every keepAlive seconds.
+
+  With a keyframe interval set, frames are deltas against the previous one
+  (see argus_telemDelta()), with a keyframe every keyEvery frames; a receiver
+  that misses a frame waits for the next keyframe.
+*/
+class TelemetryService: public UdpService
+{
+public:
+  static const unsigned minPeriod = 100,  ///< Shortest publishing period [ms].
+                        keepAlive = 60;   ///< Resend interval without new data [s].
+
+  /// Telemetry service task priority.
+  static const BYTE  telemPrio = ZPEC_TELEM_PRIO;
+  static const char *telemName;             ///< Telemetry service name.
+  static const WORD  telemPort = 2113;      ///< Telemetry service port number.
+
+  /// Constructor.
+  TelemetryService() :
+      UdpService(telemName, telemPrio, telemPort), period_(1000),
+      keyEvery_(10) { }
+
+  void handleClient(Client *client);
+
+  /// Returns the publishing period [ms].
+  unsigned getPeriod() const { return period_; }
+
+  /// Sets the publishing period [ms], no shorter than minPeriod.
+  void setPeriod(unsigned ms) { period_ = (ms < minPeriod ? minPeriod : ms); }
+
+  /// Returns the keyframe interval [frames], 0 for full frames only.
+  unsigned getKeyEvery() const { return keyEvery_; }
+
+  /// Sets the keyframe interval [frames], 0 for full frames only.
+  void setKeyEvery(unsigned n) { keyEvery_ = n; }
+
+  /// Returns the number of subscribers.
+  unsigned getSubscribers() { lock();  unsigned n = clientMap_.size();  unlock();  return n; }
+
+private:
+  unsigned period_;    ///< Publishing period [ms].
+  unsigned keyEvery_;  ///< Keyframe interval [frames], 0 for full frames only.
+};
+
 #endif  //  SERVICES_H
@@ -6,6 +6,7 @@
    $Id: utils.c,v 1.34 2008/02/20 00:25:44 rauch Exp $
 */
 #include <ctype.h>
+#include <stdarg.h>
 #include <iosys.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -136,6 +137,201 @@ char *zpec_print_fixed(char str[/*16*/], int fixed, int scale)
 }
 
 
+/**
+  Formats a floating point value with a fixed number of decimals, as
+  sprintf("%.*f") does, but using integer arithmetic for the digits. On
+  processors without an FPU this is several times faster than the soft-float
+  printf() conversion. Values whose scaled magnitude exceeds 32 bits, and
+  NaNs, fall back to sprintf(), as do values within rounding error of a
+  tie between two outputs. The 99, 999 and 9999 sentinels used for
+  unavailable monitor points format exactly, and negative zero keeps its
+  sign.
+
+  \param str  Buffer holding formatted value (24 bytes minimum for the fast
+              path).
+  \param x    Value to format.
+  \param prec Number of decimal places (0 to 9).
+
+  \return The number of characters written (excluding the terminating NUL).
+*/
+int zpec_print_float(char *str, double x, int prec)
+{
+  static const unsigned long pow10[] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+    100000000UL, 1000000000UL
+  };
+  char digits[12];
+  unsigned long v, ip, fp;
+  double a;
+  int n = 0, k = 0;
+
+  if (prec < 0 || prec > 9) { return sprintf(str, "%.*f", prec, x); }
+
+  a = (x < 0 ? -x : x) * pow10[prec];
+  if (!(a < 4294967294.)) { return sprintf(str, "%.*f", prec, x); }
+  v = (unsigned long)a;
+  a -= v;
+  if (a > 0.5 - 1e-6 && a < 0.5 + 1e-6) {  /* near a tie: round exactly */
+    return sprintf(str, "%.*f", prec, x);
+  }
+  if (a > 0.5) { ++v; }
+  ip = v / pow10[prec];
+  fp = v % pow10[prec];
+
+  if (x < 0 || (x == 0 && 1/x < 0)) { str[n++] = '-'; }  /* -0 too */
+  do { digits[k++] = '0' + ip % 10;  ip /= 10; } while (ip);
+  while (k) { str[n++] = digits[--k]; }
+  if (prec > 0) {
+    str[n++] = '.';
+    for (k = prec; k > 0; fp /= 10) { str[n + --k] = '0' + fp % 10; }
+    n += prec;
+  }
+  str[n] = '\0';
+  return n;
+}
+
+
+/**
+  Formats output as vsprintf() does, except that "f" conversions go through
+  zpec_print_float(). Other conversions are passed to sprintf() one at a
+  time. The flags, field widths and precisions (including '*') and the hh,
+  h, l and ll length modifiers of printf() are supported; %n is not.
+
+  \param str Output buffer (as large as vsprintf() would need).
+  \param fmt printf() format.
+  \param ap  Arguments.
+
+  \return The number of characters written (excluding the terminating NUL).
+*/
+int zpec_vsprintf(char *str, const char *fmt, va_list ap)
+{
+  char *p = str;
+
+  while (*fmt) {
+    const char *f0 = fmt;
+    char spec[32], flags[8];
+    int nf = 0, width = -1, prec = -1, nlong = 0, nshort = 0, left = 0, n;
+    char conv;
+
+    if (*fmt != '%') { *p++ = *fmt++; continue; }
+    if (fmt[1] == '%') { *p++ = '%'; fmt += 2; continue; }
+
+    for (++fmt; *fmt && strchr("-+ #0", *fmt); ++fmt) {
+      if (nf < 7) { flags[nf++] = *fmt; }
+      if (*fmt == '-') { left = 1; }
+    }
+    flags[nf] = '\0';
+    if (*fmt == '*') {
+      width = va_arg(ap, int);  ++fmt;
+      if (width < 0) { left = 1;  width = -width; }
+    } else if (isdigit((int)*fmt)) {
+      for (width = 0; isdigit((int)*fmt); ++fmt) { width = 10*width + (*fmt - '0'); }
+    }
+    if (*fmt == '.') {
+      ++fmt;
+      if (*fmt == '*') {
+        prec = va_arg(ap, int);  ++fmt;
+      } else {
+        for (prec = 0; isdigit((int)*fmt); ++fmt) { prec = 10*prec + (*fmt - '0'); }
+      }
+    }
+    for ( ; *fmt == 'l' || *fmt == 'h'; ++fmt) {
+      if (*fmt == 'l') { ++nlong; } else { ++nshort; }
+    }
+    conv = *fmt;
+    if (conv) { ++fmt; }
+
+    if (conv == 'f' || conv == 'F') {
+      int sign;
+
+      n = zpec_print_float(p, va_arg(ap, double), (prec < 0 ? 6 : prec));
+      sign = (*p == '-');
+      if (!sign && (strchr(flags, '+') || strchr(flags, ' '))) {
+        memmove(p+1, p, n+1);
+        *p = (strchr(flags, '+') ? '+' : ' ');
+        ++n;  sign = 1;
+      }
+      if (width > n) {
+        int pad = width - n;
+        if (left) {
+          memset(p+n, ' ', pad);
+        } else if (strchr(flags, '0') && isdigit((int)p[sign])) {
+          memmove(p+sign+pad, p+sign, n-sign);
+          memset(p+sign, '0', pad);
+        } else {
+          memmove(p+pad, p, n);
+          memset(p, ' ', pad);
+        }
+        n = width;
+      }
+      p[n] = '\0';
+      p += n;
+      continue;
+    }
+
+    /* Rebuild the conversion with '*' resolved for sprintf(). */
+    n = sprintf(spec, "%%%s%s", flags, (left && !strchr(flags, '-') ? "-" : ""));
+    if (width >= 0) { n += sprintf(spec+n, "%d", width); }
+    if (prec  >= 0) { n += sprintf(spec+n, ".%d", prec); }
+    n += sprintf(spec+n, "%s%s%c", (nlong > 1 ? "ll" : nlong ? "l" : ""),
+                 (nshort > 1 ? "hh" : nshort ? "h" : ""), conv);
+
+    switch (conv) {
+      case 'd': case 'i':
+        n = (nlong > 1 ? sprintf(p, spec, va_arg(ap, long long)) :
+             nlong     ? sprintf(p, spec, va_arg(ap, long)) :
+                         sprintf(p, spec, va_arg(ap, int)));
+        break;
+      case 'o': case 'u': case 'x': case 'X':
+        n = (nlong > 1 ? sprintf(p, spec, va_arg(ap, unsigned long long)) :
+             nlong     ? sprintf(p, spec, va_arg(ap, unsigned long)) :
+                         sprintf(p, spec, va_arg(ap, unsigned)));
+        break;
+      case 'c':
+        n = sprintf(p, spec, va_arg(ap, int));
+        break;
+      case 's':
+        n = sprintf(p, spec, va_arg(ap, const char *));
+        break;
+      case 'p':
+        n = sprintf(p, spec, va_arg(ap, void *));
+        break;
+      case 'e': case 'E': case 'g': case 'G':
+        n = sprintf(p, spec, va_arg(ap, double));
+        break;
+      default:  /* Unsupported: copied verbatim. */
+        n = fmt - f0;
+        memcpy(p, f0, n);
+        break;
+    }
+    p += n;
+  }
+  *p = '\0';
+  return p - str;
+}
+
+
+/**
+  Formats output as sprintf() does, with "f" conversions done by
+  zpec_print_float(); see zpec_vsprintf().
+
+  \param str Output buffer.
+  \param fmt printf() format.
+
+  \return The number of characters written (excluding the terminating NUL).
+*/
+int zpec_sprintf(char *str, const char *fmt, ...)
+{
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = zpec_vsprintf(str, fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+
 /**
   Actively pause (busy-wait) for the specified number of microseconds.
 */
@@ -415,6 +611,174 @@ void zpec_write_strcpy(int fd, void *buf, const char *str, unsigned maxbytes,
 }
 
 
+/**
+  Start a streaming JSON reply of the form {"name": {members}}.
+
+  Members and arrays are formatted directly into \a buf, which is written to
+  \a fd whenever it passes \a maxbytes, so a reply of any length needs no
+  more than the one buffer and a few words of stack.
+
+  \param js       Writer state.
+  \param fd       Open file descriptor to receive flushed output.
+  \param buf      Output data buffer (at least maxbytes + ZPEC_JSON_SLACK
+                  characters).
+  \param maxbytes Threshold for flushing current buffer contents.
+  \param name     Name of the reply object.
+  \param fn       Name of calling function (for error localization);
+                  can be NULL.
+*/
+void zpec_json_open(zpec_json_t *js, int fd, char *buf, unsigned maxbytes,
+    const char *name, const char *fn)
+{
+  js->fd       = fd;
+  js->buf      = buf;
+  js->maxbytes = maxbytes;
+  js->fn       = fn;
+  js->nmemb    = 0;
+  js->nelem    = 0;
+  js->nbytes   = sprintf(buf, "{\"%s\": {", name);
+}
+
+
+/**
+  Append a preformatted member, e.g. "\"cmdOK\":true", to the reply object.
+
+  \param js  Writer state.
+  \param fmt printf() format, as for zpec_vsprintf(); output must not exceed
+             ZPEC_JSON_SLACK.
+*/
+void zpec_json_member(zpec_json_t *js, const char *fmt, ...)
+{
+  va_list ap;
+
+  zpec_write_if_full(js->fd, js->buf, &js->nbytes, js->maxbytes, js->fn);
+  if (js->nmemb++) {
+    js->nbytes += sprintf(js->buf+js->nbytes, ", ");
+  }
+  va_start(ap, fmt);
+  js->nbytes += zpec_vsprintf(js->buf+js->nbytes, fmt, ap);
+  va_end(ap);
+}
+
+
+/**
+  Start an array member; follow with zpec_json_value() calls and
+  zpec_json_end_array().
+
+  \param js   Writer state.
+  \param name Member name.
+*/
+void zpec_json_array(zpec_json_t *js, const char *name)
+{
+  zpec_write_if_full(js->fd, js->buf, &js->nbytes, js->maxbytes, js->fn);
+  js->nbytes += sprintf(js->buf+js->nbytes, "%s\"%s\":[",
+			(js->nmemb++ ? ", " : ""), name);
+  js->nelem = 0;
+}
+
+
+/**
+  Append one number to the current array.
+
+  \param js    Writer state.
+  \param fmt   printf() format for \a value; "%.Nf" uses zpec_print_float().
+  \param value Value to append.
+*/
+void zpec_json_value(zpec_json_t *js, const char *fmt, double value)
+{
+  char *p = js->buf;
+
+  zpec_write_if_full(js->fd, js->buf, &js->nbytes, js->maxbytes, js->fn);
+  if (js->nelem++) {
+    js->buf[js->nbytes++] = ',';
+  }
+  p += js->nbytes;
+
+  /* Plain "%.Nf" formats take the fixed-point path. */
+  if (fmt[0] == '%' && fmt[1] == '.' && isdigit((int)fmt[2]) &&
+      fmt[3] == 'f' && fmt[4] == '\0') {
+    js->nbytes += zpec_print_float(p, value, fmt[2] - '0');
+  } else {
+    js->nbytes += sprintf(p, fmt, value);
+  }
+}
+
+
+/**
+  Close the current array.
+
+  \param js Writer state.
+*/
+void zpec_json_end_array(zpec_json_t *js)
+{
+  js->buf[js->nbytes++] = ']';
+  js->buf[js->nbytes]   = '\0';
+}
+
+
+/**
+  Append an array member of floats taken from a table or array of structures.
+
+  \param js     Writer state.
+  \param name   Member name.
+  \param fmt    printf() format for each value.
+  \param v      First value.
+  \param n      Number of values.
+  \param stride Bytes between successive values; 0 repeats \a v[0].
+*/
+void zpec_json_floats(zpec_json_t *js, const char *name, const char *fmt,
+    const float *v, int n, unsigned stride)
+{
+  const char *p = (const char *)v;
+  int i;
+
+  zpec_json_array(js, name);
+  for (i = 0; i < n; i++, p += stride) {
+    zpec_json_value(js, fmt, *(const float *)p);
+  }
+  zpec_json_end_array(js);
+}
+
+
+/**
+  Append an array member of scaled byte values.
+
+  \param js    Writer state.
+  \param name  Member name.
+  \param fmt   printf() format for each scaled value.
+  \param v     Values.
+  \param n     Number of values.
+  \param scale Factor applied to each value.
+*/
+void zpec_json_bytes(zpec_json_t *js, const char *name, const char *fmt,
+    const unsigned char *v, int n, float scale)
+{
+  int i;
+
+  zpec_json_array(js, name);
+  for (i = 0; i < n; i++) {
+    zpec_json_value(js, fmt, v[i]*scale);
+  }
+  zpec_json_end_array(js);
+}
+
+
+/**
+  Finish the reply object. Output not yet flushed stays in the buffer for
+  the caller to send.
+
+  \param js   Writer state.
+  \param tail Text following the closing braces, e.g. "\r\n".
+  \return Number of characters left in the buffer.
+*/
+unsigned zpec_json_close(zpec_json_t *js, const char *tail)
+{
+  zpec_write_if_full(js->fd, js->buf, &js->nbytes, js->maxbytes, js->fn);
+  js->nbytes += sprintf(js->buf+js->nbytes, "}}%s", tail);
+  return js->nbytes;
+}
+
+
 /**
   Crudely estimate 2^16*log2(x).
 
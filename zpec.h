@@ -7,13 +7,59 @@
 
   $Id: zpec.h,v 1.24 2014/03/21 15:26:15 rauch Exp $
 */
+#include <stdarg.h>
+
 #include <basictypes.h>
+#include <constants.h>
 #include <nettypes.h>
 #include <ucos.h>
 
 #include "argusHardwareStructs.h"
 
 
+/**
+  \name Task priorities
+  All application task priorities (lower numbers run first). Fixed tasks sit
+  in a band reserved just above the main task (MAIN_PRIO, 50); the service
+  tasks sit below it, staggered to leave holes for their server tasks, which
+  Service::createServer() takes from the holes below each service down to
+  ZPEC_SERVER_PRIO_MIN, never from the reserved band.
+  \verbatim
+    30      ADC readout
+    31      I2C bus owner ceiling
+    47      control command queue
+    48      vane motion
+    49      LNA power sequencer
+    50      main (startup only)
+    51      telemetry service
+    54      message service
+    57      control service
+    59      data service
+    61      monitor service
+    62      monitor sampler
+    51..61  server tasks, in the free holes
+  \endverbatim
+  No task is created at I2CBUSPRIO: it must stay free for the I2C bus owner
+  to move to while it holds the bus, so it lies outside the server range.
+  The control service runs in the main task, moved to its priority once the
+  other services have started.
+*/
+/*@{*/
+#define ZPEC_ADC_PRIO     30                ///< ADC readout task priority.
+#define I2CBUSPRIO        31                ///< I2C bus owner priority ceiling (argus_bus.cpp); reserved.
+#define LNASEQPRIO        (MAIN_PRIO - 1)   ///< LNA power sequencer task priority.
+#define VANEPRIO          (MAIN_PRIO - 2)   ///< Vane motion task priority.
+#define ZPEC_CMDQ_PRIO    (MAIN_PRIO - 3)   ///< Control command queue task priority.
+#define ZPEC_SERVER_PRIO_MIN (MAIN_PRIO + 1) ///< Highest server task priority.
+#define ZPEC_TELEM_PRIO   (OS_LO_PRIO - 12) ///< Telemetry service task priority.
+#define ZPEC_MESSAGE_PRIO (OS_LO_PRIO - 9)  ///< Message service task priority.
+#define ZPEC_CONTROL_PRIO (OS_LO_PRIO - 6)  ///< Control service task priority.
+#define ZPEC_DATA_PRIO    (OS_LO_PRIO - 4)  ///< Data    service task priority.
+#define ZPEC_MONITOR_PRIO (OS_LO_PRIO - 2)  ///< Monitor service task priority.
+#define SAMPLERPRIO       (OS_LO_PRIO - 1)  ///< Background monitor sampler task priority.
+/*@}*/
+
+
 /** Swap values of arbitrary type (C-callable). */
 #define ZPEC_SWAP(type, a, b) do { \
     type tmp;  tmp = a;  a = b;  b = tmp; \
@@ -100,6 +146,25 @@ extern void zpec_readFlash(flash_t *flashData);
 extern int zpec_writeFlash(const flash_t *flashData);
 
 
+/**
+  Streaming JSON writer state. Output goes straight into the caller's buffer,
+  which is flushed to \a fd each time it passes \a maxbytes; the buffer must
+  hold at least maxbytes + ZPEC_JSON_SLACK characters.
+*/
+typedef struct zpec_json_struct {
+  int         fd;        /**< Stream receiving flushed output. */
+  char       *buf;       /**< Output buffer. */
+  unsigned    nbytes;    /**< Number of characters in \a buf. */
+  unsigned    maxbytes;  /**< Threshold for flushing \a buf. */
+  const char *fn;        /**< Calling function, for error localization. */
+  int         nmemb;     /**< Members written to the current object. */
+  int         nelem;     /**< Elements written to the current array. */
+} zpec_json_t;
+
+/** Longest single zpec_json_member() or zpec_json_value() output. */
+#define ZPEC_JSON_SLACK 200
+
+
 /* Dynamic HTML callbacks (C++ source with C linkage). */
 extern void
   dhtml_getSerialNo(int sock, const char *url);
@@ -115,6 +180,21 @@ extern void zpec_write_if_full(int fd, void *buf, unsigned *nbytes,
 extern void zpec_write_strcpy(int fd, void *buf, const char *str,
 			      unsigned maxbytes, const char *fn);
 
+extern void zpec_json_open(zpec_json_t *js, int fd, char *buf,
+			   unsigned maxbytes, const char *name, const char *fn);
+extern void zpec_json_member(zpec_json_t *js, const char *fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+extern void zpec_json_array(zpec_json_t *js, const char *name);
+extern void zpec_json_value(zpec_json_t *js, const char *fmt, double value);
+extern void zpec_json_end_array(zpec_json_t *js);
+extern void zpec_json_floats(zpec_json_t *js, const char *name,
+			     const char *fmt, const float *v, int n,
+			     unsigned stride);
+extern void zpec_json_bytes(zpec_json_t *js, const char *name,
+			    const char *fmt, const unsigned char *v, int n,
+			    float scale);
+extern unsigned zpec_json_close(zpec_json_t *js, const char *tail);
+
 extern BYTE zpec_change_prio(BYTE prio);
 
 extern int zpec_getSerialNo(void);
@@ -133,6 +213,10 @@ extern const char *zpec_version(void);
 
 extern char *zpec_iptostr(char *str, IPADDR addr);
 extern char *zpec_print_fixed(char str[/*16*/], int fixed, int scale);
+extern int zpec_print_float(char *str, double x, int prec);
+extern int zpec_vsprintf(char *str, const char *fmt, va_list ap);
+extern int zpec_sprintf(char *str, const char *fmt, ...)
+  __attribute__((format(printf, 2, 3)));
 
 #ifdef __cplusplus
 }  // extern "C"